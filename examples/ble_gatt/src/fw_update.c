@@ -8,62 +8,43 @@
 LOG_MODULE_REGISTER(fw_update);
 
 #include <zephyr/kernel.h>
-#include <zephyr/dfu/flash_img.h>
 #include <zephyr/dfu/mcuboot.h>
 #include <zephyr/logging/log_ctrl.h>
 #include <zephyr/storage/flash_map.h>
 #include <zephyr/sys/reboot.h>
 
 #include <golioth/ota.h>
+#include <golioth/ota_flash_img.h>
 
 #include <app_version.h>
 
-static struct flash_img_context flash_context;
-
-static void ota_main_receive(const void *data, size_t offset, size_t len, bool is_last)
+static void ota_main_done(int err)
 {
-    LOG_DBG("Received %d bytes at offset %d", len, offset);
-
-    int err = 0;
-
-    if (0 == offset)
+    if (err)
     {
-        err = flash_img_init(&flash_context);
-        if (err)
-        {
-            LOG_ERR("Failed to init flash write");
-            return;
-        }
+        LOG_ERR("Failed to receive firmware: %d", err);
+        golioth_ota_mark_idle("main");
+        return;
     }
 
-    err = flash_img_buffered_write(&flash_context, data, len, is_last);
+    err = boot_request_upgrade(BOOT_UPGRADE_PERMANENT);
     if (err)
     {
-        LOG_ERR("Failed to write to flash: %d", err);
+        LOG_ERR("Failed to request upgrade");
         return;
     }
 
-    if (is_last)
-    {
-        err = boot_request_upgrade(BOOT_UPGRADE_PERMANENT);
-        if (err)
-        {
-            LOG_ERR("Failed to request upgrade");
-            return;
-        }
-
-        LOG_INF("Rebooting to apply upgrade");
+    LOG_INF("Rebooting to apply upgrade");
 
 #if IS_ENABLED(CONFIG_LOG)
-        while (log_process())
-        {
-        }
+    while (log_process())
+    {
+    }
 #endif
 
-        k_sleep(K_SECONDS(3));
+    k_sleep(K_SECONDS(3));
 
-        sys_reboot(SYS_REBOOT_WARM);
-    }
+    sys_reboot(SYS_REBOOT_WARM);
 }
 
 static void ota_manifest_receive(const struct golioth_ota_manifest_component *components,
@@ -85,5 +66,5 @@ static void ota_manifest_receive(const struct golioth_ota_manifest_component *co
     }
 }
 
-GOLIOTH_OTA_COMPONENT(main, "main", APP_VERSION_STRING, ota_main_receive);
+GOLIOTH_OTA_FLASH_IMG_COMPONENT(main, "main", APP_VERSION_STRING, ota_main_done);
 GOLIOTH_OTA_MANIFEST_HANDLER(ota_manifest_receive);
@@ -155,12 +155,29 @@ static struct bt_conn_auth_cb auth_cb_display = {
 
 void sync_request_work_handler(struct k_work *work)
 {
-    service_data.data.flags |= POUCH_GATT_ADV_FLAG_SYNC_REQUEST;
+    if (pouch_sync_is_requested())
+    {
+        service_data.data.flags |= POUCH_GATT_ADV_FLAG_SYNC_REQUEST;
+        LOG_INF("Sync request flag set in advertisement");
+    }
+    else
+    {
+        service_data.data.flags &= ~POUCH_GATT_ADV_FLAG_SYNC_REQUEST;
+        LOG_INF("Sync request flag cleared in advertisement");
+    }
+
     bt_le_adv_update_data(ad, ARRAY_SIZE(ad), NULL, 0);
-    LOG_INF("Sync request flag set in advertisement");
 }
 
-K_WORK_DELAYABLE_DEFINE(sync_request_work, sync_request_work_handler);
+K_WORK_DEFINE(sync_request_work, sync_request_work_handler);
+
+void sync_period_work_handler(struct k_work *work)
+{
+    // Sensor data is only written in a session, so sync periodically to pick up downlink data:
+    pouch_sync_request();
+}
+
+K_WORK_DELAYABLE_DEFINE(sync_period_work, sync_period_work_handler);
 
 static void pouch_event_handler(enum pouch_event event, void *ctx)
 {
@@ -183,9 +200,13 @@ static void pouch_event_handler(enum pouch_event event, void *ctx)
     {
         sensors_pouch_session_end();
 
-        service_data.data.flags &= ~POUCH_GATT_ADV_FLAG_SYNC_REQUEST;
-        bt_le_adv_update_data(ad, ARRAY_SIZE(ad), NULL, 0);
-        k_work_schedule(&sync_request_work, K_SECONDS(CONFIG_EXAMPLE_SYNC_PERIOD_S));
+        k_work_schedule(&sync_period_work, K_SECONDS(CONFIG_EXAMPLE_SYNC_PERIOD_S));
+    }
+
+    if (POUCH_EVENT_SYNC_REQUEST == event || POUCH_EVENT_SYNC_REQUEST_CLEARED == event)
+    {
+        // The sync policy decides when it's worth asking a gateway to connect:
+        k_work_submit(&sync_request_work);
     }
 }
 
@@ -403,7 +424,7 @@ int main(void)
         LOG_ERR("Sensors init failed (err %d)", err);
     }
 
-    k_work_schedule(&sync_request_work, K_SECONDS(CONFIG_EXAMPLE_SYNC_PERIOD_S));
+    k_work_schedule(&sync_period_work, K_SECONDS(CONFIG_EXAMPLE_SYNC_PERIOD_S));
 
     while (1)
     {
@@ -10,9 +10,22 @@ LOG_MODULE_DECLARE(main);
 
 #include <pouch/uplink.h>
 #include <pouch/types.h>
+#include <pouch/schema.h>
 
 #include "temp_sensor.h"
 
+#if defined(CONFIG_POUCH_SCHEMA)
+/* Binary temperature report, decoded in the cloud using the schema descriptor. */
+struct temp_report {
+    int32_t temp_milli;
+} __packed;
+
+POUCH_SCHEMA_DEFINE(temp_report_schema,
+                    1,
+                    struct temp_report,
+                    POUCH_SCHEMA_FIELD(struct temp_report, temp_milli, POUCH_SCHEMA_I32));
+#endif
+
 /* Period between temperature reports (seconds). */
 #define TEMP_REPORT_PERIOD_S 15
 
@@ -56,6 +69,16 @@ static void temp_report_work_handler(struct k_work *work)
     LOG_INF("Temp reading: %d.%03d C", (int)t_int, (int)t_frac);
 
     if (pouch_session_active) {
+#if defined(CONFIG_POUCH_SCHEMA)
+        struct temp_report report = {
+            .temp_milli = temp_milli,
+        };
+
+        err = pouch_uplink_schema_write(".s/temp", &temp_report_schema, &report, K_NO_WAIT);
+        if (err) {
+            LOG_WRN("Temp uplink failed (err %d), logging only", err);
+        }
+#else
         char payload[64];
         int len = snprintk(payload, sizeof(payload),
                            "{\"temp_c\":%d.%03d}",
@@ -71,6 +94,7 @@ static void temp_report_work_handler(struct k_work *work)
                 LOG_WRN("Temp uplink failed (err %d), logging only", err);
             }
         }
+#endif
     }
 
     k_work_schedule(&temp_report_work, K_SECONDS(TEMP_REPORT_PERIOD_S));
@@ -4,91 +4,51 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(glth_dispatch, CONFIG_GOLIOTH_LOG_LEVEL);
 
-#include <pouch/downlink.h>
 #include <pouch/events.h>
 #include <pouch/uplink.h>
 
 #include "dispatch.h"
 
-static struct golioth_downlink_service *last_seen = NULL;
-
-static void pouch_downlink_start(unsigned int stream_id, const char *path, uint16_t content_type)
+void golioth_downlink_start(const struct golioth_downlink_service *service,
+                            unsigned int stream_id,
+                            const char *path)
 {
-    LOG_DBG("Downlink start: %d, %s, %d", stream_id, path, content_type);
+    LOG_DBG("Downlink start: %d, %s", stream_id, path);
     LOG_INF("Receiving Downlink entry on path %s", path);
 
-    STRUCT_SECTION_FOREACH(golioth_downlink_service, service)
+    if (NULL != service->start_cb)
     {
         size_t path_len = strlen(service->path);
         bool partial = service->path[path_len - 1] == '*';
-        if (partial)
+        const char *path_remainder = NULL;
+        if (partial && (strlen(path + path_len - 1) > 0))
         {
-            path_len--;
+            path_remainder = path + path_len - 1;
         }
-        if (0 == strncmp(service->path, path, path_len))
-        {
-            LOG_DBG("Found match for path %s", path);
-            last_seen = service;
-            service->data->downlink_id = stream_id;
-            if (NULL != service->start_cb)
-            {
-                const char *path_remainder = NULL;
-                if (partial && (strlen(path + path_len) > 0))
-                {
-                    path_remainder = path + path_len;
-                }
-                service->start_cb(stream_id, path_remainder);
-            }
-            break;
-        }
-    }
-
-    if (NULL == last_seen)
-    {
-        LOG_DBG("No handler registered for path %s", path);
+        service->start_cb(stream_id, path_remainder);
     }
 }
 
-static void pouch_downlink_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+int golioth_downlink_data(const struct golioth_downlink_service *service,
+                          unsigned int stream_id,
+                          const void *data,
+                          size_t len,
+                          bool is_last)
 {
     LOG_DBG("Downlink data: %d", stream_id);
 
-    struct golioth_downlink_service *active_service = NULL;
-
-    if (NULL != last_seen && last_seen->data->downlink_id == stream_id)
-    {
-        active_service = last_seen;
-    }
-    else
+    int ret = service->data_cb(stream_id, data, len, is_last);
+    if (is_last)
     {
-        STRUCT_SECTION_FOREACH(golioth_downlink_service, service)
-        {
-            if (service->data->downlink_id == stream_id)
-            {
-                active_service = service;
-                break;
-            }
-        }
+        LOG_INF("Finished entry for %s", service->path);
     }
 
-    if (NULL != active_service)
-    {
-        active_service->data_cb(stream_id, data, len, is_last);
-        if (is_last)
-        {
-            LOG_INF("Finished entry for %s", active_service->path);
-
-            active_service->data->downlink_id = DOWNLINK_ID_INVALID;
-            last_seen = NULL;
-        }
-    }
-    else
-    {
-        LOG_DBG("Dropping message for stream_id %d", stream_id);
-    }
+    return ret;
 }
 
 int golioth_sync_to_cloud(void)
@@ -107,5 +67,3 @@ int golioth_sync_to_cloud(void)
 
     return 0;
 }
-
-POUCH_DOWNLINK_HANDLER(pouch_downlink_start, pouch_downlink_data);
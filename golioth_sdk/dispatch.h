@@ -10,29 +10,28 @@
 
 #include <zephyr/sys/iterable_sections.h>
 
+#include <pouch/downlink.h>
+
 typedef int golioth_downlink_id_t;
 
 typedef void (*golioth_service_downlink_start_cb)(golioth_downlink_id_t id,
                                                   const char *path_remainder);
-typedef void (*golioth_service_downlink_data_cb)(golioth_downlink_id_t id,
-                                                 const void *data,
-                                                 size_t len,
-                                                 bool is_last);
+/* Returns -EINPROGRESS to hold on to the data until pouch_downlink_ack() is called, see
+ * pouch_downlink_data_async_cb.
+ */
+typedef int (*golioth_service_downlink_data_cb)(golioth_downlink_id_t id,
+                                                const void *data,
+                                                size_t len,
+                                                bool is_last);
 typedef void (*golioth_service_uplink_cb)(void);
 
 #define DOWNLINK_ID_INVALID (-1)
 
-struct golioth_downlink_service_data
-{
-    golioth_downlink_id_t downlink_id;
-};
-
 struct golioth_downlink_service
 {
     const char *path;
     golioth_service_downlink_start_cb start_cb;
     golioth_service_downlink_data_cb data_cb;
-    struct golioth_downlink_service_data *data;
 };
 
 struct golioth_uplink_service
@@ -40,18 +39,47 @@ struct golioth_uplink_service
     golioth_service_uplink_cb uplink_cb;
 };
 
+void golioth_downlink_start(const struct golioth_downlink_service *service,
+                            unsigned int stream_id,
+                            const char *path);
+int golioth_downlink_data(const struct golioth_downlink_service *service,
+                          unsigned int stream_id,
+                          const void *data,
+                          size_t len,
+                          bool is_last);
+
+/* Services are registered as path filtered Pouch downlink handlers, so the Pouch downlink
+ * router only passes them their own traffic. The handlers are asynchronous, so services can
+ * pause the downlink while they process data.
+ */
 #define GOLIOTH_DOWNLINK_HANDLER(_name, _path, _start_cb, _data_cb)                              \
     BUILD_ASSERT((_path != NULL) && (_data_cb != NULL), "_path, and _data_cb must not be NULL"); \
-    static struct golioth_downlink_service_data _name##_data = {                                 \
-        .downlink_id = DOWNLINK_ID_INVALID,                                                      \
-    };                                                                                           \
-    static STRUCT_SECTION_ITERABLE(golioth_downlink_service,                                     \
-                                   CONCAT(_golioth_downlink_service_, _name)) = {                \
+    static const struct golioth_downlink_service _golioth_downlink_service_##_name = {           \
         .path = _path,                                                                           \
         .start_cb = _start_cb,                                                                   \
         .data_cb = _data_cb,                                                                     \
-        .data = &_name##_data,                                                                   \
-    }
+    };                                                                                           \
+    static void _golioth_##_name##_pouch_start(unsigned int stream_id,                           \
+                                               const char *path,                                 \
+                                               uint16_t content_type)                            \
+    {                                                                                            \
+        golioth_downlink_start(&_golioth_downlink_service_##_name, stream_id, path);             \
+    }                                                                                            \
+    static int _golioth_##_name##_pouch_data(unsigned int stream_id,                             \
+                                             const void *data,                                   \
+                                             size_t len,                                         \
+                                             bool is_last)                                       \
+    {                                                                                            \
+        return golioth_downlink_data(&_golioth_downlink_service_##_name,                         \
+                                     stream_id,                                                  \
+                                     data,                                                       \
+                                     len,                                                        \
+                                     is_last);                                                   \
+    }                                                                                            \
+    POUCH_DOWNLINK_PATH_HANDLER_ASYNC(_name,                                                     \
+                                      _path,                                                     \
+                                      _golioth_##_name##_pouch_start,                            \
+                                      _golioth_##_name##_pouch_data)
 
 #define GOLIOTH_UPLINK_HANDLER(_name, _uplink_cb)                               \
     BUILD_ASSERT(_uplink_cb != NULL, "_uplink_cb must not be NULL");            \
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <zephyr/logging/log.h>
@@ -12,13 +13,20 @@ LOG_MODULE_REGISTER(ota, CONFIG_GOLIOTH_LOG_LEVEL);
 #include <pouch/types.h>
 #include <pouch/uplink.h>
 
-#include <zcbor_utils.h>
-#include <zcbor_decode.h>
+#include <zcbor_stream.h>
+#include <zcbor_encode.h>
 
 #include "dispatch.h"
 #include "ota.h"
+#if defined(CONFIG_GOLIOTH_OTA_DECOMPRESS)
+#include "ota_decompress.h"
+#endif
 
 #define GOLIOTH_OTA_COMPONENT_PATH_PREFIX ".u/c/"
+/* Component streams are sent to <prefix><package>@<version>, with a ?o=<offset> suffix when the
+ * cloud resumes a download at the offset reported in the status uplink.
+ */
+#define GOLIOTH_OTA_COMPONENT_OFFSET_SUFFIX "?o="
 #define GOLIOTH_OTA_MANIFEST_PATH "/.u/desired"
 
 #define GOLIOTH_OTA_COMPONEN_PATH_MAX_BUF_LEN \
@@ -32,18 +40,13 @@ LOG_MODULE_REGISTER(ota, CONFIG_GOLIOTH_LOG_LEVEL);
    - package name (string)
    - current version (string)
    - target version (string)
+   - download offset (uint32)
  */
-#define OTA_STATUS_FIXED_SIZE 21
+#define OTA_STATUS_FIXED_SIZE 28
 #define OTA_STATUS_ENCODE_BUF_SIZE                                  \
     (OTA_STATUS_FIXED_SIZE + 2 * CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN \
      + CONFIG_GOLIOTH_OTA_MAX_PACKAGE_NAME_LEN)
 
-struct component_tstr_value
-{
-    char *value;
-    size_t value_len;
-};
-
 enum
 {
     MANIFEST_KEY_SEQUENCE_NUMBER = 1,
@@ -59,183 +62,493 @@ enum
     COMPONENT_KEY_SIZE = 4,
     COMPONENT_KEY_URI = 5,
     COMPONENT_KEY_BOOTLOADER = 6,
+    COMPONENT_KEY_DELTA_SOURCE = 7,
+    COMPONENT_KEY_COMPRESSION = 8,
 };
 
-struct
+/* Component downloads in progress. Components may be downloaded on several concurrent streams. */
+static struct component_download
 {
     golioth_downlink_id_t downlink_id;
     size_t offset;
     char name[CONFIG_GOLIOTH_OTA_MAX_PACKAGE_NAME_LEN + 1];
     char version[CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN + 1];
-} component_download = {
-    .downlink_id = DOWNLINK_ID_INVALID,
+#if defined(CONFIG_GOLIOTH_OTA_DECOMPRESS)
+    bool compressed;
+    struct ota_decompress decompress;
+#endif
+} component_downloads[CONFIG_POUCH_DOWNLINK_STREAMS_MAX] = {
+    [0 ... CONFIG_POUCH_DOWNLINK_STREAMS_MAX - 1] = {.downlink_id = DOWNLINK_ID_INVALID},
 };
 
-static int component_entry_decode_value(zcbor_state_t *zsd, void *void_value)
+/* Component data last passed to the upper half, which an asynchronous receive callback may hold on
+ * to until golioth_ota_component_ack() is called. The download slot may be released by then.
+ */
+static struct
 {
-    struct component_tstr_value *value = void_value;
-    struct zcbor_string tstr;
-    bool ok;
+    const char *name;
+    golioth_downlink_id_t downlink_id;
+} component_ack;
 
-    ok = zcbor_tstr_decode(zsd, &tstr);
-    if (!ok)
+static struct component_download *component_download_get(golioth_downlink_id_t id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(component_downloads); i++)
+    {
+        if (component_downloads[i].downlink_id == id)
+        {
+            return &component_downloads[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Manifest format:
+ *
+ * {
+ *     MANIFEST_KEY_SEQUENCE_NUMBER: int,
+ *     MANIFEST_KEY_HASH: tstr,
+ *     MANIFEST_KEY_COMPONENTS: [
+ *         {
+ *             COMPONENT_KEY_PACKAGE: tstr,
+ *             COMPONENT_KEY_VERSION: tstr,
+ *             COMPONENT_KEY_HASH: tstr,
+ *             COMPONENT_KEY_SIZE: int,
+ *             ? COMPONENT_KEY_DELTA_SOURCE: tstr,
+ *             ? COMPONENT_KEY_COMPRESSION: tstr,
+ *             ...
+ *         },
+ *         ...
+ *     ],
+ * }
+ *
+ * The manifest is decoded as it arrives, one component at a time, so it may span any number of
+ * blocks. The upper half stages each component, and only acts on them once the whole manifest has
+ * been decoded.
+ */
+
+#define COMPONENT_REQUIRED_KEYS                                                    \
+    (BIT(COMPONENT_KEY_PACKAGE) | BIT(COMPONENT_KEY_VERSION) | BIT(COMPONENT_KEY_HASH) \
+     | BIT(COMPONENT_KEY_SIZE))
+
+static struct
+{
+    struct zcbor_stream stream;
+    /* First decoding error, the rest of the manifest is dropped after it */
+    int err;
+    /* Whether the end of the component list was decoded */
+    bool components_done;
+    int64_t key;
+    int64_t component_key;
+    uint32_t component_keys_found;
+    struct golioth_ota_component component;
+    char hash_str[GOLIOTH_OTA_COMPONENT_HASH_HEX_LEN + 1];
+    char compression_str[sizeof("heatshrink")];
+} manifest_decoder;
+
+static int component_value_decode(const struct zcbor_stream_item *item)
+{
+    char *buf;
+    size_t size;
+    int err;
+
+    switch (manifest_decoder.component_key)
+    {
+        case COMPONENT_KEY_PACKAGE:
+            buf = manifest_decoder.component.package;
+            size = sizeof(manifest_decoder.component.package);
+            break;
+        case COMPONENT_KEY_VERSION:
+            buf = manifest_decoder.component.version;
+            size = sizeof(manifest_decoder.component.version);
+            break;
+        case COMPONENT_KEY_HASH:
+            buf = manifest_decoder.hash_str;
+            size = sizeof(manifest_decoder.hash_str);
+            break;
+        case COMPONENT_KEY_DELTA_SOURCE:
+            buf = manifest_decoder.component.delta_source;
+            size = sizeof(manifest_decoder.component.delta_source);
+            break;
+        case COMPONENT_KEY_COMPRESSION:
+            /* Unknown compression methods make the component unsupported, not the manifest */
+            if (item->type == ZCBOR_STREAM_TSTR
+                && item->str.total_len >= sizeof(manifest_decoder.compression_str))
+            {
+                manifest_decoder.component.compression = GOLIOTH_OTA_COMPRESSION_UNSUPPORTED;
+                return 0;
+            }
+
+            buf = manifest_decoder.compression_str;
+            size = sizeof(manifest_decoder.compression_str);
+            break;
+        case COMPONENT_KEY_SIZE:
+            if (item->type != ZCBOR_STREAM_INT || item->i64 < INT32_MIN || item->i64 > INT32_MAX)
+            {
+                return -EBADMSG;
+            }
+
+            manifest_decoder.component.size = item->i64;
+            manifest_decoder.component_keys_found |= BIT(COMPONENT_KEY_SIZE);
+            return 0;
+        default:
+            return 0;
+    }
+
+    if (item->type != ZCBOR_STREAM_TSTR)
     {
         return -EBADMSG;
     }
 
-    if (tstr.len > value->value_len)
+    err = zcbor_stream_str_copy(item, buf, size);
+    if (err)
     {
         LOG_ERR("Not enough space to store");
-        return -ENOMEM;
+        return err;
     }
 
-    memcpy(value->value, tstr.value, tstr.len);
-    value->value[tstr.len] = '\0';
+    if (zcbor_stream_str_is_complete(item))
+    {
+        manifest_decoder.component_keys_found |= BIT(manifest_decoder.component_key);
+    }
 
     return 0;
 }
 
-static void ota_receive_manifest(golioth_downlink_id_t id,
-                                 const void *data,
-                                 size_t len,
-                                 bool is_last)
+static int component_complete(void)
 {
-    ZCBOR_STATE_D(zsd, 3, data, len, 1, 0);
+    if ((manifest_decoder.component_keys_found & COMPONENT_REQUIRED_KEYS)
+        != COMPONENT_REQUIRED_KEYS)
+    {
+        return -EBADMSG;
+    }
 
-    bool ok = zcbor_map_start_decode(zsd);
-    if (!ok)
+    size_t hash_buf_len = hex2bin(manifest_decoder.hash_str,
+                                  strlen(manifest_decoder.hash_str),
+                                  manifest_decoder.component.hash,
+                                  sizeof(manifest_decoder.component.hash));
+    if (GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN != hash_buf_len)
     {
-        LOG_ERR("Failed to deserialize manifest");
-        return;
+        LOG_ERR("Failed to deserialize hash");
+        return -EBADMSG;
     }
 
-    while (!zcbor_list_or_map_end(zsd))
+    if (manifest_decoder.component_keys_found & BIT(COMPONENT_KEY_COMPRESSION))
     {
-        uint32_t key;
-        ok = zcbor_uint32_decode(zsd, &key);
-        if (!ok)
+        manifest_decoder.component.compression =
+            (0 == strcmp(manifest_decoder.compression_str, "heatshrink"))
+            ? GOLIOTH_OTA_COMPRESSION_HEATSHRINK
+            : GOLIOTH_OTA_COMPRESSION_UNSUPPORTED;
+    }
+
+    golioth_ota_manifest_receive_one(&manifest_decoder.component);
+
+    return 0;
+}
+
+static int manifest_item_decode(const struct zcbor_stream_item *item, void *user_data)
+{
+    if (item->depth == 0)
+    {
+        return (item->type == ZCBOR_STREAM_MAP_START || item->type == ZCBOR_STREAM_CONTAINER_END)
+            ? 0
+            : -EBADMSG;
+    }
+
+    if (item->depth == 1 && item->is_key)
+    {
+        if (item->type != ZCBOR_STREAM_INT)
         {
-            LOG_ERR("Failed to deserialize manifest");
-            return;
+            return -EBADMSG;
         }
 
-        if (MANIFEST_KEY_COMPONENTS == key)
-        {
-            ok = zcbor_list_start_decode(zsd);
-            if (!ok)
+        manifest_decoder.key = item->i64;
+        return 0;
+    }
+
+    if (manifest_decoder.key != MANIFEST_KEY_COMPONENTS)
+    {
+        return 0;
+    }
+
+    switch (item->depth)
+    {
+        case 1:
+            /* Component list */
+            if (item->type == ZCBOR_STREAM_CONTAINER_END)
             {
-                LOG_ERR("Failed to deserialize manifest");
-                return;
+                manifest_decoder.components_done = true;
             }
-
-            while (!zcbor_list_or_map_end(zsd))
+            else if (item->type != ZCBOR_STREAM_LIST_START)
             {
-                struct golioth_ota_component component = {};
-                struct component_tstr_value package = {
-                    component.package,
-                    sizeof(component.package) - 1,
-                };
-                struct component_tstr_value version = {
-                    component.version,
-                    sizeof(component.version) - 1,
-                };
-
-                char hash_str[GOLIOTH_OTA_COMPONENT_HASH_HEX_LEN + 1];
-                struct component_tstr_value hash_tstr = {
-                    hash_str,
-                    sizeof(hash_str) - 1,
-                };
-
-                struct zcbor_map_entry map_entries[] = {
-                    ZCBOR_U32_MAP_ENTRY(COMPONENT_KEY_PACKAGE,
-                                        component_entry_decode_value,
-                                        &package),
-                    ZCBOR_U32_MAP_ENTRY(COMPONENT_KEY_VERSION,
-                                        component_entry_decode_value,
-                                        &version),
-                    ZCBOR_U32_MAP_ENTRY(COMPONENT_KEY_SIZE,
-                                        zcbor_map_int32_decode,
-                                        &component.size),
-                    ZCBOR_U32_MAP_ENTRY(COMPONENT_KEY_HASH,
-                                        component_entry_decode_value,
-                                        &hash_tstr),
-                };
-
-                int err = zcbor_map_decode(zsd, map_entries, ARRAY_SIZE(map_entries));
-                if (err)
-                {
-                    LOG_ERR("Failed to deserialize manifest");
-                    return;
-                }
-
-                size_t hash_buf_len = hex2bin(hash_str,
-                                              GOLIOTH_OTA_COMPONENT_HASH_HEX_LEN,
-                                              component.hash,
-                                              sizeof(component.hash));
-                if (GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN != hash_buf_len)
+                return -EBADMSG;
+            }
+            break;
+        case 2:
+            /* Component */
+            if (item->type == ZCBOR_STREAM_MAP_START)
+            {
+                memset(&manifest_decoder.component, 0, sizeof(manifest_decoder.component));
+                manifest_decoder.hash_str[0] = '\0';
+                manifest_decoder.compression_str[0] = '\0';
+                manifest_decoder.component_keys_found = 0;
+            }
+            else if (item->type == ZCBOR_STREAM_CONTAINER_END)
+            {
+                return component_complete();
+            }
+            else
+            {
+                return -EBADMSG;
+            }
+            break;
+        case 3:
+            if (item->is_key)
+            {
+                if (item->type != ZCBOR_STREAM_INT)
                 {
-                    LOG_ERR("Failed to deserialize hash");
-                    return;
+                    return -EBADMSG;
                 }
 
-                golioth_ota_manifest_receive_one(&component);
+                manifest_decoder.component_key = item->i64;
+                return 0;
             }
 
-            golioth_ota_manifest_complete();
+            return component_value_decode(item);
+        default:
+            break;
+    }
 
-            ok = zcbor_list_or_map_end(zsd);
-            if (!ok)
-            {
-                LOG_ERR("Failed to deserialize manifest");
-                return;
-            }
+    return 0;
+}
+
+static void ota_receive_manifest_start(golioth_downlink_id_t id, const char *path_remainder)
+{
+    zcbor_stream_init(&manifest_decoder.stream, manifest_item_decode, NULL);
+    manifest_decoder.err = 0;
+    manifest_decoder.components_done = false;
+    manifest_decoder.key = -1;
+
+    /* Drop the components of a manifest that was never completed */
+    golioth_ota_manifest_abort();
+}
+
+static int ota_receive_manifest(golioth_downlink_id_t id,
+                                const void *data,
+                                size_t len,
+                                bool is_last)
+{
+    if (0 == manifest_decoder.err)
+    {
+        manifest_decoder.err = zcbor_stream_feed(&manifest_decoder.stream, data, len);
+    }
+
+    if (!is_last)
+    {
+        return 0;
+    }
+
+    if (0 == manifest_decoder.err)
+    {
+        manifest_decoder.err = zcbor_stream_finish(&manifest_decoder.stream);
+    }
+
+    if (0 == manifest_decoder.err && !manifest_decoder.components_done)
+    {
+        manifest_decoder.err = -EBADMSG;
+    }
+
+    if (0 != manifest_decoder.err)
+    {
+        LOG_ERR("Failed to deserialize manifest: %d", manifest_decoder.err);
+        golioth_ota_manifest_abort();
+        return 0;
+    }
+
+    golioth_ota_manifest_complete();
+
+    return 0;
+}
+
+#if defined(CONFIG_GOLIOTH_OTA_DECOMPRESS)
+
+static int component_decompressed(const void *data, size_t len, bool is_last, void *user_data)
+{
+    struct component_download *download = user_data;
+
+    golioth_ota_receive_component(download->name,
+                                  download->version,
+                                  download->offset,
+                                  data,
+                                  len,
+                                  is_last);
+    download->offset += len;
+
+    return 0;
+}
+
+static void component_decompress(struct component_download *download,
+                                 const void *data,
+                                 size_t len,
+                                 bool is_last)
+{
+    int err = ota_decompress_feed(&download->decompress, data, len);
+    if (0 == err && is_last)
+    {
+        err = ota_decompress_finish(&download->decompress);
+    }
+
+    if (err)
+    {
+        /* The rest of the stream is dropped, and the component is marked idle */
+        LOG_ERR("Failed to decompress %s@%s: %d", download->name, download->version, err);
+        golioth_ota_receive_component_abort(download->name);
+        download->downlink_id = DOWNLINK_ID_INVALID;
+    }
+}
+
+#endif /* CONFIG_GOLIOTH_OTA_DECOMPRESS */
+
+static void ota_receive_component_start(golioth_downlink_id_t id, const char *path_remainder)
+{
+    /* Drop a previous download on this stream that was never completed */
+    struct component_download *download = component_download_get(id);
+    if (NULL != download)
+    {
+        download->downlink_id = DOWNLINK_ID_INVALID;
+    }
+
+    const char *delimiter = (NULL != path_remainder) ? strchr(path_remainder, '@') : NULL;
+    if (NULL == delimiter)
+    {
+        return;
+    }
+
+    download = component_download_get(DOWNLINK_ID_INVALID);
+    if (NULL == download)
+    {
+        LOG_WRN("Too many concurrent component downloads");
+        return;
+    }
+
+    const char *version = delimiter + 1;
+    const char *suffix = strstr(version, GOLIOTH_OTA_COMPONENT_OFFSET_SUFFIX);
+    size_t version_len = (NULL != suffix) ? (size_t) (suffix - version) : strlen(version);
+    size_t start = 0;
+
+    if (NULL != suffix)
+    {
+        char *end;
+
+        start = strtoul(suffix + strlen(GOLIOTH_OTA_COMPONENT_OFFSET_SUFFIX), &end, 10);
+        if ('\0' != *end)
+        {
+            LOG_ERR("Invalid component path: %s", path_remainder);
+            return;
         }
-        else
+    }
+
+    download->downlink_id = id;
+    size_t name_len = MIN(((intptr_t) delimiter) - ((intptr_t) path_remainder),
+                          sizeof(download->name) - 1);
+    strncpy(download->name, path_remainder, name_len);
+    download->name[name_len] = '\0';
+    version_len = MIN(version_len, sizeof(download->version) - 1);
+    strncpy(download->version, version, version_len);
+    download->version[version_len] = '\0';
+
+    /* Only continue from the reported offset if the cloud confirms that the stream starts there */
+    size_t expected = golioth_ota_resume_offset(download->name, download->version);
+    if (start != expected)
+    {
+        LOG_WRN("Download of %s@%s starts at offset %zu, expected %zu",
+                download->name,
+                download->version,
+                start,
+                expected);
+
+        /* Report no progress, so the next download starts over */
+        golioth_ota_resume_reset(download->name);
+
+        if (0 != start)
         {
-            ok = zcbor_any_skip(zsd, NULL);
-            if (!ok)
-            {
-                LOG_ERR("Failed to deserialize manifest");
-                return;
-            }
+            download->downlink_id = DOWNLINK_ID_INVALID;
+            return;
         }
     }
+
+    download->offset = start;
+    if (download->offset > 0)
+    {
+        LOG_INF("Resuming download of %s@%s at offset %zu",
+                download->name,
+                download->version,
+                download->offset);
+    }
+
+#if defined(CONFIG_GOLIOTH_OTA_DECOMPRESS)
+    download->compressed = golioth_ota_is_compressed(download->name);
+    if (download->compressed)
+    {
+        ota_decompress_init(&download->decompress, component_decompressed, download);
+    }
+#endif
 }
 
-static void ota_receive_component_start(golioth_downlink_id_t id, const char *path_remainder)
+static int ota_receive_component_data(golioth_downlink_id_t id,
+                                      const void *data,
+                                      size_t len,
+                                      bool is_last)
 {
-    const char *delimiter = strchr(path_remainder, '@');
-    if (NULL != delimiter)
+    int ret = 0;
+
+    struct component_download *download = component_download_get(id);
+    if (NULL == download)
     {
-        component_download.downlink_id = id;
-        size_t name_len = ((intptr_t) delimiter) - ((intptr_t) path_remainder);
-        strncpy(component_download.name, path_remainder, name_len);
-        component_download.name[name_len] = '\0';
-        strncpy(component_download.version, delimiter + 1, sizeof(component_download.version));
-        component_download.version[sizeof(component_download.version) - 1] = '\0';
-        component_download.offset = 0;
+        return 0;
+    }
+
+#if defined(CONFIG_GOLIOTH_OTA_DECOMPRESS)
+    if (download->compressed)
+    {
+        component_decompress(download, data, len, is_last);
     }
     else
+#endif
+    {
+        component_ack.name = download->name;
+        component_ack.downlink_id = id;
+
+        int err = golioth_ota_receive_component(download->name,
+                                                download->version,
+                                                download->offset,
+                                                data,
+                                                len,
+                                                is_last);
+        if (-EINPROGRESS == err)
+        {
+            ret = err;
+        }
+
+        download->offset += len;
+    }
+
+    if (is_last)
     {
-        component_download.downlink_id = DOWNLINK_ID_INVALID;
+        download->downlink_id = DOWNLINK_ID_INVALID;
     }
+
+    return ret;
 }
 
-static void ota_receive_component_data(golioth_downlink_id_t id,
-                                       const void *data,
-                                       size_t len,
-                                       bool is_last)
+int golioth_ota_component_ack(const char *name)
 {
-    if (DOWNLINK_ID_INVALID != component_download.downlink_id)
+    if (NULL == component_ack.name || 0 != strcmp(component_ack.name, name))
     {
-        golioth_ota_receive_component(component_download.name,
-                                      component_download.version,
-                                      component_download.offset,
-                                      data,
-                                      len,
-                                      is_last);
-        component_download.offset += len;
+        return -EINVAL;
     }
+
+    return pouch_downlink_ack(component_ack.downlink_id);
 }
 
 static void ota_uplink(void)
@@ -244,10 +557,15 @@ static void ota_uplink(void)
     const char *current_version = NULL;
     const char *target_version = NULL;
     enum golioth_ota_state state = GOLIOTH_OTA_STATE_IDLE;
+    size_t offset = 0;
     int component_idx = 0;
 
-    while (
-        golioth_ota_get_status(component_idx++, &name, &current_version, &target_version, &state))
+    while (golioth_ota_get_status(component_idx++,
+                                  &name,
+                                  &current_version,
+                                  &target_version,
+                                  &state,
+                                  &offset))
     {
         uint8_t encode_buf[OTA_STATUS_ENCODE_BUF_SIZE];
         ZCBOR_STATE_E(zse, 1, encode_buf, sizeof(encode_buf), 1);
@@ -291,6 +609,16 @@ static void ota_uplink(void)
             }
         }
 
+        /* Lets the cloud resume an interrupted download instead of starting over */
+        if (GOLIOTH_OTA_STATE_DOWNLOADING == state && offset > 0)
+        {
+            ok = zcbor_tstr_put_lit(zse, "o") && zcbor_uint32_put(zse, offset);
+            if (!ok)
+            {
+                return;
+            }
+        }
+
         ok = zcbor_map_end_encode(zse, 1);
         if (!ok)
         {
@@ -314,7 +642,10 @@ static void ota_uplink(void)
     }
 }
 
-GOLIOTH_DOWNLINK_HANDLER(ota_manifest, GOLIOTH_OTA_MANIFEST_PATH, NULL, ota_receive_manifest);
+GOLIOTH_DOWNLINK_HANDLER(ota_manifest,
+                         GOLIOTH_OTA_MANIFEST_PATH,
+                         ota_receive_manifest_start,
+                         ota_receive_manifest);
 GOLIOTH_DOWNLINK_HANDLER(ota_component,
                          "/" GOLIOTH_OTA_COMPONENT_PATH_PREFIX "*",
                          ota_receive_component_start,
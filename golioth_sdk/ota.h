@@ -19,26 +19,47 @@ enum golioth_ota_state
     GOLIOTH_OTA_STATE_UPDATING,
 };
 
+enum golioth_ota_compression
+{
+    GOLIOTH_OTA_COMPRESSION_NONE,
+    GOLIOTH_OTA_COMPRESSION_HEATSHRINK,
+    GOLIOTH_OTA_COMPRESSION_UNSUPPORTED,
+};
+
 struct golioth_ota_component
 {
     char package[CONFIG_GOLIOTH_OTA_MAX_PACKAGE_NAME_LEN + 1];
     char version[CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN + 1];
+    /* SHA-256 hash and size of the target image, after decompression and patching */
     uint8_t hash[GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN];
     int32_t size;
+    /* Version the component is a patch against, empty for full images */
+    char delta_source[CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN + 1];
+    enum golioth_ota_compression compression;
 };
 
 /* To be implemented by upper half */
 
+/* Stage a component of the manifest being received */
 int golioth_ota_manifest_receive_one(const struct golioth_ota_component *component);
+/* Apply the staged components, once the whole manifest has been received and decoded */
 void golioth_ota_manifest_complete(void);
+/* Discard the staged components of an invalid or incomplete manifest */
+void golioth_ota_manifest_abort(void);
 int golioth_ota_receive_component(const char *name,
                                   const char *version,
                                   size_t offset,
                                   const void *data,
                                   size_t len,
                                   bool is_last);
+/* Stop a component download that failed before its data reached the receiver */
+void golioth_ota_receive_component_abort(const char *name);
 bool golioth_ota_get_status(int component_idx,
                             const char **name,
                             const char **current_version,
                             const char **target_version,
-                            enum golioth_ota_state *state);
+                            enum golioth_ota_state *state,
+                            size_t *offset);
+size_t golioth_ota_resume_offset(const char *name, const char *version);
+void golioth_ota_resume_reset(const char *name);
+bool golioth_ota_is_compressed(const char *name);
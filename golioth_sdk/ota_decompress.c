@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/util.h>
+
+#include "ota_decompress.h"
+
+enum
+{
+    DECOMPRESS_STATE_HEADER,
+    DECOMPRESS_STATE_TAG,
+    DECOMPRESS_STATE_LITERAL,
+    DECOMPRESS_STATE_DISTANCE,
+    DECOMPRESS_STATE_LENGTH,
+};
+
+/* Output is passed on lazily, so the last chunk can be flagged once the input ends */
+static int output_flush(struct ota_decompress *decompress, bool is_last)
+{
+    int err = decompress->write(decompress->out,
+                                decompress->out_len,
+                                is_last,
+                                decompress->user_data);
+
+    decompress->out_len = 0;
+
+    return err;
+}
+
+static int output_byte(struct ota_decompress *decompress, uint8_t byte)
+{
+    if (decompress->out_len == sizeof(decompress->out))
+    {
+        int err = output_flush(decompress, false);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    decompress->window[decompress->head & (BIT(decompress->window_bits) - 1)] = byte;
+    decompress->head++;
+    decompress->out[decompress->out_len++] = byte;
+
+    return 0;
+}
+
+static int back_reference(struct ota_decompress *decompress, size_t length)
+{
+    size_t mask = BIT(decompress->window_bits) - 1;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        uint8_t byte = decompress->window[(decompress->head - decompress->distance) & mask];
+
+        int err = output_byte(decompress, byte);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+static uint8_t field_len(const struct ota_decompress *decompress)
+{
+    switch (decompress->state)
+    {
+        case DECOMPRESS_STATE_TAG:
+            return 1;
+        case DECOMPRESS_STATE_LITERAL:
+            return 8;
+        case DECOMPRESS_STATE_DISTANCE:
+            return decompress->window_bits;
+        default:
+            return decompress->lookahead_bits;
+    }
+}
+
+static int field_complete(struct ota_decompress *decompress)
+{
+    uint16_t value = decompress->field;
+
+    decompress->field = 0;
+    decompress->field_bits = 0;
+
+    switch (decompress->state)
+    {
+        case DECOMPRESS_STATE_TAG:
+            decompress->state = value ? DECOMPRESS_STATE_LITERAL : DECOMPRESS_STATE_DISTANCE;
+            return 0;
+        case DECOMPRESS_STATE_LITERAL:
+            decompress->state = DECOMPRESS_STATE_TAG;
+            decompress->pending_bits = 0;
+            return output_byte(decompress, value);
+        case DECOMPRESS_STATE_DISTANCE:
+            decompress->distance = value + 1;
+            decompress->state = DECOMPRESS_STATE_LENGTH;
+            return 0;
+        default:
+            decompress->state = DECOMPRESS_STATE_TAG;
+            decompress->pending_bits = 0;
+            return back_reference(decompress, value + 1);
+    }
+}
+
+static int header_decode(struct ota_decompress *decompress, uint8_t header)
+{
+    uint8_t window_bits = header >> 4;
+    uint8_t lookahead_bits = header & 0x0f;
+
+    if (window_bits < 4 || lookahead_bits < 3 || lookahead_bits >= window_bits)
+    {
+        return -EBADMSG;
+    }
+
+    if (window_bits > CONFIG_GOLIOTH_OTA_DECOMPRESS_WINDOW_BITS)
+    {
+        return -ENOTSUP;
+    }
+
+    decompress->window_bits = window_bits;
+    decompress->lookahead_bits = lookahead_bits;
+    decompress->state = DECOMPRESS_STATE_TAG;
+
+    return 0;
+}
+
+void ota_decompress_init(struct ota_decompress *decompress,
+                         ota_decompress_write_cb write,
+                         void *user_data)
+{
+    memset(decompress, 0, sizeof(*decompress));
+
+    decompress->write = write;
+    decompress->user_data = user_data;
+}
+
+int ota_decompress_feed(struct ota_decompress *decompress, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < len && decompress->err == 0; i++)
+    {
+        if (decompress->state == DECOMPRESS_STATE_HEADER)
+        {
+            decompress->err = header_decode(decompress, bytes[i]);
+            continue;
+        }
+
+        for (int bit = 7; bit >= 0 && decompress->err == 0; bit--)
+        {
+            decompress->field = (decompress->field << 1) | ((bytes[i] >> bit) & 1);
+            decompress->field_bits++;
+            decompress->pending_bits = MIN(decompress->pending_bits + 1, UINT8_MAX);
+
+            if (decompress->field_bits == field_len(decompress))
+            {
+                decompress->err = field_complete(decompress);
+            }
+        }
+    }
+
+    return decompress->err;
+}
+
+int ota_decompress_finish(struct ota_decompress *decompress)
+{
+    if (decompress->err)
+    {
+        return decompress->err;
+    }
+
+    if (decompress->state == DECOMPRESS_STATE_HEADER || decompress->pending_bits >= 8)
+    {
+        return -EBADMSG;
+    }
+
+    return output_flush(decompress, true);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+/* Compressed components are a single header byte, followed by a heatshrink stream:
+ *
+ * header = window-bits << 4 | lookahead-bits
+ *
+ * The stream is read MSB first. A 1 bit is followed by a literal byte. A 0 bit is followed by a
+ * back reference: the distance - 1 in window-bits bits, and the length - 1 in lookahead-bits bits.
+ * Back references before the start of the output read zeros. Up to 7 bits of padding follow the
+ * last item.
+ */
+
+#define OTA_DECOMPRESS_WINDOW_SIZE BIT(CONFIG_GOLIOTH_OTA_DECOMPRESS_WINDOW_BITS)
+#define OTA_DECOMPRESS_OUT_BUF_SIZE 64
+
+/**
+ * Callback for decompressed data.
+ *
+ * @param data Decompressed data
+ * @param len Length of @p data
+ * @param is_last Whether this is the end of the decompressed data
+ * @param user_data User data passed to ota_decompress_init()
+ */
+typedef int (*ota_decompress_write_cb)(const void *data, size_t len, bool is_last, void *user_data);
+
+struct ota_decompress
+{
+    ota_decompress_write_cb write;
+    void *user_data;
+    int err;
+    uint8_t state;
+
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t window[OTA_DECOMPRESS_WINDOW_SIZE];
+    size_t head;
+
+    /* Field being read from the bit stream */
+    uint16_t field;
+    uint8_t field_bits;
+    /* Bits read since the last complete item, to detect truncated streams */
+    uint8_t pending_bits;
+    uint16_t distance;
+
+    uint8_t out[OTA_DECOMPRESS_OUT_BUF_SIZE];
+    size_t out_len;
+};
+
+void ota_decompress_init(struct ota_decompress *decompress,
+                         ota_decompress_write_cb write,
+                         void *user_data);
+
+/**
+ * Decompress the next chunk of data.
+ *
+ * @retval 0 The data was decompressed
+ * @retval -EBADMSG The header is invalid
+ * @retval -ENOTSUP The window is larger than CONFIG_GOLIOTH_OTA_DECOMPRESS_WINDOW_BITS
+ * @retval <0 Error returned from the write callback
+ */
+int ota_decompress_feed(struct ota_decompress *decompress, const void *data, size_t len);
+
+/**
+ * Pass the rest of the decompressed data to the write callback, with is_last set.
+ *
+ * @retval 0 The stream was complete
+ * @retval -EBADMSG The stream was truncated
+ * @retval <0 Earlier error
+ */
+int ota_decompress_finish(struct ota_decompress *decompress);
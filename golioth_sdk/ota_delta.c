@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/util.h>
+
+#include <golioth/ota_delta.h>
+
+/* Old image data is read in chunks of this size, which bounds the stack usage */
+#define DELTA_CHUNK_SIZE 64
+
+enum
+{
+    DELTA_STATE_MAGIC,
+    DELTA_STATE_TARGET_SIZE,
+    DELTA_STATE_DIFF_LEN,
+    DELTA_STATE_EXTRA_LEN,
+    DELTA_STATE_SEEK,
+    DELTA_STATE_DIFF,
+    DELTA_STATE_EXTRA,
+    DELTA_STATE_DONE,
+};
+
+/**
+ * Decode the next byte of a varint.
+ *
+ * @retval 1 The varint is complete
+ * @retval 0 More bytes are needed
+ * @retval -EBADMSG The varint doesn't fit in 64 bits
+ */
+static int varint_feed(struct golioth_ota_delta *delta, uint8_t byte)
+{
+    if (delta->pos >= 64 || (delta->pos == 63 && (byte & 0x7e)))
+    {
+        return -EBADMSG;
+    }
+
+    delta->varint |= (uint64_t) (byte & 0x7f) << delta->pos;
+    delta->pos += 7;
+
+    return (byte & 0x80) ? 0 : 1;
+}
+
+static void varint_reset(struct golioth_ota_delta *delta)
+{
+    delta->varint = 0;
+    delta->pos = 0;
+}
+
+/** Move on from a completed part of the current record */
+static int record_next(struct golioth_ota_delta *delta)
+{
+    if (delta->state == DELTA_STATE_SEEK && delta->diff_len > 0)
+    {
+        delta->state = DELTA_STATE_DIFF;
+        return 0;
+    }
+
+    if ((delta->state == DELTA_STATE_SEEK || delta->state == DELTA_STATE_DIFF)
+        && delta->extra_len > 0)
+    {
+        delta->state = DELTA_STATE_EXTRA;
+        return 0;
+    }
+
+    /* End of record */
+    if ((delta->seek < 0 && (uint64_t) -delta->seek > delta->old_pos)
+        || (delta->seek > 0 && (uint64_t) delta->seek > SIZE_MAX - delta->old_pos))
+    {
+        return -EBADMSG;
+    }
+
+    delta->old_pos += delta->seek;
+    delta->state =
+        (delta->written == delta->target_size) ? DELTA_STATE_DONE : DELTA_STATE_DIFF_LEN;
+
+    return 0;
+}
+
+static int header_feed(struct golioth_ota_delta *delta, uint8_t byte)
+{
+    if (delta->state == DELTA_STATE_MAGIC)
+    {
+        if (byte != GOLIOTH_OTA_DELTA_MAGIC[delta->pos])
+        {
+            return -EBADMSG;
+        }
+
+        if (++delta->pos == sizeof(GOLIOTH_OTA_DELTA_MAGIC) - 1)
+        {
+            delta->pos = 0;
+            delta->state = DELTA_STATE_TARGET_SIZE;
+        }
+
+        return 0;
+    }
+
+    int ret = varint_feed(delta, byte);
+    if (ret <= 0)
+    {
+        return ret;
+    }
+
+    uint64_t value = delta->varint;
+    size_t remaining = delta->target_size - delta->written;
+
+    varint_reset(delta);
+
+    switch (delta->state)
+    {
+        case DELTA_STATE_TARGET_SIZE:
+            if (value > SIZE_MAX)
+            {
+                return -EBADMSG;
+            }
+
+            delta->target_size = value;
+            delta->state = (value == 0) ? DELTA_STATE_DONE : DELTA_STATE_DIFF_LEN;
+            return 0;
+        case DELTA_STATE_DIFF_LEN:
+            if (value > remaining)
+            {
+                return -EBADMSG;
+            }
+
+            delta->diff_len = value;
+            delta->state = DELTA_STATE_EXTRA_LEN;
+            return 0;
+        case DELTA_STATE_EXTRA_LEN:
+            if (value > remaining - delta->diff_len)
+            {
+                return -EBADMSG;
+            }
+
+            delta->extra_len = value;
+            delta->state = DELTA_STATE_SEEK;
+            return 0;
+        case DELTA_STATE_SEEK:
+            /* Zigzag decoding */
+            delta->seek = (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+            return record_next(delta);
+        default:
+            return -EBADMSG;
+    }
+}
+
+static int diff_apply(struct golioth_ota_delta *delta, const uint8_t *data, size_t len)
+{
+    uint8_t buf[DELTA_CHUNK_SIZE];
+
+    int err = delta->read(delta->old_pos, buf, len, delta->user_data);
+    if (err)
+    {
+        return err;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] += data[i];
+    }
+
+    return delta->write(buf, len, delta->user_data);
+}
+
+void golioth_ota_delta_init(struct golioth_ota_delta *delta,
+                            golioth_ota_delta_read_cb read,
+                            golioth_ota_delta_write_cb write,
+                            void *user_data)
+{
+    memset(delta, 0, sizeof(*delta));
+
+    delta->read = read;
+    delta->write = write;
+    delta->user_data = user_data;
+}
+
+int golioth_ota_delta_feed(struct golioth_ota_delta *delta, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    while (len > 0 && delta->err == 0)
+    {
+        size_t n;
+
+        switch (delta->state)
+        {
+            case DELTA_STATE_DIFF:
+                n = MIN(MIN(len, delta->diff_len), DELTA_CHUNK_SIZE);
+
+                delta->err = diff_apply(delta, bytes, n);
+                delta->old_pos += n;
+                delta->written += n;
+                delta->diff_len -= n;
+                break;
+            case DELTA_STATE_EXTRA:
+                n = MIN(len, delta->extra_len);
+
+                delta->err = delta->write(bytes, n, delta->user_data);
+                delta->written += n;
+                delta->extra_len -= n;
+                break;
+            case DELTA_STATE_DONE:
+                delta->err = -EBADMSG;
+                return delta->err;
+            default:
+                n = 1;
+
+                delta->err = header_feed(delta, bytes[0]);
+                break;
+        }
+
+        bytes += n;
+        len -= n;
+
+        if (delta->err == 0
+            && ((delta->state == DELTA_STATE_DIFF && delta->diff_len == 0)
+                || (delta->state == DELTA_STATE_EXTRA && delta->extra_len == 0)))
+        {
+            delta->err = record_next(delta);
+        }
+    }
+
+    return delta->err;
+}
+
+int golioth_ota_delta_finish(struct golioth_ota_delta *delta)
+{
+    if (delta->err)
+    {
+        return delta->err;
+    }
+
+    return (delta->state == DELTA_STATE_DONE) ? 0 : -EBADMSG;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(ota_flash_img, CONFIG_GOLIOTH_LOG_LEVEL);
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/util.h>
+
+#include <golioth/ota_flash_img.h>
+
+#define FLASH_IMG_PROGRESS_KEY_PREFIX "golioth/flash_img/"
+#define FLASH_IMG_REHASH_CHUNK_SIZE 64
+
+/* The write position can only be restored through the stream_flash progress API, so downloads are
+ * only resumed part way when the progress is stored with it.
+ */
+#if defined(CONFIG_GOLIOTH_OTA_RESUME) && defined(CONFIG_STREAM_FLASH_PROGRESS)
+#define FLASH_IMG_PERSIST_PROGRESS 1
+#define FLASH_IMG_PROGRESS_INTERVAL CONFIG_GOLIOTH_OTA_RESUME_SAVE_INTERVAL
+#define FLASH_IMG_PROGRESS_KEY(_key, _component)                                     \
+    char _key[sizeof(FLASH_IMG_PROGRESS_KEY_PREFIX)                                  \
+              + CONFIG_GOLIOTH_OTA_MAX_PACKAGE_NAME_LEN];                            \
+    snprintf(_key, sizeof(_key), FLASH_IMG_PROGRESS_KEY_PREFIX "%s", (_component)->name)
+#else
+#define FLASH_IMG_PERSIST_PROGRESS 0
+#endif
+
+static int hash_start(struct golioth_ota_flash_img *img)
+{
+    psa_hash_abort(&img->hash);
+    img->hash = psa_hash_operation_init();
+
+    psa_status_t status = psa_hash_setup(&img->hash, PSA_ALG_SHA_256);
+    if (status != PSA_SUCCESS)
+    {
+        LOG_ERR("Failed to start hash: %d", status);
+        return -EIO;
+    }
+
+    return 0;
+}
+
+/** Hash the part of the image that is already in flash */
+static int hash_flash(struct golioth_ota_flash_img *img, size_t len)
+{
+    uint8_t buf[FLASH_IMG_REHASH_CHUNK_SIZE];
+
+    for (size_t offset = 0; offset < len; offset += sizeof(buf))
+    {
+        size_t chunk_len = MIN(sizeof(buf), len - offset);
+
+        int err = flash_area_read(img->flash.flash_area, offset, buf, chunk_len);
+        if (err)
+        {
+            return err;
+        }
+
+        psa_status_t status = psa_hash_update(&img->hash, buf, chunk_len);
+        if (status != PSA_SUCCESS)
+        {
+            return -EIO;
+        }
+    }
+
+    return 0;
+}
+
+/** Hash and write the next part of the image, without flushing the write buffer */
+static int image_write(struct golioth_ota_flash_img *img, const void *data, size_t len)
+{
+    /* Hash the data while it is still in RAM, so the image never has to be read back */
+    psa_status_t status = psa_hash_update(&img->hash, data, len);
+    if (status != PSA_SUCCESS)
+    {
+        return -EIO;
+    }
+
+    int err = flash_img_buffered_write(&img->flash, data, len, false);
+    if (err)
+    {
+        LOG_ERR("Failed to write to flash: %d", err);
+        return err;
+    }
+
+    img->written += len;
+
+    return 0;
+}
+
+#if defined(CONFIG_GOLIOTH_OTA_DELTA)
+
+static int delta_read(size_t offset, void *buf, size_t len, void *user_data)
+{
+    struct golioth_ota_flash_img *img = user_data;
+
+    return flash_area_read(img->source, offset, buf, len);
+}
+
+static int delta_write(const void *data, size_t len, void *user_data)
+{
+    return image_write(user_data, data, len);
+}
+
+static int delta_start(struct golioth_ota_flash_img *img)
+{
+    if (NULL == img->source)
+    {
+        int err = flash_area_open(FIXED_PARTITION_ID(slot0_partition), &img->source);
+        if (err)
+        {
+            LOG_ERR("Failed to open primary slot: %d", err);
+            return err;
+        }
+    }
+
+    golioth_ota_delta_init(&img->delta, delta_read, delta_write, img);
+
+    return 0;
+}
+
+#endif /* CONFIG_GOLIOTH_OTA_DELTA */
+
+/** Prepare the writer for a block at @p offset that doesn't continue the previous block */
+static int restart(struct golioth_ota_flash_img *img,
+                   const struct golioth_ota_registered_component *component,
+                   size_t offset)
+{
+    int err;
+
+    if (component->data->delta)
+    {
+#if defined(CONFIG_GOLIOTH_OTA_DELTA)
+        /* The patch decoder state isn't kept, so patches always start over */
+        if (0 != offset)
+        {
+            LOG_ERR("Can't continue %s patch at offset %zu", component->name, offset);
+            return -ESPIPE;
+        }
+
+        err = delta_start(img);
+        if (err)
+        {
+            return err;
+        }
+#else
+        LOG_ERR("Patches not supported for %s", component->name);
+        return -ENOTSUP;
+#endif
+    }
+
+    /* Data buffered after the last committed offset is dropped, as a restarted download sends it
+     * again.
+     */
+    err = flash_img_init(&img->flash);
+    if (err)
+    {
+        LOG_ERR("Failed to init flash write: %d", err);
+        return err;
+    }
+
+    img->saved_offset = 0;
+
+#if FLASH_IMG_PERSIST_PROGRESS
+    if (0 != offset)
+    {
+        FLASH_IMG_PROGRESS_KEY(key, component);
+
+        /* Restores the write position, and which flash pages have already been erased */
+        err = stream_flash_progress_load(&img->flash.stream, key);
+        if (err)
+        {
+            return err;
+        }
+
+        img->saved_offset = flash_img_bytes_written(&img->flash);
+    }
+#endif
+
+    if (flash_img_bytes_written(&img->flash) != offset)
+    {
+        LOG_ERR("Can't continue %s at offset %zu, %zu bytes written",
+                component->name,
+                offset,
+                flash_img_bytes_written(&img->flash));
+        return -ESPIPE;
+    }
+
+    err = hash_start(img);
+    if (err)
+    {
+        return err;
+    }
+
+    err = hash_flash(img, offset);
+    if (err)
+    {
+        LOG_ERR("Failed to hash written image: %d", err);
+        return err;
+    }
+
+    img->received = offset;
+    img->written = offset;
+    img->active = true;
+
+    return 0;
+}
+
+/** Report the committed offset, once the write position it was committed at has been stored */
+static void progress_report(struct golioth_ota_flash_img *img,
+                            const struct golioth_ota_registered_component *component)
+{
+#if FLASH_IMG_PERSIST_PROGRESS
+    size_t written = flash_img_bytes_written(&img->flash);
+
+    if (written - img->saved_offset < FLASH_IMG_PROGRESS_INTERVAL)
+    {
+        return;
+    }
+
+    FLASH_IMG_PROGRESS_KEY(key, component);
+
+    int err = stream_flash_progress_save(&img->flash.stream, key);
+    if (err)
+    {
+        LOG_WRN("Failed to store flash progress: %d", err);
+        return;
+    }
+
+    img->saved_offset = written;
+    golioth_ota_download_progress(component->name, written);
+#endif
+}
+
+static void progress_clear(struct golioth_ota_flash_img *img,
+                           const struct golioth_ota_registered_component *component)
+{
+#if FLASH_IMG_PERSIST_PROGRESS
+    FLASH_IMG_PROGRESS_KEY(key, component);
+
+    stream_flash_progress_clear(&img->flash.stream, key);
+#endif
+
+    img->saved_offset = 0;
+}
+
+int golioth_ota_flash_img_write(struct golioth_ota_flash_img *img,
+                                const struct golioth_ota_registered_component *component,
+                                const void *data,
+                                size_t offset,
+                                size_t len,
+                                bool is_last)
+{
+    int err;
+
+    if (0 == offset || !img->active || offset != img->received)
+    {
+        err = restart(img, component, offset);
+        if (err)
+        {
+            goto fail;
+        }
+    }
+
+    if (component->data->delta)
+    {
+#if defined(CONFIG_GOLIOTH_OTA_DELTA)
+        err = golioth_ota_delta_feed(&img->delta, data, len);
+#else
+        err = -ENOTSUP;
+#endif
+    }
+    else
+    {
+        err = image_write(img, data, len);
+    }
+
+    if (err)
+    {
+        goto fail;
+    }
+
+    img->received += len;
+
+    /* Verify the image before flushing the last write, so a corrupted image is never completed */
+    if (is_last)
+    {
+#if defined(CONFIG_GOLIOTH_OTA_DELTA)
+        if (component->data->delta)
+        {
+            err = golioth_ota_delta_finish(&img->delta);
+            if (err)
+            {
+                LOG_ERR("Incomplete patch for %s: %d", component->name, err);
+                err = -EBADMSG;
+                goto fail;
+            }
+        }
+#endif
+
+        /* The manifest size and hash both describe the image written to flash, after
+         * decompression and patching, not the artifact that was downloaded.
+         */
+        if (0 != component->data->size && img->written != component->data->size)
+        {
+            LOG_ERR("Size mismatch for %s: %zu, expected %zu",
+                    component->name,
+                    img->written,
+                    component->data->size);
+            err = -EBADMSG;
+            goto fail;
+        }
+
+        psa_status_t status = psa_hash_verify(&img->hash,
+                                              component->data->target_hash,
+                                              GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN);
+        if (status != PSA_SUCCESS)
+        {
+            LOG_ERR("Hash mismatch for %s: %d", component->name, status);
+            err = -EBADMSG;
+            goto fail;
+        }
+
+        err = flash_img_buffered_write(&img->flash, NULL, 0, true);
+        if (err)
+        {
+            LOG_ERR("Failed to write to flash: %d", err);
+            goto fail;
+        }
+
+        progress_clear(img, component);
+        img->active = false;
+        return 0;
+    }
+
+    /* The offset in a patch doesn't correspond to any offset in the image */
+    if (!component->data->delta)
+    {
+        progress_report(img, component);
+    }
+
+    return 0;
+
+fail:
+    psa_hash_abort(&img->hash);
+    img->active = false;
+
+    /* Don't resume a corrupted image */
+    if (-EBADMSG == err)
+    {
+        progress_clear(img, component);
+    }
+
+    return err;
+}
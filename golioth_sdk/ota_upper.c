@@ -7,29 +7,159 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ota_upper, CONFIG_GOLIOTH_LOG_LEVEL);
 
+#include <stdio.h>
+#include <string.h>
+
 #include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
 
 #include <golioth/ota.h>
 
 #include "ota.h"
 
-/* Public interface to application */
+#define OTA_PROGRESS_SETTINGS_ROOT "golioth/ota"
 
-static int golioth_ota_set_status(const char *name, enum golioth_ota_state state)
+static struct golioth_ota_registered_component *registered_component_get(const char *name)
 {
-    int ret = -ENOENT;
-
     STRUCT_SECTION_FOREACH(golioth_ota_registered_component, component)
     {
         if (0 == strcmp(component->name, name))
         {
-            component->data->state = state;
-            ret = 0;
-            break;
+            return component;
         }
     }
 
-    return ret;
+    return NULL;
+}
+
+#if defined(CONFIG_GOLIOTH_OTA_RESUME)
+
+/* Download progress, stored under golioth/ota/<component name> */
+struct ota_progress
+{
+    char target[CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN];
+    uint8_t target_hash[GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN];
+    uint32_t offset;
+};
+
+static void ota_progress_save(struct golioth_ota_registered_component *component)
+{
+    char key[sizeof(OTA_PROGRESS_SETTINGS_ROOT "/") + CONFIG_GOLIOTH_OTA_MAX_PACKAGE_NAME_LEN];
+    int err;
+
+    snprintf(key, sizeof(key), OTA_PROGRESS_SETTINGS_ROOT "/%s", component->name);
+
+    if (0 == component->data->offset)
+    {
+        err = settings_delete(key);
+    }
+    else
+    {
+        struct ota_progress progress = {
+            .offset = component->data->offset,
+        };
+
+        strncpy(progress.target, component->data->target, sizeof(progress.target) - 1);
+        memcpy(progress.target_hash,
+               component->data->target_hash,
+               GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN);
+
+        err = settings_save_one(key, &progress, sizeof(progress));
+    }
+
+    if (err)
+    {
+        LOG_WRN("Failed to store download progress for %s: %d", component->name, err);
+        return;
+    }
+
+    component->data->saved_offset = component->data->offset;
+}
+
+static int ota_progress_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    struct golioth_ota_registered_component *component = registered_component_get(name);
+    if (NULL == component)
+    {
+        return 0;
+    }
+
+    struct ota_progress progress;
+    if (len != sizeof(progress))
+    {
+        return -EINVAL;
+    }
+
+    ssize_t ret = read_cb(cb_arg, &progress, sizeof(progress));
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    progress.target[sizeof(progress.target) - 1] = '\0';
+
+    strncpy(component->data->target, progress.target, sizeof(component->data->target) - 1);
+    memcpy(component->data->target_hash,
+           progress.target_hash,
+           GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN);
+    component->data->offset = progress.offset;
+    component->data->saved_offset = progress.offset;
+    component->data->state = GOLIOTH_OTA_STATE_DOWNLOADING;
+
+    LOG_INF("Restored download of %s@%s at offset %u", name, progress.target, progress.offset);
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(golioth_ota,
+                               OTA_PROGRESS_SETTINGS_ROOT,
+                               NULL,
+                               ota_progress_set,
+                               NULL,
+                               NULL);
+
+#endif /* CONFIG_GOLIOTH_OTA_RESUME */
+
+static void ota_progress_update(struct golioth_ota_registered_component *component, size_t offset)
+{
+    component->data->offset = offset;
+
+#if defined(CONFIG_GOLIOTH_OTA_RESUME)
+    /* Limit flash wear by only storing the progress once in a while */
+    if (0 == offset || offset < component->data->saved_offset
+        || offset - component->data->saved_offset >= CONFIG_GOLIOTH_OTA_RESUME_SAVE_INTERVAL)
+    {
+        ota_progress_save(component);
+    }
+#endif
+}
+
+static void ota_progress_reset(struct golioth_ota_registered_component *component)
+{
+    if (0 != component->data->offset || 0 != component->data->saved_offset)
+    {
+        ota_progress_update(component, 0);
+    }
+}
+
+/* Public interface to application */
+
+static int golioth_ota_set_status(const char *name, enum golioth_ota_state state)
+{
+    struct golioth_ota_registered_component *component = registered_component_get(name);
+    if (NULL == component)
+    {
+        return -ENOENT;
+    }
+
+    component->data->state = state;
+
+    if (GOLIOTH_OTA_STATE_DOWNLOADING != state)
+    {
+        ota_progress_reset(component);
+    }
+
+    return 0;
 }
 
 int golioth_ota_mark_for_download(const char *name)
@@ -47,6 +177,30 @@ int golioth_ota_mark_updating(const char *name)
     return golioth_ota_set_status(name, GOLIOTH_OTA_STATE_UPDATING);
 }
 
+int golioth_ota_download_progress(const char *name, size_t offset)
+{
+    struct golioth_ota_registered_component *component = registered_component_get(name);
+    if (NULL == component)
+    {
+        return -ENOENT;
+    }
+
+    if (GOLIOTH_OTA_STATE_DOWNLOADING != component->data->state)
+    {
+        return -EINVAL;
+    }
+
+    /* Compressed streams can't be resumed at an offset in the decompressed data */
+    if (component->data->compressed)
+    {
+        return 0;
+    }
+
+    ota_progress_update(component, offset);
+
+    return 0;
+}
+
 /* Interface to OTA lower half */
 
 int golioth_ota_manifest_receive_one(const struct golioth_ota_component *component)
@@ -56,24 +210,86 @@ int golioth_ota_manifest_receive_one(const struct golioth_ota_component *compone
     LOG_DBG("  version: %s", component->version);
     LOG_DBG("  size: %d", component->size);
 
+    bool delta = ('\0' != component->delta_source[0]);
+    bool compressed = (GOLIOTH_OTA_COMPRESSION_NONE != component->compression);
+
+    if (GOLIOTH_OTA_COMPRESSION_UNSUPPORTED == component->compression
+        || (compressed && !IS_ENABLED(CONFIG_GOLIOTH_OTA_DECOMPRESS)))
+    {
+        LOG_WRN("Ignoring %s, compression not supported", component->package);
+        return 0;
+    }
+
     STRUCT_SECTION_FOREACH(golioth_ota_registered_component, registered)
     {
         if (0 == strcmp(component->package, registered->name))
         {
-            strncpy(registered->data->target, component->version, sizeof(registered->data->target));
-            registered->data->target[sizeof(registered->data->target) - 1] = '\0';
-            memcpy(registered->data->target_hash,
+            /* The decompressor can't pause halfway through its input */
+            if (compressed && NULL != registered->receive_async)
+            {
+                LOG_WRN("Ignoring %s, compression not supported for asynchronous components",
+                        registered->name);
+                continue;
+            }
+
+            if (delta && 0 != strcmp(component->delta_source, registered->version))
+            {
+                LOG_WRN("Ignoring %s patch against %s, running %s",
+                        registered->name,
+                        component->delta_source,
+                        registered->version);
+                continue;
+            }
+
+            strncpy(registered->data->manifest.target,
+                    component->version,
+                    sizeof(registered->data->manifest.target));
+            registered->data->manifest.target[sizeof(registered->data->manifest.target) - 1] = '\0';
+            memcpy(registered->data->manifest.target_hash,
                    component->hash,
                    GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN);
-            registered->data->size = component->size;
+            registered->data->manifest.size = component->size;
+            registered->data->manifest.delta = delta;
+            registered->data->manifest.compressed = compressed;
+            registered->data->manifest.staged = true;
         }
     }
 
     return 0;
 }
 
+static void manifest_entry_apply(struct golioth_ota_registered_component *registered)
+{
+    struct golioth_ota_registered_component_data *data = registered->data;
+
+    /* Progress made on a different artifact can't be resumed */
+    if (0 != strcmp(data->target, data->manifest.target)
+        || 0 != memcmp(data->target_hash,
+                       data->manifest.target_hash,
+                       GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN)
+        || data->manifest.delta != data->delta || data->manifest.compressed != data->compressed)
+    {
+        ota_progress_reset(registered);
+    }
+
+    memcpy(data->target, data->manifest.target, sizeof(data->target));
+    memcpy(data->target_hash, data->manifest.target_hash, GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN);
+    data->size = data->manifest.size;
+    data->delta = data->manifest.delta;
+    data->compressed = data->manifest.compressed;
+    data->manifest.staged = false;
+}
+
 void golioth_ota_manifest_complete(void)
 {
+    STRUCT_SECTION_FOREACH(golioth_ota_registered_component, registered)
+    {
+        if (registered->data->manifest.staged)
+        {
+            manifest_entry_apply(registered);
+        }
+    }
+
     size_t num_components = 0;
     STRUCT_SECTION_COUNT(golioth_ota_registered_component, &num_components);
     struct golioth_ota_manifest_component components[num_components];
@@ -87,6 +303,7 @@ void golioth_ota_manifest_complete(void)
         components[i].target = registered->data->target;
         components[i].target_hash = registered->data->target_hash;
         components[i].size = registered->data->size;
+        components[i].delta = registered->data->delta;
     }
 
     STRUCT_SECTION_FOREACH(golioth_ota_manifest_handler, handler)
@@ -95,6 +312,14 @@ void golioth_ota_manifest_complete(void)
     }
 }
 
+void golioth_ota_manifest_abort(void)
+{
+    STRUCT_SECTION_FOREACH(golioth_ota_registered_component, registered)
+    {
+        registered->data->manifest.staged = false;
+    }
+}
+
 int golioth_ota_receive_component(const char *name,
                                   const char *version,
                                   size_t offset,
@@ -110,7 +335,26 @@ int golioth_ota_receive_component(const char *name,
         {
             if (registered->data->state == GOLIOTH_OTA_STATE_DOWNLOADING)
             {
-                registered->receive(data, offset, len, is_last);
+                int ret = 0;
+
+                if (NULL != registered->receive_async)
+                {
+                    ret = registered->receive_async(data, offset, len, is_last);
+                }
+                else
+                {
+                    registered->receive(data, offset, len, is_last);
+                }
+
+                if (is_last)
+                {
+                    ota_progress_reset(registered);
+                }
+
+                if (-EINPROGRESS == ret)
+                {
+                    return ret;
+                }
             }
             else
             {
@@ -123,11 +367,23 @@ int golioth_ota_receive_component(const char *name,
     return 0;
 }
 
+void golioth_ota_receive_component_abort(const char *name)
+{
+    /* The receiver never sees the end of the component, so the download is stopped here, and the
+     * application has to mark the component for download again.
+     */
+    if (0 == golioth_ota_set_status(name, GOLIOTH_OTA_STATE_IDLE))
+    {
+        LOG_WRN("Download of %s failed, marked as idle", name);
+    }
+}
+
 bool golioth_ota_get_status(int component_idx,
                             const char **name,
                             const char **current_version,
                             const char **target_version,
-                            enum golioth_ota_state *state)
+                            enum golioth_ota_state *state,
+                            size_t *offset)
 {
     int count = 0;
     STRUCT_SECTION_COUNT(golioth_ota_registered_component, &count);
@@ -143,6 +399,35 @@ bool golioth_ota_get_status(int component_idx,
     *current_version = component->version;
     *target_version = component->data->target;
     *state = component->data->state;
+    *offset = component->data->offset;
 
     return true;
 }
+
+bool golioth_ota_is_compressed(const char *name)
+{
+    struct golioth_ota_registered_component *component = registered_component_get(name);
+
+    return NULL != component && component->data->compressed;
+}
+
+size_t golioth_ota_resume_offset(const char *name, const char *version)
+{
+    struct golioth_ota_registered_component *component = registered_component_get(name);
+    if (NULL == component || GOLIOTH_OTA_STATE_DOWNLOADING != component->data->state
+        || 0 != strcmp(component->data->target, version))
+    {
+        return 0;
+    }
+
+    return component->data->offset;
+}
+
+void golioth_ota_resume_reset(const char *name)
+{
+    struct golioth_ota_registered_component *component = registered_component_get(name);
+    if (NULL != component)
+    {
+        ota_progress_reset(component);
+    }
+}
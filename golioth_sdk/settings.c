@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(glth_settings, CONFIG_GOLIOTH_LOG_LEVEL);
 
@@ -11,9 +13,9 @@ LOG_MODULE_REGISTER(glth_settings, CONFIG_GOLIOTH_LOG_LEVEL);
 
 #include <pouch/types.h>
 #include <pouch/uplink.h>
-#include <zcbor_utils.h>
+#include <zcbor_stream.h>
 
-#include <zcbor_decode.h>
+#include <zcbor_encode.h>
 
 #include <golioth/settings_types.h>
 
@@ -27,137 +29,240 @@ LOG_MODULE_REGISTER(glth_settings, CONFIG_GOLIOTH_LOG_LEVEL);
 
 static int64_t settings_version = -1;
 
-static int settings_decode(zcbor_state_t *zsd, void *value)
+enum settings_field
 {
-    struct zcbor_string label;
-    bool ok;
+    SETTINGS_FIELD_UNKNOWN,
+    SETTINGS_FIELD_SETTINGS,
+    SETTINGS_FIELD_VERSION,
+};
 
-    if (zcbor_nil_expect(zsd, NULL))
+/* Settings downlink format:
+ *
+ * {
+ *     "settings": { <name>: <value>, ... } / nil,
+ *     "version": int,
+ * }
+ *
+ * The map is decoded as it arrives, so it may span any number of blocks.
+ */
+static struct
+{
+    struct zcbor_stream stream;
+    enum settings_field field;
+    /* Only reported once the whole map has been decoded */
+    int64_t version;
+    char field_name[sizeof("settings")];
+    char key[GOLIOTH_SETTINGS_MAX_NAME_LEN + 1];
+    bool key_valid;
+    /* Only used for string values that are split across blocks */
+    char str[CONFIG_GOLIOTH_SETTINGS_MAX_STRING_LEN + 1];
+    bool str_valid;
+} settings_decoder;
+
+static void settings_field_decode(const struct zcbor_stream_item *item)
+{
+    if (item->type != ZCBOR_STREAM_TSTR)
     {
-        /* No settings are set */
-        return -ENOENT;
+        settings_decoder.field = SETTINGS_FIELD_UNKNOWN;
+        return;
     }
 
-    ok = zcbor_map_start_decode(zsd);
-    if (!ok)
+    int err = zcbor_stream_str_copy(item,
+                                    settings_decoder.field_name,
+                                    sizeof(settings_decoder.field_name));
+    if (err || !zcbor_stream_str_is_complete(item))
     {
-        LOG_WRN("Did not start CBOR list correctly");
-        return -EBADMSG;
+        settings_decoder.field = SETTINGS_FIELD_UNKNOWN;
+        return;
     }
 
-    while (!zcbor_list_or_map_end(zsd))
+    if (strcmp(settings_decoder.field_name, "settings") == 0)
     {
-        struct setting_value value;
-        memset(&value, 0, sizeof(value));
-
-        bool data_type_valid = true;
+        settings_decoder.field = SETTINGS_FIELD_SETTINGS;
+    }
+    else if (strcmp(settings_decoder.field_name, "version") == 0)
+    {
+        settings_decoder.field = SETTINGS_FIELD_VERSION;
+    }
+    else
+    {
+        settings_decoder.field = SETTINGS_FIELD_UNKNOWN;
+    }
+}
 
-        /* Handle item */
-        ok = zcbor_tstr_decode(zsd, &label);
-        if (!ok)
-        {
-            LOG_ERR("Failed to get label");
-            return -EBADMSG;
-        }
+static void setting_key_decode(const struct zcbor_stream_item *item)
+{
+    if (item->type != ZCBOR_STREAM_TSTR)
+    {
+        LOG_ERR("Failed to get label");
+        settings_decoder.key_valid = false;
+        return;
+    }
 
-        char key[GOLIOTH_SETTINGS_MAX_NAME_LEN + 1] = {};
+    if (item->str.offset == 0)
+    {
+        settings_decoder.key_valid = true;
+    }
 
-        /* Copy setting label/name and ensure it's NULL-terminated */
-        memcpy(key, label.value, MIN(GOLIOTH_SETTINGS_MAX_NAME_LEN, label.len));
+    int err = zcbor_stream_str_copy(item, settings_decoder.key, sizeof(settings_decoder.key));
+    if (err)
+    {
+        settings_decoder.key_valid = false;
+    }
+}
 
-        value.key = key;
+static void setting_value_decode(const struct zcbor_stream_item *item)
+{
+    struct setting_value value = {
+        .key = settings_decoder.key,
+    };
 
-        zcbor_major_type_t major_type = ZCBOR_MAJOR_TYPE(*zsd->payload);
+    if (!settings_decoder.key_valid)
+    {
+        return;
+    }
 
-        switch (major_type)
-        {
-            case ZCBOR_MAJOR_TYPE_TSTR:
+    switch (item->type)
+    {
+        case ZCBOR_STREAM_TSTR:
+            if (item->str.offset == 0 && zcbor_stream_str_is_complete(item))
             {
-                struct zcbor_string str;
-
-                ok = zcbor_tstr_decode(zsd, &str);
-                if (!ok)
-                {
-                    data_type_valid = false;
-                    break;
-                }
-
-                value.type = GOLIOTH_SETTING_VALUE_TYPE_STRING;
-                value.str_val.data = str.value;
-                value.str_val.len = str.len;
-                break;
+                /* The entire string is in this block, no need to copy it */
+                value.str_val.data = item->str.value.value;
+                value.str_val.len = item->str.value.len;
             }
-            case ZCBOR_MAJOR_TYPE_PINT:
-            case ZCBOR_MAJOR_TYPE_NINT:
+            else
             {
-                value.type = GOLIOTH_SETTING_VALUE_TYPE_INT;
-                ok = zcbor_int32_decode(zsd, &value.int_val);
-                if (!ok)
+                if (item->str.offset == 0)
                 {
-                    data_type_valid = false;
-                    break;
+                    settings_decoder.str_valid = true;
                 }
 
-                break;
-            }
-            case ZCBOR_MAJOR_TYPE_SIMPLE:
-            {
-                if (zcbor_float_decode(zsd, &value.float_val))
-                {
-                    value.type = GOLIOTH_SETTING_VALUE_TYPE_FLOAT;
-                }
-                else if (zcbor_bool_decode(zsd, &value.bool_val))
+                int err =
+                    zcbor_stream_str_copy(item, settings_decoder.str, sizeof(settings_decoder.str));
+                if (err)
                 {
-                    value.type = GOLIOTH_SETTING_VALUE_TYPE_BOOL;
+                    if (settings_decoder.str_valid)
+                    {
+                        LOG_WRN("Setting %s is too long", settings_decoder.key);
+                    }
+
+                    settings_decoder.str_valid = false;
                 }
-                else
+
+                if (!settings_decoder.str_valid || !zcbor_stream_str_is_complete(item))
                 {
-                    data_type_valid = false;
+                    return;
                 }
-                break;
+
+                value.str_val.data = settings_decoder.str;
+                value.str_val.len = item->str.total_len;
             }
-            default:
-                data_type_valid = false;
-                break;
-        }
 
-        if (data_type_valid)
-        {
-            golioth_settings_receive_one(&value);
-        }
-        else
-        {
-            ok = zcbor_any_skip(zsd, NULL);
-            if (!ok)
+            value.type = GOLIOTH_SETTING_VALUE_TYPE_STRING;
+            break;
+        case ZCBOR_STREAM_INT:
+            if (item->i64 < INT32_MIN || item->i64 > INT32_MAX)
             {
-                LOG_ERR("Failed to skip unsupported type");
-                return -EBADMSG;
+                return;
             }
-        }
+
+            value.type = GOLIOTH_SETTING_VALUE_TYPE_INT;
+            value.int_val = item->i64;
+            break;
+        case ZCBOR_STREAM_FLOAT:
+            value.type = GOLIOTH_SETTING_VALUE_TYPE_FLOAT;
+            value.float_val = item->f64;
+            break;
+        case ZCBOR_STREAM_BOOL:
+            value.type = GOLIOTH_SETTING_VALUE_TYPE_BOOL;
+            value.bool_val = item->boolean;
+            break;
+        default:
+            /* Unsupported type */
+            return;
     }
 
-    ok = zcbor_map_end_decode(zsd);
-    if (!ok)
+    golioth_settings_receive_one(&value);
+}
+
+static int settings_item_decode(const struct zcbor_stream_item *item, void *user_data)
+{
+    switch (item->depth)
     {
-        LOG_WRN("Did not end CBOR list correctly");
-        return -EBADMSG;
+        case 0:
+            if (item->type != ZCBOR_STREAM_MAP_START && item->type != ZCBOR_STREAM_CONTAINER_END)
+            {
+                LOG_WRN("Did not start CBOR map correctly");
+                return -EBADMSG;
+            }
+            break;
+        case 1:
+            if (item->is_key)
+            {
+                settings_field_decode(item);
+            }
+            else if (settings_decoder.field == SETTINGS_FIELD_VERSION
+                     && item->type == ZCBOR_STREAM_INT)
+            {
+                settings_decoder.version = item->i64;
+            }
+            else if (settings_decoder.field == SETTINGS_FIELD_SETTINGS
+                     && item->type == ZCBOR_STREAM_NIL)
+            {
+                LOG_DBG("No settings are set");
+            }
+            break;
+        case 2:
+            if (settings_decoder.field != SETTINGS_FIELD_SETTINGS)
+            {
+                break;
+            }
+
+            if (item->is_key)
+            {
+                setting_key_decode(item);
+            }
+            else
+            {
+                setting_value_decode(item);
+            }
+            break;
+        default:
+            /* Nested values aren't supported, and are skipped */
+            break;
     }
 
     return 0;
 }
 
-static void settings_downlink(golioth_downlink_id_t id, const void *data, size_t len, bool is_last)
+static void settings_downlink_start(golioth_downlink_id_t id, const char *path_remainder)
+{
+    zcbor_stream_init(&settings_decoder.stream, settings_item_decode, NULL);
+    settings_decoder.field = SETTINGS_FIELD_UNKNOWN;
+    settings_decoder.version = settings_version;
+}
+
+static int settings_downlink(golioth_downlink_id_t id, const void *data, size_t len, bool is_last)
 {
     LOG_DBG("Received settings downlink");
 
-    ZCBOR_STATE_D(zsd, 2, data, len, 1, 0);
+    zcbor_stream_feed(&settings_decoder.stream, data, len);
 
-    struct zcbor_map_entry map_entries[] = {
-        ZCBOR_TSTR_LIT_MAP_ENTRY("settings", settings_decode, NULL),
-        ZCBOR_TSTR_LIT_MAP_ENTRY("version", zcbor_map_int64_decode, &settings_version),
-    };
+    if (is_last)
+    {
+        int err = zcbor_stream_finish(&settings_decoder.stream);
+        if (err)
+        {
+            /* Keep reporting the old version, so the server sends the settings again */
+            LOG_ERR("Failed to decode settings: %d", err);
+            return 0;
+        }
 
-    zcbor_map_decode(zsd, map_entries, ARRAY_SIZE(map_entries));
+        settings_version = settings_decoder.version;
+    }
+
+    return 0;
 }
 
 static void settings_uplink(void)
@@ -212,5 +317,8 @@ static void settings_uplink(void)
                              K_FOREVER);
 }
 
-GOLIOTH_DOWNLINK_HANDLER(settings, SETTINGS_DOWNLINK_PATH, NULL, settings_downlink);
+GOLIOTH_DOWNLINK_HANDLER(settings,
+                         SETTINGS_DOWNLINK_PATH,
+                         settings_downlink_start,
+                         settings_downlink);
 GOLIOTH_UPLINK_HANDLER(settings_status, settings_uplink);
@@ -4,6 +4,12 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include <zephyr/sys/iterable_sections.h>
 
 #define GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN 32
@@ -15,8 +21,11 @@ struct golioth_ota_manifest_component
     const char *name;
     const char *current;
     const char *target;
+    /* SHA-256 hash and size of the target image, after decompression and patching */
     const uint8_t *target_hash;
     size_t size;
+    /* The component is sent as a patch against the current version */
+    bool delta;
 };
 
 /** Callback for receiving an OTA manifest.
@@ -53,6 +62,9 @@ struct golioth_ota_manifest_handler
 /**
  * Callback for receiving data for a registered OTA component.
  *
+ * When an interrupted download is resumed, the first block starts at the
+ * offset last reported through golioth_ota_download_progress(), instead of 0.
+ *
  * @param data Pointer to a block of the component.
  * @param offset Offset of \ref data within the component.
  * @param len Length of \ref data.
@@ -63,12 +75,51 @@ typedef void (*golioth_ota_component_receive)(const void *data,
                                               size_t len,
                                               bool is_last);
 
+/**
+ * Callback for receiving data for a registered OTA component, which may
+ * complete asynchronously.
+ *
+ * Returning -EINPROGRESS pauses the downlink until the application calls
+ * golioth_ota_component_ack(), e.g. once a slow flash erase has finished.
+ * \ref data remains valid until then. Compressed components can't be
+ * received asynchronously, and are ignored.
+ *
+ * @param data Pointer to a block of the component.
+ * @param offset Offset of \ref data within the component.
+ * @param len Length of \ref data.
+ * @param is_last True if this is the last block of the component.
+ *
+ * @retval 0 The block has been processed.
+ * @retval -EINPROGRESS The application will call golioth_ota_component_ack()
+ *                      once it's done with the block.
+ */
+typedef int (*golioth_ota_component_receive_async)(const void *data,
+                                                   size_t offset,
+                                                   size_t len,
+                                                   bool is_last);
+
 struct golioth_ota_registered_component_data
 {
     char target[CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN];
+    /* SHA-256 hash and size of the target image, after decompression and patching */
     uint8_t target_hash[GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN];
     size_t size;
     uint8_t state;
+    bool delta;
+    bool compressed;
+    /* Number of bytes committed by the application, see golioth_ota_download_progress() */
+    size_t offset;
+    size_t saved_offset;
+    /* Entry of the manifest that's being received, applied once the whole manifest is valid */
+    struct
+    {
+        char target[CONFIG_GOLIOTH_OTA_MAX_VERSION_LEN];
+        uint8_t target_hash[GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN];
+        size_t size;
+        bool delta;
+        bool compressed;
+        bool staged;
+    } manifest;
 };
 
 struct golioth_ota_registered_component
@@ -76,6 +127,8 @@ struct golioth_ota_registered_component
     const char *name;
     const char *version;
     golioth_ota_component_receive receive;
+    /* Called instead of receive if set */
+    golioth_ota_component_receive_async receive_async;
     struct golioth_ota_registered_component_data *data;
 };
 
@@ -103,11 +156,36 @@ struct golioth_ota_registered_component
         .data = &ota_component_data_##_name,                                    \
     }
 
+/**
+ * Register an OTA component with an asynchronous receive callback.
+ *
+ * @param _name The name of the C structure holding this information.
+ * @param _package The name of the package on Golioth.
+ * @param _version The current version of the component.
+ * @param _receive A golioth_ota_component_receive_async callback for
+ *                 accepting blocks of data for the component.
+ */
+#define GOLIOTH_OTA_COMPONENT_ASYNC(_name, _package, _version, _receive)        \
+    struct golioth_ota_registered_component_data ota_component_data_##_name = { \
+        .target = _version,                                                     \
+        .state = 0,                                                             \
+    };                                                                          \
+    const STRUCT_SECTION_ITERABLE(golioth_ota_registered_component,             \
+                                  CONCAT(ota_component_, _name)) = {            \
+        .name = _package,                                                       \
+        .version = _version,                                                    \
+        .receive_async = _receive,                                              \
+        .data = &ota_component_data_##_name,                                    \
+    }
+
 /* Component state API */
 
 /** Mark a component for download.
  *
  * Components marked for download will be received in the next Downlink.
+ * If the download fails before the data reaches the receive callback, e.g.
+ * because a compressed component can't be decompressed, the component is
+ * marked as idle, and has to be marked for download again.
  *
  * @param name The name of the component to mark.
  */
@@ -129,3 +207,30 @@ int golioth_ota_mark_idle(const char *name);
  * @param name The name of the component to mark.
  */
 int golioth_ota_mark_updating(const char *name);
+
+/** Report download progress for a component.
+ *
+ * Applications should call this whenever data received for a component has
+ * been committed to persistent storage. The offset is reported to the cloud,
+ * so an interrupted download can be resumed from this offset in a later
+ * session, instead of starting over.
+ *
+ * With CONFIG_GOLIOTH_OTA_RESUME, the progress is also stored with the
+ * settings subsystem, so downloads can be resumed after a reboot.
+ *
+ * @param name The name of the component.
+ * @param offset The number of bytes of the component that have been committed.
+ */
+int golioth_ota_download_progress(const char *name, size_t offset);
+
+/** Acknowledge a block held by an asynchronous receive callback.
+ *
+ * Resumes the downlink paused by a golioth_ota_component_receive_async
+ * callback returning -EINPROGRESS. May be called from any thread.
+ *
+ * @param name The name of the component.
+ *
+ * @retval 0 The downlink resumes.
+ * @retval -EINVAL No block of this component is pending.
+ */
+int golioth_ota_component_ack(const char *name);
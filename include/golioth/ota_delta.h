@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file ota_delta.h
+ * @brief Streaming decoder for delta OTA patches
+ *
+ * A patch reconstructs a target image from the image it was generated
+ * against. Patches follow the bsdiff structure, and are applied as they
+ * arrive, in constant memory:
+ *
+ * @code
+ * patch  = magic target-size *record
+ * magic  = "GDP1"
+ * record = diff-len extra-len seek diff-data extra-data
+ * @endcode
+ *
+ * All numbers are LEB128 varints. seek is signed, and zigzag encoded.
+ *
+ * Each record outputs diff-len bytes, where every byte is the sum of a
+ * diff-data byte and the byte at the current position in the old image,
+ * followed by the extra-len bytes of extra-data. The old image position then
+ * advances by diff-len, and moves by seek. The patch ends once target-size
+ * bytes have been output.
+ */
+
+#define GOLIOTH_OTA_DELTA_MAGIC "GDP1"
+
+/**
+ * Callback for reading the old image.
+ *
+ * @param offset Offset in the old image
+ * @param buf Buffer to read into
+ * @param len Number of bytes to read
+ * @param user_data User data passed to golioth_ota_delta_init()
+ *
+ * @return 0 on success or a negative error code on failure.
+ */
+typedef int (*golioth_ota_delta_read_cb)(size_t offset, void *buf, size_t len, void *user_data);
+
+/**
+ * Callback for the reconstructed image, called in order.
+ *
+ * @param data Next part of the target image
+ * @param len Length of @p data
+ * @param user_data User data passed to golioth_ota_delta_init()
+ *
+ * @return 0 on success or a negative error code to abort the patch.
+ */
+typedef int (*golioth_ota_delta_write_cb)(const void *data, size_t len, void *user_data);
+
+/** Patch decoder state. Treat as opaque. */
+struct golioth_ota_delta
+{
+    golioth_ota_delta_read_cb read;
+    golioth_ota_delta_write_cb write;
+    void *user_data;
+    int err;
+    uint8_t state;
+
+    /* Magic or varint being decoded */
+    uint8_t pos;
+    uint64_t varint;
+
+    size_t target_size;
+    size_t written;
+    size_t old_pos;
+
+    /* Current record */
+    size_t diff_len;
+    size_t extra_len;
+    int64_t seek;
+};
+
+/**
+ * Initialize a patch decoder.
+ *
+ * @param delta Decoder state
+ * @param read Callback for reading the old image
+ * @param write Callback for the reconstructed image
+ * @param user_data User data passed to the callbacks
+ */
+void golioth_ota_delta_init(struct golioth_ota_delta *delta,
+                            golioth_ota_delta_read_cb read,
+                            golioth_ota_delta_write_cb write,
+                            void *user_data);
+
+/**
+ * Feed the next part of the patch to the decoder.
+ *
+ * @param delta Decoder state
+ * @param data Next part of the patch
+ * @param len Length of @p data
+ *
+ * @retval 0 The data was applied
+ * @retval -EBADMSG The patch is malformed, or continues after the end of the target image
+ * @retval <0 Error returned from a callback
+ */
+int golioth_ota_delta_feed(struct golioth_ota_delta *delta, const void *data, size_t len);
+
+/**
+ * Finish applying the patch.
+ *
+ * @param delta Decoder state
+ *
+ * @retval 0 The whole target image was reconstructed
+ * @retval -EBADMSG The patch was truncated
+ * @retval <0 Earlier decoding error
+ */
+int golioth_ota_delta_finish(struct golioth_ota_delta *delta);
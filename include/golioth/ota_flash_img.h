@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <psa/crypto.h>
+#include <zephyr/dfu/flash_img.h>
+
+#include <golioth/ota.h>
+#include <golioth/ota_delta.h>
+
+/**
+ * Flash image writer for OTA components.
+ *
+ * Writes a component to the secondary MCUboot slot as it is received, and
+ * verifies the SHA-256 hash of the component against the hash in the
+ * manifest. Data is coalesced into writes of CONFIG_IMG_BLOCK_BUF_SIZE
+ * bytes, which should be a multiple of the flash write block size.
+ *
+ * With CONFIG_GOLIOTH_OTA_DELTA, components sent as patches are applied
+ * against the image in the primary slot as they arrive, and the
+ * reconstructed image is verified instead.
+ */
+struct golioth_ota_flash_img
+{
+    struct flash_img_context flash;
+    psa_hash_operation_t hash;
+#if defined(CONFIG_GOLIOTH_OTA_DELTA)
+    struct golioth_ota_delta delta;
+    const struct flash_area *source;
+#endif
+    /* Number of bytes received, including data still buffered for writing */
+    size_t received;
+    /* Number of image bytes written, which differs from the bytes received for patches */
+    size_t written;
+    size_t saved_offset;
+    bool active;
+};
+
+/**
+ * Callback for a completed flash image.
+ *
+ * @param err 0 if the image was written and its hash matches the manifest,
+ *            -EBADMSG if the hash or size doesn't match, or another negative
+ *            error code if the image couldn't be written.
+ */
+typedef void (*golioth_ota_flash_img_done_cb)(int err);
+
+/**
+ * Write a block of an OTA component to the secondary slot.
+ *
+ * Blocks must arrive in order. With CONFIG_GOLIOTH_OTA_RESUME and
+ * CONFIG_STREAM_FLASH_PROGRESS, this function reports the offset of the data
+ * committed to flash through golioth_ota_download_progress(), and a download
+ * may be restarted at that offset. Otherwise, and for patches, downloads are
+ * restarted from the beginning.
+ *
+ * The size and hash in the manifest describe the image written to flash, i.e.
+ * after decompression and patching.
+ *
+ * @param img Flash image writer state.
+ * @param component The component being received.
+ * @param data Pointer to a block of the component.
+ * @param offset Offset of \ref data within the component.
+ * @param len Length of \ref data.
+ * @param is_last True if this is the last block of the component.
+ *
+ * @retval 0 The block was written. For the last block, the image has also
+ *           been verified.
+ * @retval -EBADMSG The hash or size of the image doesn't match the manifest.
+ * @retval -ESPIPE The block doesn't continue the image being written, or the
+ *                 write position at its offset couldn't be restored.
+ * @retval -ENOTSUP The component is a patch, and CONFIG_GOLIOTH_OTA_DELTA is
+ *                  disabled.
+ * @retval <0 The block couldn't be written to flash.
+ */
+int golioth_ota_flash_img_write(struct golioth_ota_flash_img *img,
+                                const struct golioth_ota_registered_component *component,
+                                const void *data,
+                                size_t offset,
+                                size_t len,
+                                bool is_last);
+
+/**
+ * Register an OTA component that is written to the secondary MCUboot slot.
+ *
+ * The done callback is called once the last block has been written and
+ * verified, or when writing the image fails. The application is responsible
+ * for requesting the upgrade, and marking the component as idle on failure.
+ *
+ * @param _name The name of the C structure holding this information.
+ * @param _package The name of the package on Golioth.
+ * @param _version The current version of the component.
+ * @param _done Callback of type golioth_ota_flash_img_done_cb.
+ */
+#define GOLIOTH_OTA_FLASH_IMG_COMPONENT(_name, _package, _version, _done)                     \
+    extern const struct golioth_ota_registered_component CONCAT(ota_component_, _name);       \
+    static struct golioth_ota_flash_img ota_flash_img_##_name;                                \
+    static void ota_flash_img_receive_##_name(const void *data,                               \
+                                              size_t offset,                                  \
+                                              size_t len,                                     \
+                                              bool is_last)                                   \
+    {                                                                                         \
+        int err = golioth_ota_flash_img_write(&ota_flash_img_##_name,                         \
+                                              &CONCAT(ota_component_, _name),                 \
+                                              data,                                           \
+                                              offset,                                         \
+                                              len,                                            \
+                                              is_last);                                       \
+        if (err || is_last)                                                                   \
+        {                                                                                     \
+            _done(err);                                                                       \
+        }                                                                                     \
+    }                                                                                         \
+    GOLIOTH_OTA_COMPONENT(_name, _package, _version, ota_flash_img_receive_##_name)
@@ -45,26 +45,112 @@ typedef void (*pouch_downlink_data_cb)(unsigned int stream_id,
                                        bool is_last);
 
 /**
- * Pouch event handler
+ * Callback executed with reassembled downlink pouch entry, which may complete asynchronously.
  *
- * This structure is used to register a callback for a specific event.
- * Use the @ref POUCH_DOWNLINK_HANDLER macro to register an event handler.
+ * A handler that can't process the data right away, e.g. because it has to wait for a flash erase,
+ * can return @c -EINPROGRESS to hold on to the data. Downlink consumption is paused until the
+ * handler calls @ref pouch_downlink_ack, and @p data remains valid until then. Blocks received in
+ * the meantime stay in the downlink window, so a long pause makes the transport hold off on
+ * sending more data.
+ *
+ * @param stream_id Stream ID (0 if not a stream).
+ * @param data The data (payload) of the entry.
+ * @param len The length of the data.
+ * @param is_last Defines whether this is the last data fragment (last block) for given stream.
+ *
+ * @retval 0 The data has been processed.
+ * @retval -EINPROGRESS The handler will call @ref pouch_downlink_ack once it's done with the data.
+ * @retval <0 The data couldn't be processed. Downlink consumption continues.
+ */
+typedef int (*pouch_downlink_data_async_cb)(unsigned int stream_id,
+                                            const void *data,
+                                            size_t len,
+                                            bool is_last);
+
+/**
+ * Pouch downlink handler
+ *
+ * This structure is used to register callbacks for downlink entries and streams.
+ * Use the @ref POUCH_DOWNLINK_HANDLER, @ref POUCH_DOWNLINK_PATH_HANDLER or
+ * @ref POUCH_DOWNLINK_PATH_HANDLER_ASYNC macros to register a downlink handler.
  */
 struct pouch_downlink_handler
 {
+    /** Path filter, or NULL to receive all downlink traffic */
+    const char *path;
     pouch_downlink_start_cb start_cb;
     pouch_downlink_data_cb data_cb;
+    /** Called instead of @c data_cb if set */
+    pouch_downlink_data_async_cb data_async_cb;
 };
 
 /**
- * Register a downlink handler
+ * Register a downlink handler for all downlink traffic
+ *
+ * @param _start_cb The callback function to be called when the downlink pouch entry/stream starts
+ * @param _data_cb The callback function to be called when the downlink pouch entry/stream is
+ * reassembled
+ */
+#define POUCH_DOWNLINK_HANDLER(_start_cb, _data_cb)                                 \
+    static STRUCT_SECTION_ITERABLE(pouch_downlink_handler,                          \
+                                   CONCAT(_pouch_downlink_handler_, _start_cb)) = { \
+        .path = NULL,                                                               \
+        .start_cb = _start_cb,                                                      \
+        .data_cb = _data_cb};
+
+/**
+ * Register a downlink handler for a specific path
+ *
+ * The handler only receives entries and streams with a matching path. A path ending with @c '*'
+ * matches every path starting with the same prefix, any other path must match exactly. If several
+ * handlers match, the entry or stream is routed to the handler with the longest path.
+ *
+ * The handlers are sorted into a routing table on boot, so the cost of routing an entry is
+ * logarithmic in the number of handlers.
  *
+ * @param _name Unique name of the handler
+ * @param _path The path to receive downlink data for
  * @param _start_cb The callback function to be called when the downlink pouch entry/stream starts
  * @param _data_cb The callback function to be called when the downlink pouch entry/stream is
  * reassembled
  */
-#define POUCH_DOWNLINK_HANDLER(_start_cb, _data_cb)                                       \
-    static const STRUCT_SECTION_ITERABLE(pouch_downlink_handler,                          \
-                                         CONCAT(_pouch_downlink_handler_, _callback)) = { \
-        .start_cb = _start_cb,                                                            \
+#define POUCH_DOWNLINK_PATH_HANDLER(_name, _path, _start_cb, _data_cb)          \
+    BUILD_ASSERT((_path) != NULL, "_path must not be NULL");                    \
+    static STRUCT_SECTION_ITERABLE(pouch_downlink_handler,                      \
+                                   CONCAT(_pouch_downlink_handler_, _name)) = { \
+        .path = _path,                                                          \
+        .start_cb = _start_cb,                                                  \
         .data_cb = _data_cb};
+
+/**
+ * Register an asynchronous downlink handler for a specific path
+ *
+ * Works like @ref POUCH_DOWNLINK_PATH_HANDLER, but the data callback may return @c -EINPROGRESS
+ * to pause the downlink until the data has been processed. See @ref pouch_downlink_data_async_cb.
+ *
+ * @param _name Unique name of the handler
+ * @param _path The path to receive downlink data for
+ * @param _start_cb The callback function to be called when the downlink pouch entry/stream starts
+ * @param _data_cb The @ref pouch_downlink_data_async_cb to be called when the downlink pouch
+ * entry/stream is reassembled
+ */
+#define POUCH_DOWNLINK_PATH_HANDLER_ASYNC(_name, _path, _start_cb, _data_cb)    \
+    BUILD_ASSERT((_path) != NULL, "_path must not be NULL");                    \
+    static STRUCT_SECTION_ITERABLE(pouch_downlink_handler,                      \
+                                   CONCAT(_pouch_downlink_handler_, _name)) = { \
+        .path = _path,                                                          \
+        .start_cb = _start_cb,                                                  \
+        .data_async_cb = _data_cb};
+
+/**
+ * Acknowledge downlink data held by an asynchronous handler
+ *
+ * Resumes the downlink consumption paused by a @ref pouch_downlink_data_async_cb returning
+ * @c -EINPROGRESS. May be called from any thread, including from within the callback itself.
+ *
+ * @param stream_id Stream ID the data was received on.
+ *
+ * @retval 0 The downlink resumes.
+ * @retval -EINVAL No data is pending on this stream.
+ */
+int pouch_downlink_ack(unsigned int stream_id);
@@ -22,6 +22,12 @@ enum pouch_event
     POUCH_EVENT_SESSION_START,
     /** A session has ended */
     POUCH_EVENT_SESSION_END,
+    /** The pending uplink data crossed a sync policy threshold */
+    POUCH_EVENT_SYNC_REQUEST,
+    /** The pending uplink data no longer warrants a sync */
+    POUCH_EVENT_SYNC_REQUEST_CLEARED,
+    /** The downlink window opened up after a transport found it too small */
+    POUCH_EVENT_DOWNLINK_WINDOW_OPEN,
 };
 
 /**
@@ -42,6 +42,25 @@ struct pouch_config
 /**
  * Initialize Pouch.
  *
+ * With CONFIG_POUCH_SERVER_CERT_CACHE, the cached server certificate is restored here, so the
+ * settings subsystem must be initialized with settings_subsys_init() before this is called.
+ *
  * @param config The configuration to use.
  */
 int pouch_init(const struct pouch_config *config);
+
+#if CONFIG_POUCH_ENCRYPTION_SAEAD
+/**
+ * Get the encryption algorithm used for uplink sessions.
+ *
+ * With CONFIG_POUCH_ENCRYPTION_AUTO, this is the fastest algorithm measured in pouch_init().
+ */
+psa_algorithm_t pouch_encryption_algorithm_get(void);
+
+/**
+ * Get the encryption throughput of an algorithm, as measured in pouch_init().
+ *
+ * @return Throughput in bytes per second, or 0 if the algorithm wasn't measured.
+ */
+uint32_t pouch_encryption_throughput_get(psa_algorithm_t algorithm);
+#endif
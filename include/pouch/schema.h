@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/util.h>
+
+/**
+ * @file schema.h
+ * @brief Binary schema entries for fixed layout payloads
+ *
+ * Entries with the @ref POUCH_CONTENT_TYPE_SCHEMA content type carry a 2 byte big-endian schema ID
+ * followed by the raw bytes of a packed struct. The struct layout is registered at compile time
+ * with @ref POUCH_SCHEMA_DEFINE, and the full set of schemas can be exported as a descriptor with
+ * @ref pouch_schema_descriptor_get, so the cloud side can decode the entries.
+ */
+
+/** Schema field types */
+enum pouch_schema_field_type
+{
+    POUCH_SCHEMA_U8,
+    POUCH_SCHEMA_I8,
+    POUCH_SCHEMA_U16,
+    POUCH_SCHEMA_I16,
+    POUCH_SCHEMA_U32,
+    POUCH_SCHEMA_I32,
+    POUCH_SCHEMA_U64,
+    POUCH_SCHEMA_I64,
+    POUCH_SCHEMA_F32,
+    POUCH_SCHEMA_F64,
+    /** Raw bytes, like a fixed size array */
+    POUCH_SCHEMA_BYTES,
+};
+
+/** Single field in a schema */
+struct pouch_schema_field
+{
+    /** Field name */
+    const char *name;
+    /** Field type */
+    enum pouch_schema_field_type type;
+    /** Offset of the field in the struct */
+    uint16_t offset;
+    /** Size of the field in bytes */
+    uint16_t size;
+};
+
+/**
+ * Schema definition
+ *
+ * Use the @ref POUCH_SCHEMA_DEFINE macro to register a schema.
+ */
+struct pouch_schema
+{
+    /** Schema ID. Must be unique within the application. */
+    uint16_t id;
+    /** Schema name */
+    const char *name;
+    /** Size of the struct in bytes */
+    size_t size;
+    /** Fields of the struct */
+    const struct pouch_schema_field *fields;
+    /** Number of fields */
+    size_t field_count;
+};
+
+/**
+ * Describe a struct member as a schema field
+ *
+ * Integers are encoded in the byte order of the device.
+ *
+ * @param _struct The struct type
+ * @param _member The struct member
+ * @param _type The field type, see @ref pouch_schema_field_type
+ */
+#define POUCH_SCHEMA_FIELD(_struct, _member, _type)     \
+    {                                                   \
+        .name = STRINGIFY(_member),                     \
+        .type = _type,                                  \
+        .offset = offsetof(_struct, _member),           \
+        .size = sizeof(((_struct *) 0)->_member),       \
+    }
+
+/**
+ * Register a schema
+ *
+ * The struct should be declared with @c __packed to get a well defined layout.
+ *
+ * @param _name Name of the schema. Also used as the name of the schema variable.
+ * @param _id Unique schema ID
+ * @param _struct The struct type
+ * @param ... The fields of the struct, see @ref POUCH_SCHEMA_FIELD
+ */
+#define POUCH_SCHEMA_DEFINE(_name, _id, _struct, ...)                                        \
+    static const struct pouch_schema_field CONCAT(_pouch_schema_fields_, _name)[] = {       \
+        __VA_ARGS__};                                                                        \
+    const STRUCT_SECTION_ITERABLE(pouch_schema, _name) = {                                   \
+        .id = _id,                                                                           \
+        .name = STRINGIFY(_name),                                                            \
+        .size = sizeof(_struct),                                                             \
+        .fields = CONCAT(_pouch_schema_fields_, _name),                                      \
+        .field_count = ARRAY_SIZE(CONCAT(_pouch_schema_fields_, _name)),                     \
+    }
+
+/**
+ * Declare a schema defined in another file
+ *
+ * @param _name Name of the schema
+ */
+#define POUCH_SCHEMA_DECLARE(_name) extern const struct pouch_schema _name
+
+/**
+ * Write a schema entry to the pouch uplink.
+ *
+ * The data is written to the entry without any encoding.
+ *
+ * @param path The path to write the entry to.
+ * @param schema The schema of the data.
+ * @param data The data to write. Must be @p schema->size bytes.
+ * @param timeout The timeout for the operation.
+ *
+ * @return 0 on success or a negative error code on failure.
+ */
+int pouch_uplink_schema_write(const char *path,
+                              const struct pouch_schema *schema,
+                              const void *data,
+                              k_timeout_t timeout);
+
+/**
+ * Export the registered schemas as a JSON descriptor.
+ *
+ * The descriptor is a JSON object with the byte order of the device in "endian", and a "schemas"
+ * array, containing the ID, name, size and fields of each registered schema. The string is NUL
+ * terminated.
+ *
+ * The same descriptor can be extracted from the application ELF file on the host, with
+ * scripts/pouch-schema-export.py.
+ *
+ * @param buf Buffer to write the descriptor to.
+ * @param len Size of the buffer.
+ *
+ * @return The length of the descriptor, excluding the NUL terminator, or a negative error code on
+ * failure. Returns -EEXIST if two schemas have the same ID.
+ */
+int pouch_schema_descriptor_get(char *buf, size_t len);
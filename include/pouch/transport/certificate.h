@@ -12,6 +12,22 @@
 
 /** Set the server certificate. */
 int pouch_server_certificate_set(const struct pouch_cert *cert);
+/**
+ * Start receiving a DER encoded server certificate in parts.
+ *
+ * Only the received certificate is buffered, instead of a buffer of
+ * CONFIG_POUCH_SERVER_CERT_MAX_LEN bytes. Restarts any certificate that is being received.
+ */
+void pouch_server_certificate_start(void);
+/** Push the next part of the server certificate. */
+int pouch_server_certificate_push(const void *buf, size_t buf_len);
+/** Finish receiving the server certificate, and set it if it's valid. */
+int pouch_server_certificate_finish(void);
+/**
+ * Discard the server certificate that's being received, such as when the transport disconnects
+ * in the middle of it.
+ */
+void pouch_server_certificate_abort(void);
 /** Get the serial number of the current server certificate */
 ssize_t pouch_server_certificate_serial_get(uint8_t *serial, size_t len);
 /** Get the current device certificate reference */
@@ -17,8 +17,42 @@
 /** Start a new downlink session */
 void pouch_downlink_start(void);
 
-/** Push downlink data into Pouch */
-void pouch_downlink_push(const void *buf, size_t buf_len);
+/**
+ * Get the downlink receive window.
+ *
+ * The window is the number of bytes Pouch can accept right now without running out of buffers. It
+ * opens up again as the received blocks are consumed, which pauses while an asynchronous downlink
+ * handler holds on to a block. Transports should advertise it to the gateway, so the gateway can
+ * hold off on sending more data than the device can take.
+ *
+ * @return The number of bytes that can be pushed.
+ */
+size_t pouch_downlink_window_get(void);
+
+/**
+ * Check whether the downlink window has room for @p len bytes.
+ *
+ * If it doesn't, @ref POUCH_EVENT_DOWNLINK_WINDOW_OPEN is emitted once the window opens up again,
+ * so the transport can tell the gateway to resume instead of having it poll or retry blindly.
+ *
+ * @param len The number of bytes the transport wants to push.
+ *
+ * @return true if the data fits in the window, false otherwise.
+ */
+bool pouch_downlink_window_check(size_t len);
+
+/**
+ * Push downlink data into Pouch
+ *
+ * @param buf The data to push.
+ * @param buf_len The length of the data.
+ *
+ * @retval 0 The data was accepted.
+ * @retval -EAGAIN The data doesn't fit in the receive window. None of it was accepted, and the
+ * transport should push it again once the window opens up.
+ * @retval <0 Other negative error codes if the data couldn't be processed.
+ */
+int pouch_downlink_push(const void *buf, size_t buf_len);
 
 /** Finish the downlink session */
 void pouch_downlink_finish(void);
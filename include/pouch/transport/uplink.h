@@ -23,6 +23,13 @@ enum pouch_result
     POUCH_MORE_DATA,
     /** An error occurred */
     POUCH_ERROR,
+    /**
+     * The current pouch is complete, and more pouches follow in the same session.
+     *
+     * The transport should deliver the pouch, then keep filling from the same uplink to get the
+     * next one.
+     */
+    POUCH_END_OF_POUCH,
 };
 
 /** Uplink structure */
@@ -26,6 +26,12 @@
 #define POUCH_CONTENT_TYPE_JSON 50
 /** The content is a CBOR encoded object */
 #define POUCH_CONTENT_TYPE_CBOR 60
+/**
+ * The content is a packed struct, prefixed by its schema ID. See @ref pouch_uplink_schema_write.
+ *
+ * Uses the experimental range of the CoAP Content-Formats registry.
+ */
+#define POUCH_CONTENT_TYPE_SCHEMA 65000
 
 /** @} */
 
@@ -14,10 +14,37 @@
  */
 
 /** Maximum number of streams that can be open simultaneously in the same uplink session */
+#if CONFIG_POUCH_STREAM_EXTENDED_ID
 #define POUCH_STREAMS_MAX 126
+#else
+#define POUCH_STREAMS_MAX 31
+#endif
 
 struct pouch_stream;
 
+/** Uplink data waiting to be sent */
+struct pouch_uplink_pending
+{
+    /** Number of bytes waiting to be sent, including block and entry headers */
+    size_t bytes;
+    /** Number of finished blocks waiting to be sent */
+    size_t blocks;
+    /**
+     * Time in milliseconds since data was first written after the last session, or 0 if no data is
+     * pending.
+     */
+    int64_t age_ms;
+};
+
+/** Segment of data for the vectored write functions */
+struct pouch_iovec
+{
+    /** Start of the segment */
+    const void *data;
+    /** Length of the segment */
+    size_t len;
+};
+
 /**
  * Write an entry to the pouch uplink.
  *
@@ -38,6 +65,27 @@ int pouch_uplink_entry_write(const char *path,
                              size_t len,
                              k_timeout_t timeout);
 
+/**
+ * Write an entry to the pouch uplink from multiple data segments.
+ *
+ * The segments are concatenated into a single entry, in order, without any intermediate copies.
+ * This is useful for writing entries that are assembled from several buffers, like a fixed header
+ * followed by a buffer of sensor samples.
+ *
+ * @param path The path to write the entry to.
+ * @param content_type The content type of the entry.
+ * @param iov Array of data segments.
+ * @param iovcnt Number of segments in @p iov.
+ * @param timeout The timeout for the operation.
+ *
+ * @return 0 on success or a negative error code on failure.
+ */
+int pouch_uplink_entry_writev(const char *path,
+                              uint16_t content_type,
+                              const struct pouch_iovec *iov,
+                              size_t iovcnt,
+                              k_timeout_t timeout);
+
 /**
  * Close the current uplink session by finalizing the open pouch.
  *
@@ -45,6 +93,37 @@ int pouch_uplink_entry_write(const char *path,
  */
 int pouch_uplink_close(k_timeout_t timeout);
 
+/**
+ * Get the amount of uplink data waiting to be sent.
+ *
+ * Data in streams that are still open is only reflected in the age, as the stream's current block
+ * isn't finished yet.
+ *
+ * @param pending Pending data information to fill.
+ *
+ * @return 0 on success or a negative error code on failure.
+ */
+int pouch_uplink_pending_get(struct pouch_uplink_pending *pending);
+
+/**
+ * Request a sync, regardless of the sync policy thresholds.
+ *
+ * The request is raised with @ref POUCH_EVENT_SYNC_REQUEST, and stays raised until the end of the
+ * next session. Use this when the pending data is urgent.
+ *
+ * Requires @kconfig{CONFIG_POUCH_SYNC_POLICY}.
+ */
+void pouch_sync_request(void);
+
+/**
+ * Check whether the sync policy currently requests a sync.
+ *
+ * Requires @kconfig{CONFIG_POUCH_SYNC_POLICY}.
+ *
+ * @return true if a sync is requested, false otherwise.
+ */
+bool pouch_sync_is_requested(void);
+
 /**
  * Open a new stream to the uplink.
  *
@@ -88,6 +167,24 @@ size_t pouch_stream_write(struct pouch_stream *stream,
                           size_t len,
                           k_timeout_t timeout);
 
+/**
+ * Write multiple data segments to a stream.
+ *
+ * Behaves like @ref pouch_stream_write() with the segments concatenated in order. If a segment is
+ * only partially written, the remaining segments are skipped.
+ *
+ * @param stream The stream to write to.
+ * @param iov Array of data segments.
+ * @param iovcnt Number of segments in @p iov.
+ * @param timeout The timeout for the write operation.
+ *
+ * @return The total number of bytes written.
+ */
+size_t pouch_stream_writev(struct pouch_stream *stream,
+                           const struct pouch_iovec *iov,
+                           size_t iovcnt,
+                           k_timeout_t timeout);
+
 /**
  * Close a stream.
  *
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zcbor_common.h>
+
+/**
+ * @file zcbor_stream.h
+ * @brief Resumable CBOR decoder for data arriving in chunks
+ *
+ * The stream decoder parses CBOR incrementally, and reports every decoded item through a callback.
+ * The decoder state survives between calls to zcbor_stream_feed(), so a CBOR document can be
+ * decoded as it arrives in constant memory, without reassembling it first.
+ *
+ * Strings are passed to the callback in fragments, as they arrive. All other items are only
+ * reported once they're complete.
+ */
+
+enum zcbor_stream_item_type
+{
+    ZCBOR_STREAM_INT,
+    ZCBOR_STREAM_BSTR,
+    ZCBOR_STREAM_TSTR,
+    ZCBOR_STREAM_LIST_START,
+    ZCBOR_STREAM_MAP_START,
+    /** End of the list or map started at the same depth */
+    ZCBOR_STREAM_CONTAINER_END,
+    ZCBOR_STREAM_TAG,
+    ZCBOR_STREAM_BOOL,
+    ZCBOR_STREAM_NIL,
+    ZCBOR_STREAM_UNDEFINED,
+    ZCBOR_STREAM_FLOAT,
+    ZCBOR_STREAM_SIMPLE,
+};
+
+/** Decoded CBOR item */
+struct zcbor_stream_item
+{
+    enum zcbor_stream_item_type type;
+    /** Nesting depth of the item. Top level items have depth 0. */
+    size_t depth;
+    /** Whether the item is a key in a map */
+    bool is_key;
+    union
+    {
+        /** Value of integers */
+        int64_t i64;
+        /** Value of tags and simple values */
+        uint64_t u64;
+        /** Value of booleans */
+        bool boolean;
+        /** Value of floats */
+        double f64;
+        /** Number of items in a list or map, or SIZE_MAX if the length is indefinite */
+        size_t count;
+        /** String fragment */
+        struct
+        {
+            struct zcbor_string value;
+            /** Offset of this fragment in the string */
+            size_t offset;
+            /** Total length of the string */
+            size_t total_len;
+        } str;
+    };
+};
+
+/**
+ * Callback for decoded CBOR items.
+ *
+ * @param item The decoded item. Only valid for the duration of the call.
+ * @param user_data User data passed to zcbor_stream_init().
+ *
+ * @retval 0 Continue decoding
+ * @retval <0 Abort decoding, zcbor_stream_feed() returns this error
+ */
+typedef int (*zcbor_stream_cb)(const struct zcbor_stream_item *item, void *user_data);
+
+/** List or map being decoded */
+struct zcbor_stream_container
+{
+    uint64_t items;
+    uint64_t total;
+    bool indefinite;
+    bool is_map;
+};
+
+/** Stream decoder state. Treat as opaque. */
+struct zcbor_stream
+{
+    zcbor_stream_cb cb;
+    void *user_data;
+    int err;
+    bool done;
+
+    /* Initial byte and argument of the item being decoded */
+    uint8_t head[9];
+    uint8_t head_len;
+    uint8_t head_needed;
+
+    /* String being decoded */
+    enum zcbor_stream_item_type str_type;
+    bool str_is_key;
+    size_t str_len;
+    size_t str_offset;
+
+    size_t depth;
+    struct zcbor_stream_container stack[CONFIG_ZCBOR_UTILS_STREAM_MAX_DEPTH];
+};
+
+/**
+ * Initialize a stream decoder for a new CBOR document.
+ *
+ * @param stream Decoder state
+ * @param cb Callback for decoded items
+ * @param user_data User data passed to @p cb
+ */
+void zcbor_stream_init(struct zcbor_stream *stream, zcbor_stream_cb cb, void *user_data);
+
+/**
+ * Feed the next chunk of the CBOR document to the decoder.
+ *
+ * @param stream Decoder state
+ * @param data Next chunk of data
+ * @param len Length of @p data
+ *
+ * @retval 0 The chunk was decoded
+ * @retval -EBADMSG The data is not valid CBOR, or there's data after the end of the document
+ * @retval -ENOTSUP The data uses indefinite length strings or reserved encodings
+ * @retval -EOVERFLOW An integer doesn't fit in an int64_t
+ * @retval -ENOMEM Containers are nested deeper than CONFIG_ZCBOR_UTILS_STREAM_MAX_DEPTH
+ * @retval <0 Error returned from the callback
+ */
+int zcbor_stream_feed(struct zcbor_stream *stream, const void *data, size_t len);
+
+/**
+ * Finish decoding the CBOR document.
+ *
+ * @param stream Decoder state
+ *
+ * @retval 0 A complete CBOR document was decoded
+ * @retval -EBADMSG The document was truncated
+ * @retval <0 Earlier decoding error
+ */
+int zcbor_stream_finish(struct zcbor_stream *stream);
+
+/**
+ * Check whether a string item is the last fragment of the string.
+ *
+ * @param item String item
+ */
+static inline bool zcbor_stream_str_is_complete(const struct zcbor_stream_item *item)
+{
+    return item->str.offset + item->str.value.len == item->str.total_len;
+}
+
+/**
+ * Copy a string fragment into a buffer.
+ *
+ * The buffer is NULL terminated once the last fragment has been copied.
+ *
+ * @param item String item
+ * @param buf Buffer to reassemble the string in
+ * @param size Size of @p buf, including space for the NULL terminator
+ *
+ * @retval 0 The fragment was copied
+ * @retval -ENOMEM The string doesn't fit in the buffer
+ */
+int zcbor_stream_str_copy(const struct zcbor_stream_item *item, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
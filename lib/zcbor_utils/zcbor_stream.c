@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <zcbor_stream.h>
+
+#define AI_INDEFINITE 31
+
+static inline size_t argument_len(uint8_t additional_info)
+{
+    switch (additional_info)
+    {
+        case 24:
+            return 1;
+        case 25:
+            return 2;
+        case 26:
+            return 4;
+        case 27:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static uint64_t argument_get(const struct zcbor_stream *stream)
+{
+    const uint8_t *arg = &stream->head[1];
+
+    switch (stream->head_len - 1)
+    {
+        case 1:
+            return arg[0];
+        case 2:
+            return sys_get_be16(arg);
+        case 4:
+            return sys_get_be32(arg);
+        case 8:
+            return sys_get_be64(arg);
+        default:
+            return stream->head[0] & 0x1f;
+    }
+}
+
+static bool item_is_key(const struct zcbor_stream *stream)
+{
+    if (stream->depth == 0)
+    {
+        return false;
+    }
+
+    return stream->stack[stream->depth - 1].is_map
+        && (stream->stack[stream->depth - 1].items % 2) == 0;
+}
+
+static int emit(struct zcbor_stream *stream, struct zcbor_stream_item *item)
+{
+    item->depth = stream->depth;
+    return stream->cb(item, stream->user_data);
+}
+
+static int container_end(struct zcbor_stream *stream)
+{
+    struct zcbor_stream_item item = {
+        .type = ZCBOR_STREAM_CONTAINER_END,
+    };
+
+    stream->depth--;
+    item.is_key = item_is_key(stream);
+
+    return emit(stream, &item);
+}
+
+/** Account for a completed item in its parent containers */
+static int item_done(struct zcbor_stream *stream)
+{
+    while (stream->depth > 0)
+    {
+        struct zcbor_stream_container *top = &stream->stack[stream->depth - 1];
+
+        top->items++;
+        if (top->indefinite || top->items < top->total)
+        {
+            return 0;
+        }
+
+        int err = container_end(stream);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    stream->done = true;
+
+    return 0;
+}
+
+static int container_start(struct zcbor_stream *stream,
+                           struct zcbor_stream_item *item,
+                           uint64_t total,
+                           bool indefinite)
+{
+    if (stream->depth == ARRAY_SIZE(stream->stack))
+    {
+        return -ENOMEM;
+    }
+
+    item->count = indefinite ? SIZE_MAX : (size_t) total;
+
+    int err = emit(stream, item);
+    if (err)
+    {
+        return err;
+    }
+
+    stream->stack[stream->depth].items = 0;
+    stream->stack[stream->depth].total = (item->type == ZCBOR_STREAM_MAP_START) ? 2 * total : total;
+    stream->stack[stream->depth].indefinite = indefinite;
+    stream->stack[stream->depth].is_map = (item->type == ZCBOR_STREAM_MAP_START);
+    stream->depth++;
+
+    if (!indefinite && total == 0)
+    {
+        err = container_end(stream);
+        if (err)
+        {
+            return err;
+        }
+
+        return item_done(stream);
+    }
+
+    return 0;
+}
+
+static int simple_decode(struct zcbor_stream *stream, struct zcbor_stream_item *item)
+{
+    uint8_t additional_info = stream->head[0] & 0x1f;
+
+    switch (additional_info)
+    {
+        case 20:
+        case 21:
+            item->type = ZCBOR_STREAM_BOOL;
+            item->boolean = (additional_info == 21);
+            break;
+        case 22:
+            item->type = ZCBOR_STREAM_NIL;
+            break;
+        case 23:
+            item->type = ZCBOR_STREAM_UNDEFINED;
+            break;
+        case 25:
+            item->type = ZCBOR_STREAM_FLOAT;
+            item->f64 = zcbor_float16_to_32(sys_get_be16(&stream->head[1]));
+            break;
+        case 26:
+        {
+            uint32_t bits = sys_get_be32(&stream->head[1]);
+            float f32;
+
+            memcpy(&f32, &bits, sizeof(f32));
+            item->type = ZCBOR_STREAM_FLOAT;
+            item->f64 = f32;
+            break;
+        }
+        case 27:
+        {
+            uint64_t bits = sys_get_be64(&stream->head[1]);
+
+            item->type = ZCBOR_STREAM_FLOAT;
+            memcpy(&item->f64, &bits, sizeof(item->f64));
+            break;
+        }
+        default:
+            item->type = ZCBOR_STREAM_SIMPLE;
+            item->u64 = argument_get(stream);
+            break;
+    }
+
+    int err = emit(stream, item);
+    if (err)
+    {
+        return err;
+    }
+
+    return item_done(stream);
+}
+
+static int string_fragment(struct zcbor_stream *stream, const uint8_t *data, size_t len)
+{
+    struct zcbor_stream_item item = {
+        .type = stream->str_type,
+        .is_key = stream->str_is_key,
+        .str =
+            {
+                .value = {data, len},
+                .offset = stream->str_offset,
+                .total_len = stream->str_len,
+            },
+    };
+
+    stream->str_offset += len;
+
+    int err = emit(stream, &item);
+    if (err)
+    {
+        return err;
+    }
+
+    if (stream->str_offset == stream->str_len)
+    {
+        stream->str_len = 0;
+        stream->str_offset = 0;
+
+        return item_done(stream);
+    }
+
+    return 0;
+}
+
+static int head_decode(struct zcbor_stream *stream)
+{
+    zcbor_major_type_t major_type = ZCBOR_MAJOR_TYPE(stream->head[0]);
+    uint8_t additional_info = stream->head[0] & 0x1f;
+    uint64_t arg = argument_get(stream);
+    struct zcbor_stream_item item = {
+        .is_key = item_is_key(stream),
+    };
+
+    if (additional_info == AI_INDEFINITE)
+    {
+        switch (major_type)
+        {
+            case ZCBOR_MAJOR_TYPE_LIST:
+                item.type = ZCBOR_STREAM_LIST_START;
+                return container_start(stream, &item, 0, true);
+            case ZCBOR_MAJOR_TYPE_MAP:
+                item.type = ZCBOR_STREAM_MAP_START;
+                return container_start(stream, &item, 0, true);
+            case ZCBOR_MAJOR_TYPE_SIMPLE:
+            {
+                /* Break */
+                if (stream->depth == 0 || !stream->stack[stream->depth - 1].indefinite
+                    || item.is_key != stream->stack[stream->depth - 1].is_map)
+                {
+                    return -EBADMSG;
+                }
+
+                int err = container_end(stream);
+                if (err)
+                {
+                    return err;
+                }
+
+                return item_done(stream);
+            }
+            case ZCBOR_MAJOR_TYPE_BSTR:
+            case ZCBOR_MAJOR_TYPE_TSTR:
+                return -ENOTSUP;
+            default:
+                return -EBADMSG;
+        }
+    }
+
+    switch (major_type)
+    {
+        case ZCBOR_MAJOR_TYPE_PINT:
+        case ZCBOR_MAJOR_TYPE_NINT:
+        {
+            if (arg > INT64_MAX)
+            {
+                return -EOVERFLOW;
+            }
+
+            item.type = ZCBOR_STREAM_INT;
+            item.i64 = (major_type == ZCBOR_MAJOR_TYPE_PINT) ? (int64_t) arg : -1 - (int64_t) arg;
+
+            int err = emit(stream, &item);
+            if (err)
+            {
+                return err;
+            }
+
+            return item_done(stream);
+        }
+        case ZCBOR_MAJOR_TYPE_BSTR:
+        case ZCBOR_MAJOR_TYPE_TSTR:
+            if (arg > SIZE_MAX)
+            {
+                return -EOVERFLOW;
+            }
+
+            stream->str_type =
+                (major_type == ZCBOR_MAJOR_TYPE_BSTR) ? ZCBOR_STREAM_BSTR : ZCBOR_STREAM_TSTR;
+            stream->str_is_key = item.is_key;
+            stream->str_len = arg;
+            stream->str_offset = 0;
+
+            if (arg == 0)
+            {
+                return string_fragment(stream, NULL, 0);
+            }
+
+            return 0;
+        case ZCBOR_MAJOR_TYPE_LIST:
+            item.type = ZCBOR_STREAM_LIST_START;
+            return container_start(stream, &item, arg, false);
+        case ZCBOR_MAJOR_TYPE_MAP:
+            item.type = ZCBOR_STREAM_MAP_START;
+            return container_start(stream, &item, arg, false);
+        case ZCBOR_MAJOR_TYPE_TAG:
+            /* Tags apply to the next item, and aren't items by themselves */
+            item.type = ZCBOR_STREAM_TAG;
+            item.u64 = arg;
+            return emit(stream, &item);
+        case ZCBOR_MAJOR_TYPE_SIMPLE:
+            return simple_decode(stream, &item);
+        default:
+            return -EBADMSG;
+    }
+}
+
+void zcbor_stream_init(struct zcbor_stream *stream, zcbor_stream_cb cb, void *user_data)
+{
+    memset(stream, 0, sizeof(*stream));
+
+    stream->cb = cb;
+    stream->user_data = user_data;
+}
+
+int zcbor_stream_feed(struct zcbor_stream *stream, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    while (len > 0 && stream->err == 0)
+    {
+        if (stream->done)
+        {
+            stream->err = -EBADMSG;
+            break;
+        }
+
+        /* Pass string data straight through */
+        if (stream->str_len > stream->str_offset)
+        {
+            size_t fragment_len = MIN(len, stream->str_len - stream->str_offset);
+
+            stream->err = string_fragment(stream, bytes, fragment_len);
+
+            bytes += fragment_len;
+            len -= fragment_len;
+            continue;
+        }
+
+        if (stream->head_len == 0)
+        {
+            uint8_t additional_info = bytes[0] & 0x1f;
+
+            if (additional_info >= 28 && additional_info < AI_INDEFINITE)
+            {
+                stream->err = -ENOTSUP;
+                break;
+            }
+
+            stream->head_needed = 1 + argument_len(additional_info);
+        }
+
+        size_t head_len = MIN(len, stream->head_needed - stream->head_len);
+
+        memcpy(&stream->head[stream->head_len], bytes, head_len);
+        stream->head_len += head_len;
+
+        bytes += head_len;
+        len -= head_len;
+
+        if (stream->head_len == stream->head_needed)
+        {
+            stream->err = head_decode(stream);
+            stream->head_len = 0;
+        }
+    }
+
+    return stream->err;
+}
+
+int zcbor_stream_finish(struct zcbor_stream *stream)
+{
+    if (stream->err)
+    {
+        return stream->err;
+    }
+
+    return stream->done ? 0 : -EBADMSG;
+}
+
+int zcbor_stream_str_copy(const struct zcbor_stream_item *item, char *buf, size_t size)
+{
+    if (item->str.total_len >= size)
+    {
+        return -ENOMEM;
+    }
+
+    if (item->str.value.len > 0)
+    {
+        memcpy(&buf[item->str.offset], item->str.value.value, item->str.value.len);
+    }
+
+    if (zcbor_stream_str_is_complete(item))
+    {
+        buf[item->str.total_len] = '\0';
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2025 Golioth, Inc.
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""
+Export the schemas registered with POUCH_SCHEMA_DEFINE from an application ELF file, in the same
+JSON format as pouch_schema_descriptor_get(), so the descriptor can be uploaded to the cloud as part
+of the build instead of being read from a device.
+"""
+
+import json
+import struct
+from pathlib import Path
+
+import typer
+from elftools.elf.elffile import ELFFile
+from elftools.elf.sections import SymbolTableSection
+from typing_extensions import Annotated
+
+
+# Must match enum pouch_schema_field_type in include/pouch/schema.h:
+FIELD_TYPES = ["u8", "i8", "u16", "i16", "u32", "i32", "u64", "i64", "f32", "f64", "bytes"]
+
+
+app = typer.Typer()
+
+
+class Image:
+    def __init__(self, elf: ELFFile):
+        self.elf = elf
+        self.ptr_size = 8 if elf.elfclass == 64 else 4
+        self.endian = "<" if elf.little_endian else ">"
+        self.ptr = "Q" if self.ptr_size == 8 else "I"
+
+    def symbol(self, name):
+        for section in self.elf.iter_sections():
+            if isinstance(section, SymbolTableSection):
+                symbols = section.get_symbol_by_name(name)
+                if symbols:
+                    return symbols[0]["st_value"]
+
+        raise typer.BadParameter(f"No {name} symbol, is CONFIG_POUCH_SCHEMA enabled?")
+
+    def read(self, addr, size):
+        for segment in self.elf.iter_segments():
+            start = segment["p_vaddr"]
+            if segment["p_type"] == "PT_LOAD" and start <= addr < start + segment["p_filesz"]:
+                return segment.data()[addr - start : addr - start + size]
+
+        raise ValueError(f"Address 0x{addr:x} isn't in the image")
+
+    def unpack(self, fmt, addr):
+        fmt = self.endian + fmt
+        return struct.unpack(fmt, self.read(addr, struct.calcsize(fmt)))
+
+    def string(self, addr):
+        data = b""
+        while b"\0" not in data:
+            data += self.read(addr + len(data), 32)
+
+        return data[: data.index(b"\0")].decode()
+
+    def align(self, size):
+        return (size + self.ptr_size - 1) // self.ptr_size * self.ptr_size
+
+
+def read_schemas(image: Image):
+    ptr = image.ptr
+    # struct pouch_schema: id, name, size, fields, field_count
+    schema_fmt = f"H{image.ptr_size - 2}x{ptr}{ptr}{ptr}{ptr}"
+    # struct pouch_schema_field: name, type, offset, size
+    field_fmt = f"{ptr}IHH"
+    field_size = image.align(struct.calcsize("=" + field_fmt))
+
+    start = image.symbol("_pouch_schema_list_start")
+    end = image.symbol("_pouch_schema_list_end")
+    schema_size = struct.calcsize("=" + schema_fmt)
+
+    schemas = []
+    for addr in range(start, end, schema_size):
+        schema_id, name, size, fields, field_count = image.unpack(schema_fmt, addr)
+        schema = {"id": schema_id, "name": image.string(name), "size": size, "fields": []}
+
+        for i in range(field_count):
+            field_name, field_type, offset, field_len = image.unpack(
+                field_fmt, fields + i * field_size
+            )
+            schema["fields"].append(
+                {
+                    "name": image.string(field_name),
+                    "type": FIELD_TYPES[field_type],
+                    "offset": offset,
+                    "size": field_len,
+                }
+            )
+
+        schemas.append(schema)
+
+    return schemas
+
+
+@app.command()
+def main(
+    elf: Annotated[Path, typer.Argument(help="Application ELF file, e.g. build/zephyr/zephyr.elf")],
+    output: Annotated[Path, typer.Argument(help="JSON file to write the descriptor to")],
+):
+    with elf.open("rb") as f:
+        image = Image(ELFFile(f))
+        schemas = read_schemas(image)
+
+    ids = {}
+    for schema in schemas:
+        if schema["id"] in ids:
+            name, schema_id = schema["name"], schema["id"]
+            print(f"Schemas {ids[schema_id]} and {name} have the same ID {schema_id}")
+            raise typer.Exit(code=1)
+
+        ids[schema["id"]] = schema["name"]
+
+    descriptor = {"endian": "little" if image.endian == "<" else "big", "schemas": schemas}
+    output.write_text(json.dumps(descriptor, indent=2))
+
+
+if __name__ == "__main__":
+    app()
@@ -13,20 +13,39 @@
  *
  * Multi byte fields are big-endian
  *
- *    |   0   |   1   |   2   |
- *    +-----------------------+
- *  0 |      size^    |   id  |
- *    +-----------------------+
- *  3 | data         ...      |
- *    +-----------------------+
+ * Without the extended ID flag:
+ *
+ *    |   0   |   1   |   2   |   3   |
+ *    +-------------------------------+
+ *  0 |      size^    |   id  | data  |
+ *    +-------------------------------+
+ *  4 | data         ...              |
+ *    +-------------------------------+
+ *
+ * With the extended ID flag set in the id field:
+ *
+ *    |   0   |   1   |   2   |   3   |
+ *    +-------------------------------+
+ *  0 |      size^    |   id  | ext^^ |
+ *    +-------------------------------+
+ *  4 | data         ...              |
+ *    +-------------------------------+
  *
  *  ^ size is the number of bytes in the block, *not*
  *    including the size field.
+ *
+ *  ^^ ext holds bits 5-12 of the stream ID.
  */
 
 /** Special block ID for entry blocks */
 #define BLOCK_ID_ENTRY 0x00
 
+/** Mask for ID field indicating that the block header has an extended ID byte */
+#define EXT_ID_MASK 0x20
+
+/** Number of stream ID bits in the ID field */
+#define ID_FIELD_BITS 5
+
 /** Mask for ID field indicating that this is the first block in the stream */
 #define FIRST_DATA_MASK 0x40
 
@@ -35,7 +54,7 @@
 
 void block_decode_hdr(struct pouch_bufview *v,
                       uint16_t *block_size,
-                      uint8_t *stream_id,
+                      uint16_t *stream_id,
                       bool *is_stream,
                       bool *is_first,
                       bool *is_last)
@@ -47,6 +66,10 @@ void block_decode_hdr(struct pouch_bufview *v,
     uint8_t id = pouch_bufview_read_byte(v);
 
     *stream_id = id & BLOCK_ID_MASK;
+    if ((id & EXT_ID_MASK) && pouch_bufview_available(v) > 0)
+    {
+        *stream_id |= pouch_bufview_read_byte(v) << ID_FIELD_BITS;
+    }
     *is_stream = (*stream_id) != BLOCK_ID_ENTRY;
     *is_first = id & FIRST_DATA_MASK;
     *is_last = id & LAST_DATA_MASK;
@@ -58,10 +81,21 @@ static void update_block_header(struct pouch_buf *block, size_t size, uint8_t fl
     *buf_claim(block, 1) |= flags;
 }
 
-static void write_block_header(struct pouch_buf *block, size_t size, uint8_t id, uint8_t flags)
+static void write_block_header(struct pouch_buf *block, size_t size, uint16_t id, uint8_t flags)
 {
+    __ASSERT_NO_MSG(id <= BLOCK_ID_EXT_MAX);
+
     sys_put_be16(size, buf_claim(block, sizeof(uint16_t)));
-    *buf_claim(block, 1) = id | flags;
+
+    if (id > BLOCK_ID_MASK)
+    {
+        *buf_claim(block, 1) = (id & BLOCK_ID_MASK) | EXT_ID_MASK | flags;
+        *buf_claim(block, 1) = id >> ID_FIELD_BITS;
+    }
+    else
+    {
+        *buf_claim(block, 1) = id | flags;
+    }
 }
 
 size_t block_space_get(const struct pouch_buf *block)
@@ -81,7 +115,8 @@ void block_size_write(struct pouch_buf *block, uint16_t size)
 
 struct pouch_buf *block_alloc(void)
 {
-    struct pouch_buf *block = buf_alloc(MAX_PLAINTEXT_BLOCK_SIZE);
+    // Blocks are encrypted in place, so leave room for the authentication tag:
+    struct pouch_buf *block = buf_alloc(MAX_CIPHERTEXT_BLOCK_SIZE);
     if (block != NULL)
     {
         write_block_header(block, 0, BLOCK_ID_ENTRY, FIRST_DATA_MASK | LAST_DATA_MASK);
@@ -90,9 +125,9 @@ struct pouch_buf *block_alloc(void)
     return block;
 }
 
-struct pouch_buf *block_alloc_stream(uint8_t stream_id, bool first)
+struct pouch_buf *block_alloc_stream(uint16_t stream_id, bool first)
 {
-    struct pouch_buf *block = buf_alloc(MAX_PLAINTEXT_BLOCK_SIZE);
+    struct pouch_buf *block = buf_alloc(MAX_CIPHERTEXT_BLOCK_SIZE);
     if (block != NULL)
     {
         write_block_header(block, 0, stream_id, first ? FIRST_DATA_MASK : 0);
@@ -106,7 +141,7 @@ void block_free(struct pouch_buf *block)
     buf_free(block);
 }
 
-static void finish(struct pouch_buf *block, uint8_t id, uint8_t flags)
+static void finish(struct pouch_buf *block, uint8_t flags)
 {
     size_t size = block_size_get(block);
     pouch_buf_state_t state = buf_state_get(block);
@@ -122,10 +157,10 @@ static void finish(struct pouch_buf *block, uint8_t id, uint8_t flags)
 
 void block_finish(struct pouch_buf *block)
 {
-    finish(block, BLOCK_ID_ENTRY, FIRST_DATA_MASK | LAST_DATA_MASK);
+    finish(block, FIRST_DATA_MASK | LAST_DATA_MASK);
 }
 
-void block_finish_stream(struct pouch_buf *block, uint8_t stream_id, bool last)
+void block_finish_stream(struct pouch_buf *block, bool last)
 {
-    finish(block, stream_id, last ? LAST_DATA_MASK : 0);
+    finish(block, last ? LAST_DATA_MASK : 0);
 }
@@ -12,6 +12,9 @@
 
 #define BLOCK_ID_MASK 0x1f
 
+/** Highest stream ID that can be encoded in an extended block header */
+#define BLOCK_ID_EXT_MAX 0x1fff
+
 /** Log2 of max block size */
 #define MAX_BLOCK_PAYLOAD_SIZE_LOG LOG2(CONFIG_POUCH_BLOCK_SIZE)
 /** Rounded maximum block size */
@@ -27,14 +30,14 @@
 
 void block_decode_hdr(struct pouch_bufview *v,
                       uint16_t *block_size,
-                      uint8_t *stream_id,
+                      uint16_t *stream_id,
                       bool *is_stream,
                       bool *is_first,
                       bool *is_last);
 
 struct pouch_buf *block_alloc(void);
 
-struct pouch_buf *block_alloc_stream(uint8_t stream_id, bool first);
+struct pouch_buf *block_alloc_stream(uint16_t stream_id, bool first);
 
 void block_free(struct pouch_buf *block);
 
@@ -43,4 +46,4 @@ size_t block_size_get(const struct pouch_buf *block);
 void block_size_write(struct pouch_buf *block, uint16_t size);
 
 void block_finish(struct pouch_buf *block);
-void block_finish_stream(struct pouch_buf *block, uint8_t stream_id, bool last);
+void block_finish_stream(struct pouch_buf *block, bool last);
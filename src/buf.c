@@ -113,6 +113,24 @@ void buf_queue_submit(pouch_buf_queue_t *queue, struct pouch_buf *buf)
     sys_slist_append(queue, &buf->node);
 }
 
+void buf_queue_submit_all(pouch_buf_queue_t *queue, pouch_buf_queue_t *bufs)
+{
+    sys_slist_merge_slist(queue, bufs);
+}
+
+size_t buf_queue_size_get(pouch_buf_queue_t *queue)
+{
+    struct pouch_buf *buf;
+    size_t size = 0;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(queue, buf, node)
+    {
+        size += buf_size_get(buf);
+    }
+
+    return size;
+}
+
 struct pouch_buf *buf_queue_get(pouch_buf_queue_t *queue)
 {
     sys_snode_t *n = sys_slist_get(queue);
@@ -76,6 +76,12 @@ void buf_queue_init(pouch_buf_queue_t *queue);
 /** Submit a buffer to the queue */
 void buf_queue_submit(pouch_buf_queue_t *queue, struct pouch_buf *buf);
 
+/** Move all buffers in @a bufs to the end of the queue, leaving @a bufs empty */
+void buf_queue_submit_all(pouch_buf_queue_t *queue, pouch_buf_queue_t *bufs);
+
+/** Get the total number of bytes in the buffers in the queue */
+size_t buf_queue_size_get(pouch_buf_queue_t *queue);
+
 /** Get a buffer from the queue */
 struct pouch_buf *buf_queue_get(pouch_buf_queue_t *queue);
 
@@ -5,13 +5,21 @@
  */
 
 #include "cert.h"
+#include "saead/uplink.h"
+#include <stdlib.h>
+#include <string.h>
 #include <psa/crypto.h>
 #include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
 #include <pouch/transport/certificate.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(cert, CONFIG_POUCH_LOG_LEVEL);
 
+#define CERT_SETTINGS_ROOT "pouch/cert"
+#define CERT_SERVER_KEY "srv"
+
 static const uint8_t raw_ca_cert[] = {
 #if IS_ENABLED(CONFIG_POUCH_VALIDATE_SERVER_CERT)
 #include "golioth_ca_cert.inc"
@@ -25,6 +33,8 @@ static struct
 } device;
 static struct
 {
+    /** Hash of the certificate the key and serial were extracted from */
+    uint8_t ref[CERT_REF_LEN];
     struct pubkey pubkey;
     struct
     {
@@ -32,6 +42,17 @@ static struct
         size_t len;
     } serial;
 } server_cert;
+/** Server certificate being received with cert_server_ingest_push() */
+static struct
+{
+    psa_hash_operation_t hash;
+    uint8_t *buffer;
+    size_t size;
+    size_t received;
+    /** Start of the certificate, until its length is known */
+    uint8_t header[4];
+    int err;
+} ingest;
 
 static inline bool cert_is_valid(const struct pouch_cert *cert)
 {
@@ -168,6 +189,225 @@ int cert_device_set(const struct pouch_cert *cert)
     return 0;
 }
 
+#if defined(CONFIG_POUCH_SERVER_CERT_CACHE)
+
+#define SERVER_CERT_RECORD_VERSION 1
+
+/**
+ * Cached server certificate, as stored in the settings. Only has byte fields, so the layout doesn't
+ * depend on the compiler.
+ */
+struct server_cert_record
+{
+    uint8_t version;
+    /** Whether the certificate was validated against the CA certificate when it was cached */
+    uint8_t validated;
+    /** Hash of the CA certificate, or zeros if the certificate wasn't validated */
+    uint8_t ca_ref[CERT_REF_LEN];
+    uint8_t ref[CERT_REF_LEN];
+    /** Little endian public key length */
+    uint8_t pubkey_len[sizeof(uint16_t)];
+    uint8_t pubkey[PUBKEY_LEN];
+    uint8_t serial_len;
+    uint8_t serial[CERT_SERIAL_MAXLEN];
+};
+
+BUILD_ASSERT(PUBKEY_LEN <= UINT16_MAX);
+BUILD_ASSERT(CERT_SERIAL_MAXLEN <= UINT8_MAX);
+
+/** Set if the cached record was made under a different configuration, and must be deleted */
+static bool server_cert_stale;
+
+/** Hash of the CA certificate that server certificates are validated against */
+static int ca_ref_get(uint8_t ref[CERT_REF_LEN])
+{
+    memset(ref, 0, CERT_REF_LEN);
+
+    if (!IS_ENABLED(CONFIG_POUCH_VALIDATE_SERVER_CERT))
+    {
+        return 0;
+    }
+
+    const struct pouch_cert ca_cert_data = {
+        .buffer = raw_ca_cert,
+        .size = sizeof(raw_ca_cert),
+    };
+
+    return generate_ref(&ca_cert_data, ref);
+}
+
+/**
+ * Whether the record was cached with the current record format and CA certificate, and with
+ * server certificate validation enabled or disabled as it is now.
+ */
+static bool server_cert_record_is_current(const struct server_cert_record *record)
+{
+    uint8_t ca_ref[CERT_REF_LEN];
+
+    if (record->version != SERVER_CERT_RECORD_VERSION)
+    {
+        LOG_WRN("Discarding cached server cert of version %u", record->version);
+        return false;
+    }
+
+    if (record->validated != IS_ENABLED(CONFIG_POUCH_VALIDATE_SERVER_CERT))
+    {
+        LOG_WRN("Discarding cached server cert, validation setting changed");
+        return false;
+    }
+
+    if (ca_ref_get(ca_ref) != 0 || memcmp(ca_ref, record->ca_ref, CERT_REF_LEN) != 0)
+    {
+        LOG_WRN("Discarding cached server cert, CA cert changed");
+        return false;
+    }
+
+    if (sys_get_le16(record->pubkey_len) > sizeof(server_cert.pubkey.data)
+        || record->serial_len > sizeof(server_cert.serial.data))
+    {
+        LOG_WRN("Discarding invalid cached server cert");
+        return false;
+    }
+
+    return true;
+}
+
+static int server_cert_load_cb(const char *key,
+                               size_t len,
+                               settings_read_cb read_cb,
+                               void *cb_arg,
+                               void *param)
+{
+    struct server_cert_record record;
+
+    if (key == NULL || strcmp(key, CERT_SERVER_KEY) != 0)
+    {
+        return 0;
+    }
+
+    if (len != sizeof(record))
+    {
+        LOG_WRN("Discarding cached server cert of unexpected size: %u", len);
+        server_cert_stale = true;
+        return 0;
+    }
+
+    ssize_t ret = read_cb(cb_arg, &record, sizeof(record));
+    if (ret != sizeof(record) || !server_cert_record_is_current(&record))
+    {
+        server_cert_stale = true;
+        return 0;
+    }
+
+    memcpy(server_cert.ref, record.ref, CERT_REF_LEN);
+    server_cert.pubkey.len = sys_get_le16(record.pubkey_len);
+    memcpy(server_cert.pubkey.data, record.pubkey, server_cert.pubkey.len);
+    server_cert.serial.len = record.serial_len;
+    memcpy(server_cert.serial.data, record.serial, server_cert.serial.len);
+
+    return 0;
+}
+
+void cert_server_load(void)
+{
+    server_cert_stale = false;
+
+    int err = settings_load_subtree_direct(CERT_SETTINGS_ROOT, server_cert_load_cb, NULL);
+    if (err)
+    {
+        LOG_WRN("Failed loading cached server cert: %d", err);
+        return;
+    }
+
+    if (server_cert_stale)
+    {
+        (void) settings_delete(CERT_SETTINGS_ROOT "/" CERT_SERVER_KEY);
+    }
+
+    if (cert_has_server_info())
+    {
+        LOG_DBG("Restored cached server key");
+    }
+}
+
+static void server_cert_save(void)
+{
+    struct server_cert_record record = {
+        .version = SERVER_CERT_RECORD_VERSION,
+        .validated = IS_ENABLED(CONFIG_POUCH_VALIDATE_SERVER_CERT),
+        .serial_len = server_cert.serial.len,
+    };
+
+    int err = ca_ref_get(record.ca_ref);
+    if (err)
+    {
+        LOG_WRN("Failed caching server cert: %d", err);
+        return;
+    }
+
+    memcpy(record.ref, server_cert.ref, CERT_REF_LEN);
+    sys_put_le16(server_cert.pubkey.len, record.pubkey_len);
+    memcpy(record.pubkey, server_cert.pubkey.data, server_cert.pubkey.len);
+    memcpy(record.serial, server_cert.serial.data, server_cert.serial.len);
+
+    err = settings_save_one(CERT_SETTINGS_ROOT "/" CERT_SERVER_KEY, &record, sizeof(record));
+    if (err)
+    {
+        // The key is still valid until the next reboot:
+        LOG_WRN("Failed caching server cert: %d", err);
+    }
+}
+
+#else
+
+void cert_server_load(void) {}
+
+static void server_cert_save(void) {}
+
+#endif /* CONFIG_POUCH_SERVER_CERT_CACHE */
+
+/** Whether the key and serial were already extracted from the certificate with the given hash */
+static bool server_cert_is_current(const uint8_t ref[CERT_REF_LEN])
+{
+    return cert_has_server_info() && memcmp(ref, server_cert.ref, CERT_REF_LEN) == 0;
+}
+
+static int server_cert_store(mbedtls_x509_crt *cert, const uint8_t ref[CERT_REF_LEN])
+{
+    int err;
+
+    if (IS_ENABLED(CONFIG_POUCH_VALIDATE_SERVER_CERT))
+    {
+        err = authenticate_server_cert(cert);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    if (cert->serial.len > sizeof(server_cert.serial.data))
+    {
+        LOG_ERR("Unexpected server certificate serial number size: %u", cert->serial.len);
+        return -EINVAL;
+    }
+
+    err = extract_pubkey(cert, &server_cert.pubkey);
+    if (err)
+    {
+        return err;
+    }
+
+    memcpy(server_cert.ref, ref, CERT_REF_LEN);
+    memcpy(server_cert.serial.data, cert->serial.p, cert->serial.len);
+    server_cert.serial.len = cert->serial.len;
+
+    server_cert_save();
+
+    LOG_DBG("Server key stored");
+
+    return 0;
+}
+
 int cert_server_set(const struct pouch_cert *certbuf)
 {
     int err;
@@ -177,6 +417,19 @@ int cert_server_set(const struct pouch_cert *certbuf)
         return -EINVAL;
     }
 
+    uint8_t ref[CERT_REF_LEN];
+    err = generate_ref(certbuf, ref);
+    if (err)
+    {
+        return err;
+    }
+
+    if (server_cert_is_current(ref))
+    {
+        LOG_DBG("Server cert unchanged");
+        return 0;
+    }
+
     mbedtls_x509_crt cert_chain;
     err = parse_x509_cert(certbuf, &cert_chain);
     if (err)
@@ -185,37 +438,203 @@ int cert_server_set(const struct pouch_cert *certbuf)
         goto exit;
     }
 
-    if (IS_ENABLED(CONFIG_POUCH_VALIDATE_SERVER_CERT))
+    err = server_cert_store(&cert_chain, ref);
+
+exit:
+    mbedtls_x509_crt_free(&cert_chain);
+    return err;
+}
+
+/**
+ * Parse the length of a DER encoded certificate from its first bytes.
+ *
+ * @return Total length of the certificate, 0 if more bytes are needed, or a negative error code.
+ */
+static ssize_t der_cert_len(const uint8_t *header, size_t len)
+{
+    if (len < 2)
     {
-        err = authenticate_server_cert(&cert_chain);
-        if (err)
+        return 0;
+    }
+
+    // The certificate is a SEQUENCE, with a short or 1-2 byte long form length:
+    if (header[0] != 0x30 || header[1] == 0x80 || header[1] > 0x82)
+    {
+        return -EINVAL;
+    }
+
+    if (header[1] < 0x80)
+    {
+        return 2 + header[1];
+    }
+
+    size_t len_bytes = header[1] & 0x7f;
+    if (len < 2 + len_bytes)
+    {
+        return 0;
+    }
+
+    size_t content_len = 0;
+    for (size_t i = 0; i < len_bytes; i++)
+    {
+        content_len = (content_len << 8) | header[2 + i];
+    }
+
+    return 2 + len_bytes + content_len;
+}
+
+/** Free the certificate being received, and fail any further parts with the given error */
+static int ingest_fail(int err)
+{
+    cert_server_ingest_abort();
+    ingest.err = err;
+
+    return err;
+}
+
+void cert_server_ingest_start(void)
+{
+    cert_server_ingest_abort();
+
+    ingest.hash = psa_hash_operation_init();
+    psa_status_t status = psa_hash_setup(&ingest.hash, CERT_REF_HASH_ALG);
+    if (status != PSA_SUCCESS)
+    {
+        ingest_fail(-EIO);
+    }
+}
+
+int cert_server_ingest_push(const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    if (ingest.err)
+    {
+        return ingest.err;
+    }
+
+    psa_status_t status = psa_hash_update(&ingest.hash, bytes, len);
+    if (status != PSA_SUCCESS)
+    {
+        return ingest_fail(-EIO);
+    }
+
+    // Collect the DER header until the length of the certificate is known:
+    while (ingest.buffer == NULL && len > 0)
+    {
+        ingest.header[ingest.received++] = *bytes++;
+        len--;
+
+        ssize_t cert_len = der_cert_len(ingest.header, ingest.received);
+        if (cert_len < 0 || (cert_len == 0 && ingest.received == sizeof(ingest.header)))
         {
-            goto exit;
+            LOG_ERR("Invalid server cert header");
+            return ingest_fail(-EINVAL);
         }
+
+        if (cert_len > CONFIG_POUCH_SERVER_CERT_MAX_LEN)
+        {
+            LOG_ERR("Server cert too large: %d", (int) cert_len);
+            return ingest_fail(-EFBIG);
+        }
+
+        if (cert_len > 0)
+        {
+            ingest.buffer = malloc(cert_len);
+            if (ingest.buffer == NULL)
+            {
+                return ingest_fail(-ENOMEM);
+            }
+
+            ingest.size = cert_len;
+            memcpy(ingest.buffer, ingest.header, ingest.received);
+        }
+    }
+
+    if (ingest.buffer == NULL)
+    {
+        return 0;
     }
 
-    if (cert_chain.serial.len > sizeof(server_cert.serial.data))
+    if (len > ingest.size - ingest.received)
     {
-        LOG_ERR("Unexpected server certificate serial number size: %u", cert_chain.serial.len);
+        LOG_ERR("Server cert longer than its header");
+        return ingest_fail(-EFBIG);
+    }
+
+    memcpy(&ingest.buffer[ingest.received], bytes, len);
+    ingest.received += len;
+
+    return 0;
+}
+
+static int ingest_store(const uint8_t ref[CERT_REF_LEN])
+{
+    mbedtls_x509_crt cert;
+    mbedtls_x509_crt_init(&cert);
+
+    // The certificate is parsed in place, so the buffer must outlive the parsed certificate:
+    int err = mbedtls_x509_crt_parse_der_nocopy(&cert, ingest.buffer, ingest.size);
+    if (err)
+    {
+        LOG_ERR("Failed to parse server cert: 0x%x", -err);
+        err = -EIO;
         goto exit;
     }
 
-    err = extract_pubkey(&cert_chain, &server_cert.pubkey);
+    err = server_cert_store(&cert, ref);
+
+exit:
+    mbedtls_x509_crt_free(&cert);
+    return err;
+}
+
+int cert_server_ingest_finish(void)
+{
+    uint8_t ref[CERT_REF_LEN];
+    size_t hash_len;
+
+    int err = ingest.err;
     if (err)
     {
         goto exit;
     }
 
-    memcpy(server_cert.serial.data, cert_chain.serial.p, cert_chain.serial.len);
-    server_cert.serial.len = cert_chain.serial.len;
+    if (ingest.buffer == NULL || ingest.received != ingest.size)
+    {
+        LOG_ERR("Incomplete server cert");
+        err = -EINVAL;
+        goto exit;
+    }
 
-    LOG_DBG("Server key stored");
+    psa_status_t status = psa_hash_finish(&ingest.hash, ref, sizeof(ref), &hash_len);
+    if (status != PSA_SUCCESS)
+    {
+        err = -EIO;
+        goto exit;
+    }
+
+    if (server_cert_is_current(ref))
+    {
+        LOG_DBG("Server cert unchanged");
+        goto exit;
+    }
+
+    err = ingest_store(ref);
 
 exit:
-    mbedtls_x509_crt_free(&cert_chain);
+    cert_server_ingest_abort();
     return err;
 }
 
+void cert_server_ingest_abort(void)
+{
+    psa_hash_abort(&ingest.hash);
+    free(ingest.buffer);
+
+    memset(&ingest, 0, sizeof(ingest));
+}
+
 const uint8_t *cert_ref_get(void)
 {
     if (!cert_is_valid(&device.certificate))
@@ -242,7 +661,43 @@ bool cert_has_server_info(void)
 
 int pouch_server_certificate_set(const struct pouch_cert *cert)
 {
-    return cert_server_set(cert);
+    int err = cert_server_set(cert);
+    if (err)
+    {
+        return err;
+    }
+
+    saead_uplink_session_precompute();
+
+    return 0;
+}
+
+void pouch_server_certificate_start(void)
+{
+    cert_server_ingest_start();
+}
+
+int pouch_server_certificate_push(const void *buf, size_t buf_len)
+{
+    return cert_server_ingest_push(buf, buf_len);
+}
+
+int pouch_server_certificate_finish(void)
+{
+    int err = cert_server_ingest_finish();
+    if (err)
+    {
+        return err;
+    }
+
+    saead_uplink_session_precompute();
+
+    return 0;
+}
+
+void pouch_server_certificate_abort(void)
+{
+    cert_server_ingest_abort();
 }
 
 ssize_t pouch_server_certificate_serial_get(uint8_t *serial, size_t len)
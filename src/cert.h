@@ -18,6 +18,26 @@
 
 int cert_device_set(const struct pouch_cert *cert);
 int cert_server_set(const struct pouch_cert *cert);
+
+/** Start receiving a DER encoded server certificate in parts */
+void cert_server_ingest_start(void);
+/**
+ * Receive the next part of the server certificate.
+ *
+ * The certificate is hashed as it arrives, and buffered in an allocation that fits the length in
+ * its DER header.
+ *
+ * @retval -EINVAL The certificate isn't DER encoded
+ * @retval -EFBIG The certificate is larger than CONFIG_POUCH_SERVER_CERT_MAX_LEN, or than its
+ *                header says
+ */
+int cert_server_ingest_push(const void *data, size_t len);
+/** Verify the received server certificate, and store its key and serial */
+int cert_server_ingest_finish(void);
+/** Discard the server certificate being received */
+void cert_server_ingest_abort(void);
+/** Restore the server key and serial cached by an earlier call to cert_server_set() */
+void cert_server_load(void);
 const uint8_t *cert_ref_get(void);
 
 void cert_server_key_get(struct pubkey *out);
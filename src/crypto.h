@@ -10,8 +10,8 @@
 #include "buf.h"
 #include <pouch/pouch.h>
 
-/** Initialize crypto module */
-int crypto_init(const struct pouch_config *config);
+/** Initialize crypto module, with the work queue to run background operations on */
+int crypto_init(const struct pouch_config *config, struct k_work_q *work_q);
 
 /** Notify the crypto module that a new pouch session is starting */
 int crypto_session_start(void);
@@ -22,18 +22,36 @@ void crypto_session_end(void);
 /** Start a new downlink pouch */
 int crypto_downlink_start(const struct encryption_info *encryption_info);
 
-/** Initialize a new pouch in the encryption engine. */
+/**
+ * Initialize a new pouch in the encryption engine. Returns -ENOSPC if the session can't hold any
+ * more pouches.
+ */
 int crypto_pouch_start(void);
 
 /** Construct the encryption info part of the pouch header */
 int crypto_header_get(struct encryption_info *encryption_info);
 
+/**
+ * Construct the encryption info for later pouches in the session. This may refer to the session
+ * described by the first pouch's header instead of repeating it.
+ */
+int crypto_header_ref_get(struct encryption_info *encryption_info);
+
+/** Get the ID of the current uplink pouch, or 0 if the encryption doesn't identify pouches */
+uint16_t crypto_pouch_id_get(void);
+
 /**
  * Decrypt a block of data.
+ *
+ * The block is decrypted in place, and returned. On failure, the block is freed and NULL is
+ * returned.
  */
 struct pouch_buf *crypto_decrypt_block(struct pouch_buf *block);
 
 /**
- * Encrypt a block of data.
+ * Encrypt a batch of blocks in the current pouch.
+ *
+ * The blocks are encrypted in place, in queue order. Blocks that fail to encrypt are removed from
+ * the queue and freed.
  */
-struct pouch_buf *crypto_encrypt_block(struct pouch_buf *block);
+void crypto_encrypt_blocks(pouch_buf_queue_t *blocks);
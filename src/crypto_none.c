@@ -9,7 +9,7 @@
 
 static const char *device_id;
 
-int crypto_init(const struct pouch_config *config)
+int crypto_init(const struct pouch_config *config, struct k_work_q *work_q)
 {
     if (config->device_id == NULL)
     {
@@ -57,12 +57,19 @@ int crypto_header_get(struct encryption_info *encryption_info)
     return 0;
 }
 
-struct pouch_buf *crypto_decrypt_block(struct pouch_buf *block)
+int crypto_header_ref_get(struct encryption_info *encryption_info)
 {
-    return block;
+    return crypto_header_get(encryption_info);
+}
+
+uint16_t crypto_pouch_id_get(void)
+{
+    return 0;
 }
 
-struct pouch_buf *crypto_encrypt_block(struct pouch_buf *block)
+struct pouch_buf *crypto_decrypt_block(struct pouch_buf *block)
 {
     return block;
 }
+
+void crypto_encrypt_blocks(pouch_buf_queue_t *blocks) {}
@@ -7,19 +7,24 @@
 #include "crypto.h"
 #include "saead/uplink.h"
 #include "saead/downlink.h"
+#include "saead/benchmark.h"
 #include "cert.h"
 
 #if CONFIG_POUCH_ENCRYPTION_CHACHA20_POLY1305
 #define ENCRYPTION_ALGORITHM PSA_ALG_CHACHA20_POLY1305
 #elif CONFIG_POUCH_ENCRYPTION_AES_GCM
 #define ENCRYPTION_ALGORITHM PSA_ALG_GCM
+#elif CONFIG_POUCH_ENCRYPTION_AUTO
+// Used if the algorithms can't be measured:
+#define ENCRYPTION_ALGORITHM PSA_ALG_CHACHA20_POLY1305
 #else
 #error "unknown encryption algorithm"
 #endif
 
 static psa_key_id_t pkey;
+static psa_algorithm_t algorithm = ENCRYPTION_ALGORITHM;
 
-int crypto_init(const struct pouch_config *config)
+int crypto_init(const struct pouch_config *config, struct k_work_q *work_q)
 {
     if (config->private_key == PSA_KEY_ID_NULL)
     {
@@ -34,11 +39,42 @@ int crypto_init(const struct pouch_config *config)
 
     pkey = config->private_key;
 
+    // Restore the server key before initializing the uplink, so the first session can be
+    // precomputed:
+    cert_server_load();
+
+#if CONFIG_POUCH_ENCRYPTION_AUTO
+    algorithm = saead_benchmark_run(ENCRYPTION_ALGORITHM);
+#endif
+
+    saead_uplink_init(work_q, algorithm, pkey);
+
     return 0;
 }
 
+static int downlink_ref_start(const struct saead_ref_info *info)
+{
+    if (info->session_ref.len != SESSION_REF_LEN)
+    {
+        return -EINVAL;
+    }
+
+    int err = saead_downlink_session_ref_start(info->session_ref.value, pkey);
+    if (err)
+    {
+        return err;
+    }
+
+    return saead_downlink_pouch_start(info->pouch_id);
+}
+
 int crypto_downlink_start(const struct encryption_info *encryption_info)
 {
+    if (encryption_info->Union_choice == encryption_info_union_saead_ref_info_m_c)
+    {
+        return downlink_ref_start(&encryption_info->saead_ref_info_m);
+    }
+
     if (encryption_info->Union_choice != encryption_info_union_saead_info_m_c)
     {
         return -ENOTSUP;
@@ -92,7 +128,7 @@ int crypto_downlink_start(const struct encryption_info *encryption_info)
 
 int crypto_session_start(void)
 {
-    return saead_uplink_session_start(ENCRYPTION_ALGORITHM, pkey);
+    return saead_uplink_session_start(algorithm, pkey);
 }
 
 void crypto_session_end(void)
@@ -112,12 +148,37 @@ int crypto_header_get(struct encryption_info *encryption_info)
     return saead_uplink_header_get(&encryption_info->saead_info_m);
 }
 
+int crypto_header_ref_get(struct encryption_info *encryption_info)
+{
+    encryption_info->Union_choice = encryption_info_union_saead_ref_info_m_c;
+    return saead_uplink_header_ref_get(&encryption_info->saead_ref_info_m);
+}
+
+uint16_t crypto_pouch_id_get(void)
+{
+    return saead_uplink_pouch_id_get();
+}
+
 struct pouch_buf *crypto_decrypt_block(struct pouch_buf *block)
 {
     return saead_downlink_block_decrypt(block);
 }
 
-struct pouch_buf *crypto_encrypt_block(struct pouch_buf *block)
+void crypto_encrypt_blocks(pouch_buf_queue_t *blocks)
 {
-    return saead_uplink_encrypt_block(block);
+    saead_uplink_encrypt_blocks(blocks);
+}
+
+psa_algorithm_t pouch_encryption_algorithm_get(void)
+{
+    return algorithm;
+}
+
+uint32_t pouch_encryption_throughput_get(psa_algorithm_t alg)
+{
+#if CONFIG_POUCH_ENCRYPTION_AUTO
+    return saead_benchmark_throughput_get(alg);
+#else
+    return 0;
+#endif
 }
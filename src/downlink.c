@@ -15,7 +15,9 @@
 #include "block.h"
 #include "crypto.h"
 #include "downlink.h"
+#include "downlink_router.h"
 #include "entry.h"
+#include "pouch.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(downlink, CONFIG_POUCH_LOG_LEVEL);
@@ -23,6 +25,12 @@ LOG_MODULE_REGISTER(downlink, CONFIG_POUCH_LOG_LEVEL);
 static struct pouch_buf *pouch_buf;
 static bool pouch_header;
 
+/** Number of blocks pushed by the transport that haven't been consumed yet */
+static atomic_t blocks_in_flight;
+
+/** Whether a transport is waiting for the window to open up */
+static atomic_t window_waiting;
+
 static struct
 {
     pouch_buf_queue_t queue;
@@ -34,6 +42,8 @@ static struct
     pouch_buf_queue_t buf_queue;
     struct k_work_q *work_queue;
     struct k_work work;
+    /** Block held by an asynchronous downlink handler */
+    struct pouch_buf *pending;
 } consume;
 
 static void decrypt_blocks(struct k_work *work);
@@ -49,17 +59,52 @@ void downlink_init(struct k_work_q *pouch_work_queue)
     k_work_init(&consume.work, consume_blocks);
 }
 
+/** Release a block from the window, and tell the transport if it was waiting for room */
+static void block_release(void)
+{
+    atomic_dec(&blocks_in_flight);
+
+    if (atomic_cas(&window_waiting, 1, 0))
+    {
+        pouch_event_emit(POUCH_EVENT_DOWNLINK_WINDOW_OPEN);
+    }
+}
+
 static void consume_blocks(struct k_work *work)
 {
-    struct pouch_buf *pouch_buf = buf_queue_get(&consume.buf_queue);
-    if (!pouch_buf)
+    int err;
+
+    if (consume.pending)
     {
-        return;
+        if (downlink_router_ack_pending())
+        {
+            return;
+        }
+
+        err = pouch_downlink_block_resume();
     }
+    else
+    {
+        consume.pending = buf_queue_get(&consume.buf_queue);
+        if (!consume.pending)
+        {
+            return;
+        }
 
-    pouch_downlink_block_push(pouch_buf);
+        err = pouch_downlink_block_push(consume.pending);
+    }
 
-    buf_free(pouch_buf);
+    if (err == -EINPROGRESS)
+    {
+        /* The block stays in flight until the handler acknowledges it. Blocks received in the
+         * meantime queue up behind it, until the downlink window closes.
+         */
+        return;
+    }
+
+    buf_free(consume.pending);
+    consume.pending = NULL;
+    block_release();
 
     if (!buf_queue_is_empty(&consume.buf_queue))
     {
@@ -67,16 +112,23 @@ static void consume_blocks(struct k_work *work)
     }
 }
 
+void downlink_resume(void)
+{
+    k_work_submit_to_queue(consume.work_queue, &consume.work);
+}
+
 static void decrypt_blocks(struct k_work *work)
 {
     struct pouch_buf *decrypted = crypto_decrypt_block(buf_queue_get(&decrypt.queue));
-    if (!decrypted)
+    if (decrypted)
     {
-        return;
+        buf_queue_submit(&consume.buf_queue, decrypted);
+        k_work_submit_to_queue(consume.work_queue, &consume.work);
+    }
+    else
+    {
+        block_release();
     }
-
-    buf_queue_submit(&consume.buf_queue, decrypted);
-    k_work_submit_to_queue(consume.work_queue, &consume.work);
 
     if (!buf_queue_is_empty(&decrypt.queue))
     {
@@ -86,6 +138,7 @@ static void decrypt_blocks(struct k_work *work)
 
 static void block_downlink_push(struct pouch_buf *pouch_buf)
 {
+    atomic_inc(&blocks_in_flight);
     buf_queue_submit(&decrypt.queue, pouch_buf);
     k_work_submit(&decrypt.work);
 }
@@ -126,6 +179,14 @@ static int pouch_downlink_parse_header(struct pouch_bufview *v, size_t *header_l
                 : "SAEAD");
     LOG_DBG("Payload len %d", (int) *header_len);
 
+    // Session references were introduced in header version 2:
+    if (header.encryption_info_m.Union_choice == encryption_info_union_saead_ref_info_m_c
+        && header.version < 2)
+    {
+        LOG_ERR("Session reference in version %d header", (int) header.version);
+        return -EINVAL;
+    }
+
     int err = crypto_downlink_start(&header.encryption_info_m);
     if (err)
     {
@@ -136,10 +197,50 @@ static int pouch_downlink_parse_header(struct pouch_bufview *v, size_t *header_l
     return 0;
 }
 
-void pouch_downlink_push(const void *buf, size_t buf_len)
+size_t pouch_downlink_window_get(void)
+{
+    atomic_val_t in_flight = atomic_get(&blocks_in_flight);
+    if (in_flight >= CONFIG_POUCH_DOWNLINK_WINDOW)
+    {
+        return 0;
+    }
+
+    size_t window = (CONFIG_POUCH_DOWNLINK_WINDOW - in_flight) * MAX_CIPHERTEXT_BLOCK_SIZE;
+
+    // The block that's currently being reassembled has already used part of the window:
+    if (pouch_buf)
+    {
+        window -= MIN(window, buf_size_get(pouch_buf));
+    }
+
+    return window;
+}
+
+bool pouch_downlink_window_check(size_t len)
+{
+    // Mark the wait first, so a block released while checking still emits the event:
+    atomic_set(&window_waiting, 1);
+
+    if (len > pouch_downlink_window_get())
+    {
+        return false;
+    }
+
+    atomic_set(&window_waiting, 0);
+
+    return true;
+}
+
+int pouch_downlink_push(const void *buf, size_t buf_len)
 {
     const uint8_t *buf_p = buf;
 
+    if (!pouch_downlink_window_check(buf_len))
+    {
+        LOG_DBG("Downlink window full");
+        return -EAGAIN;
+    }
+
     LOG_HEXDUMP_DBG(buf, buf_len, "Pouch downlink push: ");
 
     while (buf_len)
@@ -147,13 +248,13 @@ void pouch_downlink_push(const void *buf, size_t buf_len)
         if (!pouch_buf)
         {
             LOG_WRN("No pouch_buf allocated");
-            return;
+            return -ENOMEM;
         }
 
         if (buf_size_get(pouch_buf) >= MAX_CIPHERTEXT_BLOCK_SIZE)
         {
             LOG_ERR("No more space for pouch header");
-            return;
+            return -EINVAL;
         }
 
         size_t buf_written = MIN(buf_len, MAX_CIPHERTEXT_BLOCK_SIZE - buf_size_get(pouch_buf));
@@ -171,7 +272,7 @@ void pouch_downlink_push(const void *buf, size_t buf_len)
             int err = pouch_downlink_parse_header(&v, &header_len);
             if (err)
             {
-                return;
+                return err;
             }
 
             pouch_header = true;
@@ -191,7 +292,7 @@ void pouch_downlink_push(const void *buf, size_t buf_len)
                 LOG_ERR("Block size %u is bigger than supported %u",
                         (unsigned int) block_size,
                         (unsigned int) (MAX_BLOCK_SIZE_FIELD_VALUE));
-                return;
+                return -EINVAL;
             }
 
             if (pouch_bufview_available(&v) >= block_size)
@@ -224,6 +325,8 @@ void pouch_downlink_push(const void *buf, size_t buf_len)
             }
         }
     }
+
+    return 0;
 }
 
 void pouch_downlink_finish(void)
@@ -10,3 +10,6 @@
 
 /** Initialize the pouch downlink handler */
 void downlink_init(struct k_work_q *pouch_work_queue);
+
+/** Resume the downlink consumption after an asynchronous handler is done with its data */
+void downlink_resume(void);
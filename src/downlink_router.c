@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "downlink_router.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pouch/downlink.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "downlink.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(downlink_router, CONFIG_POUCH_LOG_LEVEL);
+
+/* The handlers live in a RAM iterable section, which is sorted in place on init:
+ *
+ * +----------------------+-------------------------------------------+
+ * | catch-all handlers   | path handlers, sorted by path             |
+ * +----------------------+-------------------------------------------+
+ * 0                      first_route                                 count
+ *
+ * Catch-all handlers receive all downlink traffic. Each entry or stream is routed to at most one
+ * path handler, which is found with a binary search on the sorted part of the table.
+ */
+
+static struct pouch_downlink_handler *handlers;
+static size_t first_route;
+static size_t count;
+
+/* The path handler each active entry or stream was routed to is kept in a hash table with linear
+ * probing, indexed by stream ID. The table is never more than half full, so lookups take constant
+ * time on average.
+ */
+#define STREAM_SLOTS (2 * CONFIG_POUCH_DOWNLINK_STREAMS_MAX)
+
+static struct
+{
+    struct pouch_downlink_handler *handler;
+    uint16_t stream_id;
+    bool active;
+} streams[STREAM_SLOTS];
+static size_t active_streams;
+
+/* Stream ID + 1 of the data held by an asynchronous handler, or 0. Set before the handler is
+ * called, so the handler can acknowledge the data from another thread before it returns.
+ */
+static atomic_t ack_pending;
+
+static bool route_is_wildcard(const struct pouch_downlink_handler *handler)
+{
+    size_t len = strlen(handler->path);
+
+    return len > 0 && handler->path[len - 1] == '*';
+}
+
+/** Length of the handler path, excluding the wildcard */
+static size_t route_key_len(const struct pouch_downlink_handler *handler)
+{
+    return strlen(handler->path) - (route_is_wildcard(handler) ? 1 : 0);
+}
+
+/** Compare the handler path to the first @p len bytes of @p path */
+static int route_cmp(const struct pouch_downlink_handler *handler, const char *path, size_t len)
+{
+    size_t key_len = route_key_len(handler);
+    int cmp = memcmp(handler->path, path, MIN(key_len, len));
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+
+    return (key_len > len) - (key_len < len);
+}
+
+static int handler_sort_cmp(const void *a, const void *b)
+{
+    const struct pouch_downlink_handler *ha = a;
+    const struct pouch_downlink_handler *hb = b;
+
+    if (ha->path == NULL || hb->path == NULL)
+    {
+        return (ha->path != NULL) - (hb->path != NULL);
+    }
+
+    int cmp = route_cmp(ha, hb->path, route_key_len(hb));
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+
+    /* Exact paths sort after wildcards with the same prefix */
+    return route_is_wildcard(hb) - route_is_wildcard(ha);
+}
+
+/** Find the last route that sorts before or equal to the first @p len bytes of @p path */
+static ssize_t route_floor(const char *path, size_t len)
+{
+    size_t lo = first_route;
+    size_t hi = count;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (route_cmp(&handlers[mid], path, len) <= 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return (ssize_t) lo - 1;
+}
+
+/** Find the path handler with the longest path matching @p path */
+static struct pouch_downlink_handler *route_lookup(const char *path)
+{
+    size_t path_len = strlen(path);
+    size_t len = path_len;
+
+    while (true)
+    {
+        ssize_t i = route_floor(path, len);
+        if (i < (ssize_t) first_route)
+        {
+            return NULL;
+        }
+
+        struct pouch_downlink_handler *handler = &handlers[i];
+        size_t key_len = route_key_len(handler);
+
+        if (key_len <= len && memcmp(handler->path, path, key_len) == 0)
+        {
+            if (route_is_wildcard(handler) || key_len == path_len)
+            {
+                return handler;
+            }
+
+            /* An exact path that is a prefix of this path. A wildcard with the same prefix
+             * sorts right in front of it:
+             */
+            if (i > (ssize_t) first_route && route_is_wildcard(&handlers[i - 1])
+                && route_key_len(&handlers[i - 1]) == key_len
+                && memcmp(handlers[i - 1].path, path, key_len) == 0)
+            {
+                return &handlers[i - 1];
+            }
+
+            if (key_len == 0)
+            {
+                return NULL;
+            }
+
+            len = key_len - 1;
+        }
+        else
+        {
+            /* Only routes sharing a shorter prefix with the path can match */
+            size_t common = 0;
+            while (common < MIN(key_len, len) && handler->path[common] == path[common])
+            {
+                common++;
+            }
+
+            len = common;
+        }
+    }
+}
+
+static size_t stream_slot_home(unsigned int stream_id)
+{
+    return stream_id % STREAM_SLOTS;
+}
+
+static int stream_slot_find(unsigned int stream_id)
+{
+    for (size_t i = stream_slot_home(stream_id); streams[i].active; i = (i + 1) % STREAM_SLOTS)
+    {
+        if (streams[i].stream_id == stream_id)
+        {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+static int stream_slot_add(unsigned int stream_id, struct pouch_downlink_handler *handler)
+{
+    if (active_streams == CONFIG_POUCH_DOWNLINK_STREAMS_MAX)
+    {
+        return -ENOMEM;
+    }
+
+    size_t i = stream_slot_home(stream_id);
+    while (streams[i].active)
+    {
+        i = (i + 1) % STREAM_SLOTS;
+    }
+
+    streams[i].handler = handler;
+    streams[i].stream_id = stream_id;
+    streams[i].active = true;
+    active_streams++;
+
+    return 0;
+}
+
+static void stream_slot_remove(size_t slot)
+{
+    /* Move later entries of the same probe sequence into the hole, so lookups don't stop early */
+    size_t i = (slot + 1) % STREAM_SLOTS;
+    while (streams[i].active)
+    {
+        size_t home = stream_slot_home(streams[i].stream_id);
+        bool home_in_range = (slot <= i) ? (slot < home && home <= i) : (slot < home || home <= i);
+
+        if (!home_in_range)
+        {
+            streams[slot] = streams[i];
+            slot = i;
+        }
+
+        i = (i + 1) % STREAM_SLOTS;
+    }
+
+    streams[slot].active = false;
+    active_streams--;
+}
+
+void downlink_router_init(void)
+{
+    STRUCT_SECTION_COUNT(pouch_downlink_handler, &count);
+    if (count == 0)
+    {
+        return;
+    }
+
+    STRUCT_SECTION_GET(pouch_downlink_handler, 0, &handlers);
+
+    qsort(handlers, count, sizeof(*handlers), handler_sort_cmp);
+
+    for (first_route = 0; first_route < count; first_route++)
+    {
+        if (handlers[first_route].path != NULL)
+        {
+            break;
+        }
+    }
+
+    for (size_t i = first_route + 1; i < count; i++)
+    {
+        if (strcmp(handlers[i - 1].path, handlers[i].path) == 0)
+        {
+            LOG_WRN("Multiple downlink handlers for %s", handlers[i].path);
+        }
+    }
+
+    LOG_DBG("%u catch-all handlers, %u routes",
+            (unsigned int) first_route,
+            (unsigned int) (count - first_route));
+}
+
+void downlink_router_start(unsigned int stream_id, const char *path, uint16_t content_type)
+{
+    for (size_t i = 0; i < first_route; i++)
+    {
+        handlers[i].start_cb(stream_id, path, content_type);
+    }
+
+    /* Drop the route if the previous transfer on this stream was never completed */
+    int slot = stream_slot_find(stream_id);
+    if (slot >= 0)
+    {
+        stream_slot_remove(slot);
+    }
+
+    struct pouch_downlink_handler *handler = route_lookup(path);
+    if (handler == NULL)
+    {
+        LOG_DBG("No route for %s", path);
+        return;
+    }
+
+    if (stream_slot_add(stream_id, handler) != 0)
+    {
+        LOG_WRN("Too many active downlink streams, dropping %s", path);
+        return;
+    }
+
+    handler->start_cb(stream_id, path, content_type);
+}
+
+static int route_data_async(struct pouch_downlink_handler *handler,
+                            unsigned int stream_id,
+                            const void *data,
+                            size_t len,
+                            bool is_last)
+{
+    atomic_set(&ack_pending, stream_id + 1);
+
+    int ret = handler->data_async_cb(stream_id, data, len, is_last);
+    if (ret == -EINPROGRESS)
+    {
+        return ret;
+    }
+
+    atomic_set(&ack_pending, 0);
+
+    if (ret < 0)
+    {
+        LOG_WRN("Downlink handler for %s failed: %d", handler->path, ret);
+    }
+
+    return 0;
+}
+
+int downlink_router_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+{
+    for (size_t i = 0; i < first_route; i++)
+    {
+        handlers[i].data_cb(stream_id, data, len, is_last);
+    }
+
+    int slot = stream_slot_find(stream_id);
+    if (slot < 0)
+    {
+        return 0;
+    }
+
+    struct pouch_downlink_handler *handler = streams[slot].handler;
+    if (is_last)
+    {
+        stream_slot_remove(slot);
+    }
+
+    if (handler->data_async_cb)
+    {
+        return route_data_async(handler, stream_id, data, len, is_last);
+    }
+
+    handler->data_cb(stream_id, data, len, is_last);
+
+    return 0;
+}
+
+bool downlink_router_ack_pending(void)
+{
+    return atomic_get(&ack_pending) != 0;
+}
+
+int pouch_downlink_ack(unsigned int stream_id)
+{
+    if (!atomic_cas(&ack_pending, stream_id + 1, 0))
+    {
+        return -EINVAL;
+    }
+
+    downlink_resume();
+
+    return 0;
+}
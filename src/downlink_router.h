@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Sort the registered downlink handlers into a routing table */
+void downlink_router_init(void);
+
+/** Route the start of a downlink entry or stream to the matching handlers */
+void downlink_router_start(unsigned int stream_id, const char *path, uint16_t content_type);
+
+/**
+ * Route downlink data to the handlers selected when the entry or stream started
+ *
+ * @retval 0 The data has been processed.
+ * @retval -EINPROGRESS An asynchronous handler holds on to the data until it calls
+ * pouch_downlink_ack().
+ */
+int downlink_router_data(unsigned int stream_id, const void *data, size_t len, bool is_last);
+
+/** Whether an asynchronous handler still holds on to downlink data */
+bool downlink_router_ack_pending(void);
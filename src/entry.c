@@ -6,6 +6,7 @@
 
 #include "entry.h"
 #include "block.h"
+#include "downlink_router.h"
 #include "uplink.h"
 
 #include <string.h>
@@ -13,6 +14,7 @@
 
 #include <zephyr/sys/byteorder.h>
 #include <pouch/downlink.h>
+#include <pouch/uplink.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(entry, CONFIG_POUCH_LOG_LEVEL);
@@ -24,12 +26,16 @@ struct pouch_entry
     const char *path;
     uint16_t content_type;
     size_t data_len;
-    const void *data;
+    const struct pouch_iovec *iov;
+    size_t iovcnt;
 };
 
 static struct pouch_buf *block;
 static K_MUTEX_DEFINE(mut);
 
+/** Downlink block being consumed, kept while an asynchronous handler holds on to its data */
+static struct pouch_bufview downlink_view;
+
 /* Entry format:
  *
  * Multi byte fields are big-endian.
@@ -54,6 +60,8 @@ static const char *entry_content_format_str(int content_format)
             return "json";
         case POUCH_CONTENT_TYPE_CBOR:
             return "cbor";
+        case POUCH_CONTENT_TYPE_SCHEMA:
+            return "schema";
     }
 
     return "unsupported";
@@ -65,115 +73,141 @@ static void downlink_start(unsigned int stream_id, const char *path, uint16_t co
     LOG_DBG("Entry path: %s", path);
     LOG_DBG("Entry content_type: %u", content_type);
 
-    STRUCT_SECTION_FOREACH(pouch_downlink_handler, handler)
-    {
-        handler->start_cb(stream_id, path, content_type);
-    }
+    downlink_router_start(stream_id, path, content_type);
 }
 
-static void downlink_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+static int downlink_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
 {
     LOG_DBG("Entry stream_id: %u", stream_id);
     LOG_DBG("Entry is_last: %d", (int) is_last);
     LOG_HEXDUMP_DBG(data, len, "Entry data");
 
-    STRUCT_SECTION_FOREACH(pouch_downlink_handler, handler)
+    return downlink_router_data(stream_id, data, len, is_last);
+}
+
+/**
+ * Read the path of an entry or stream.
+ *
+ * Handlers expect a NULL terminated path. Instead of copying it, the path is moved one byte back
+ * in the block, over its length field, which makes room for the terminator without touching the
+ * data after it. The downlink block is owned by the consumer, so it can be modified in place.
+ */
+static const char *path_read(struct pouch_bufview *v)
+{
+    uint8_t path_len = pouch_bufview_read_byte(v);
+
+    LOG_DBG("path_len %u", (unsigned int) path_len);
+
+    const char *path = pouch_bufview_read(v, path_len);
+    if (path == NULL)
     {
-        handler->data_cb(stream_id, data, len, is_last);
+        return NULL;
     }
+
+    char *path_null_term = (char *) path - 1;
+    memmove(path_null_term, path, path_len);
+    path_null_term[path_len] = '\0';
+
+    return path_null_term;
 }
 
-static void pouch_downlink_entries_push(struct pouch_bufview *v)
+static int pouch_downlink_entries_push(struct pouch_bufview *v)
 {
-    const uint8_t *path;
-    uint8_t path_len;
+    const char *path;
     const uint8_t *data;
     uint16_t data_len;
     uint16_t content_type;
-    uint8_t path_null_term[256];
 
     while (pouch_bufview_available(v))
     {
         data_len = pouch_bufview_read_be16(v);
         content_type = pouch_bufview_read_be16(v);
-        path_len = pouch_bufview_read_byte(v);
 
         LOG_DBG("data_len %u", (unsigned int) data_len);
         LOG_DBG("content_type %s (%u)",
                 entry_content_format_str(content_type),
                 (unsigned int) content_type);
-        LOG_DBG("path_len %u", (unsigned int) path_len);
 
-        path = pouch_bufview_read(v, path_len);
+        path = path_read(v);
         data = pouch_bufview_read(v, data_len);
+        if (path == NULL || data == NULL)
+        {
+            LOG_ERR("Entry exceeds block");
+            return 0;
+        }
 
-        /* Copy path to add NULL terminator */
-        memcpy(path_null_term, path, path_len);
-        path_null_term[path_len] = '\0';
+        downlink_start(0, path, content_type);
 
-        downlink_start(0, path_null_term, content_type);
-        downlink_data(0, data, data_len, true);
+        /* The remaining entries are pushed on resume */
+        int err = downlink_data(0, data, data_len, true);
+        if (err)
+        {
+            return err;
+        }
     }
+
+    return 0;
 }
 
-static void pouch_downlink_stream_push(struct pouch_bufview *v,
-                                       unsigned int stream_id,
-                                       bool is_first,
-                                       bool is_last)
+static int pouch_downlink_stream_push(struct pouch_bufview *v,
+                                      unsigned int stream_id,
+                                      bool is_first,
+                                      bool is_last)
 {
     const uint8_t *data;
     uint16_t data_len;
 
     if (is_first)
     {
-        const uint8_t *path;
-        uint8_t path_len;
+        const char *path;
         uint16_t content_type;
-        uint8_t path_null_term[256];
 
         content_type = pouch_bufview_read_be16(v);
-        path_len = pouch_bufview_read_byte(v);
 
         LOG_DBG("content_type %s (%d)", entry_content_format_str(content_type), (int) content_type);
-        LOG_DBG("path_len %zu", path_len);
 
-        path = pouch_bufview_read(v, path_len);
-
-        /* Copy path to add NULL terminator */
-        memcpy(path_null_term, path, path_len);
-        path_null_term[path_len] = '\0';
+        path = path_read(v);
+        if (path == NULL)
+        {
+            LOG_ERR("Stream path exceeds block");
+            return 0;
+        }
 
-        downlink_start(stream_id, path_null_term, content_type);
+        downlink_start(stream_id, path, content_type);
     }
 
     data_len = pouch_bufview_available(v);
     data = pouch_bufview_read(v, data_len);
 
-    downlink_data(stream_id, data, data_len, is_last);
+    return downlink_data(stream_id, data, data_len, is_last);
 }
 
-void pouch_downlink_block_push(struct pouch_buf *pouch_buf)
+int pouch_downlink_block_push(struct pouch_buf *pouch_buf)
 {
-    struct pouch_bufview v;
-    pouch_bufview_init(&v, pouch_buf);
+    struct pouch_bufview *v = &downlink_view;
+    pouch_bufview_init(v, pouch_buf);
 
     uint16_t block_size;
-    uint8_t stream_id;
+    uint16_t stream_id;
     bool is_stream;
     bool is_first;
     bool is_last;
-    block_decode_hdr(&v, &block_size, &stream_id, &is_stream, &is_first, &is_last);
+    block_decode_hdr(v, &block_size, &stream_id, &is_stream, &is_first, &is_last);
 
-    LOG_HEXDUMP_DBG(pouch_bufview_read(&v, 0), pouch_bufview_available(&v), "block bufview");
+    LOG_HEXDUMP_DBG(pouch_bufview_read(v, 0), pouch_bufview_available(v), "block bufview");
 
     if (is_stream)
     {
-        pouch_downlink_stream_push(&v, stream_id, is_first, is_last);
-    }
-    else
-    {
-        pouch_downlink_entries_push(&v);
+        return pouch_downlink_stream_push(v, stream_id, is_first, is_last);
     }
+
+    return pouch_downlink_entries_push(v);
+}
+
+int pouch_downlink_block_resume(void)
+{
+    /* Stream data runs to the end of the block, so only entry blocks have anything left */
+    return pouch_downlink_entries_push(&downlink_view);
 }
 
 static int write_entry(struct pouch_buf *block, const struct pouch_entry *entry)
@@ -188,18 +222,37 @@ static int write_entry(struct pouch_buf *block, const struct pouch_entry *entry)
     sys_put_be16(entry->content_type, buf_claim(block, sizeof(uint16_t)));
     *buf_claim(block, 1) = pathlen;
     buf_write(block, entry->path, pathlen);
-    buf_write(block, entry->data, entry->data_len);
+    for (size_t i = 0; i < entry->iovcnt; i++)
+    {
+        buf_write(block, entry->iov[i].data, entry->iov[i].len);
+    }
 
     return 0;
 }
 
-int pouch_uplink_entry_write(const char *path,
-                             uint16_t content_type,
-                             const void *data,
-                             size_t len,
-                             k_timeout_t timeout)
+int pouch_uplink_entry_writev(const char *path,
+                              uint16_t content_type,
+                              const struct pouch_iovec *iov,
+                              size_t iovcnt,
+                              k_timeout_t timeout)
 {
-    if (path == NULL || data == NULL || len == 0)
+    if (path == NULL || iov == NULL)
+    {
+        return -EINVAL;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].data == NULL && iov[i].len > 0)
+        {
+            return -EINVAL;
+        }
+
+        len += iov[i].len;
+    }
+
+    if (len == 0)
     {
         return -EINVAL;
     }
@@ -226,7 +279,8 @@ int pouch_uplink_entry_write(const char *path,
         .path = path,
         .content_type = content_type,
         .data_len = len,
-        .data = data,
+        .iov = iov,
+        .iovcnt = iovcnt,
     };
 
     err = write_entry(block, &entry);
@@ -249,9 +303,34 @@ int pouch_uplink_entry_write(const char *path,
 
 end:
     k_mutex_unlock(&mut);
+
+    if (!err)
+    {
+        uplink_data_written();
+    }
+
     return err;
 }
 
+int pouch_uplink_entry_write(const char *path,
+                             uint16_t content_type,
+                             const void *data,
+                             size_t len,
+                             k_timeout_t timeout)
+{
+    if (data == NULL)
+    {
+        return -EINVAL;
+    }
+
+    const struct pouch_iovec iov = {
+        .data = data,
+        .len = len,
+    };
+
+    return pouch_uplink_entry_writev(path, content_type, &iov, 1, timeout);
+}
+
 int entry_block_close(k_timeout_t timeout)
 {
     int err = k_mutex_lock(&mut, timeout);
@@ -270,3 +349,19 @@ int entry_block_close(k_timeout_t timeout)
     k_mutex_unlock(&mut);
     return 0;
 }
+
+size_t entry_block_pending_bytes(void)
+{
+    size_t bytes = 0;
+
+    k_mutex_lock(&mut, K_FOREVER);
+
+    if (block && block_size_get(block) > BLOCK_HEADER_SIZE)
+    {
+        bytes = block_size_get(block);
+    }
+
+    k_mutex_unlock(&mut);
+
+    return bytes;
+}
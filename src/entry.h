@@ -10,5 +10,20 @@
 
 #include "buf.h"
 
-void pouch_downlink_block_push(struct pouch_buf *pouch_buf);
+/**
+ * Push a decrypted downlink block to the downlink handlers
+ *
+ * @retval 0 The block has been consumed.
+ * @retval -EINPROGRESS An asynchronous handler holds on to data in the block. The block must be
+ * kept until the handler acknowledges it, then the rest of it is pushed with
+ * pouch_downlink_block_resume().
+ */
+int pouch_downlink_block_push(struct pouch_buf *pouch_buf);
+
+/** Push the rest of a block after an asynchronous handler acknowledged its data */
+int pouch_downlink_block_resume(void);
+
 int entry_block_close(k_timeout_t timeout);
+
+/** Get the number of bytes in the entry block that's currently being filled */
+size_t entry_block_pending_bytes(void);
@@ -14,15 +14,30 @@
 #include <string.h>
 #include <stdio.h>
 
-#include <zcbor_encode.h>
 #include <zcbor_encode.h>
 #include <zephyr/kernel.h>
 
+#if defined(CONFIG_POUCH_HEADER_COMPACT)
+#define POUCH_HEADER_VERSION 2
+#else
 #define POUCH_HEADER_VERSION 1
+#endif
 
 // CBOR array start + version
 #define POUCH_HEADER_OVERHEAD 2
 
+/* zcbor ends the header's two nested lists with a break byte each, unless it's encoding canonical
+ * CBOR, where the lists have a definite length.
+ */
+#if defined(ZCBOR_CANONICAL)
+#define POUCH_HEADER_LIST_END_LEN 0
+#else
+#define POUCH_HEADER_LIST_END_LEN 2
+#endif
+
+// CBOR encoding of a 16 bit pouch ID:
+#define POUCH_ID_MAX_LEN 3
+
 #if defined(CONFIG_POUCH_ENCRYPTION_NONE)
 
 /* CBOR encryption_type + 32 byte string declaration. Assumes that the device ID max length is less
@@ -38,44 +53,176 @@
 #error "Unsupported encryption type"
 #endif
 
-static int write_header(struct pouch_buf *buf, size_t maxlen)
+/**
+ * Encoded header for the pouches in the current session, with the pouch ID left out. Only the pouch
+ * ID changes between pouches, so the header is encoded once per session, and the pouch ID is
+ * written in when the header is created.
+ */
+static struct
 {
-    struct pouch_header header = {
-        .version = POUCH_HEADER_VERSION,
-    };
+    uint8_t data[POUCH_HEADER_MAX_LEN];
+    size_t len;
+    /** Offset of the pouch ID in the encoded header */
+    size_t id_offset;
+    bool has_id;
+} cache;
+
+static struct pouch_buf *header_encode(const struct pouch_header *header)
+{
+    struct pouch_buf *buf = buf_alloc(POUCH_HEADER_MAX_LEN);
+    if (!buf)
+    {
+        return NULL;
+    }
 
-    int err = crypto_header_get(&header.encryption_info_m);
+    size_t len = 0;
+    int err = cbor_encode_pouch_header(buf_next(buf), POUCH_HEADER_MAX_LEN, header, &len);
     if (err)
     {
-        return err;
+        buf_free(buf);
+        return NULL;
+    }
+
+    buf_claim(buf, len);
+
+    return buf;
+}
+
+static int cache_fill(struct pouch_header *header)
+{
+    struct encryption_info *info = &header->encryption_info_m;
+
+    cache.len = 0;
+
+    // A pouch ID of 0 is encoded as a single byte, right before the end of the lists:
+    switch (info->Union_choice)
+    {
+        case encryption_info_union_saead_info_m_c:
+            info->saead_info_m.pouch_id = 0;
+            cache.has_id = true;
+            break;
+        case encryption_info_union_saead_ref_info_m_c:
+            info->saead_ref_info_m.pouch_id = 0;
+            cache.has_id = true;
+            break;
+        default:
+            cache.has_id = false;
+            break;
     }
 
     size_t len = 0;
-    err = cbor_encode_pouch_header(buf_next(buf), maxlen, &header, &len);
+    int err = cbor_encode_pouch_header(cache.data, sizeof(cache.data), header, &len);
     if (err)
     {
         return err;
     }
 
-    buf_claim(buf, len);
+    if (cache.has_id)
+    {
+        len--;
+        cache.id_offset = len - POUCH_HEADER_LIST_END_LEN;
+        memmove(&cache.data[cache.id_offset],
+                &cache.data[cache.id_offset + 1],
+                POUCH_HEADER_LIST_END_LEN);
+    }
+    else
+    {
+        cache.id_offset = len;
+    }
+
+    cache.len = len;
 
     return 0;
 }
 
-struct pouch_buf *pouch_header_create(void)
+/** Write the cached header with the current pouch ID to a buffer allocated by cache_header_alloc() */
+static void cache_header_write(struct pouch_buf *header)
 {
-    struct pouch_buf *header = buf_alloc(POUCH_HEADER_MAX_LEN);
+    buf_write(header, cache.data, cache.id_offset);
+
+    if (cache.has_id)
+    {
+        uint8_t *id = buf_next(header);
+        ZCBOR_STATE_E(zse, 0, id, POUCH_ID_MAX_LEN, 1);
+
+        // Can't fail, as the buffer always has room for a 16 bit pouch ID:
+        (void) zcbor_uint32_put(zse, crypto_pouch_id_get());
+
+        buf_claim(header, zse->payload - id);
+    }
+
+    buf_write(header, &cache.data[cache.id_offset], cache.len - cache.id_offset);
+}
+
+static struct pouch_buf *cache_header_alloc(void)
+{
+    return buf_alloc(cache.len + POUCH_ID_MAX_LEN);
+}
+
+static struct pouch_buf *cache_header_create(void)
+{
+    struct pouch_buf *header = cache_header_alloc();
     if (!header)
     {
         return NULL;
     }
 
-    int err = write_header(header, POUCH_HEADER_MAX_LEN);
+    cache_header_write(header);
+
+    return header;
+}
+
+struct pouch_buf *pouch_header_create(void)
+{
+    struct pouch_header header = {
+        .version = POUCH_HEADER_VERSION,
+    };
+    struct pouch_buf *first = NULL;
+
+    int err = crypto_header_get(&header.encryption_info_m);
     if (err)
     {
-        buf_free(header);
         return NULL;
     }
 
-    return header;
+    if (IS_ENABLED(CONFIG_POUCH_HEADER_COMPACT))
+    {
+        // Only the first pouch carries the full session info, later pouches refer to it:
+        first = header_encode(&header);
+        if (!first)
+        {
+            return NULL;
+        }
+
+        err = crypto_header_ref_get(&header.encryption_info_m);
+        if (err)
+        {
+            buf_free(first);
+            return NULL;
+        }
+    }
+
+    err = cache_fill(&header);
+    if (err)
+    {
+        buf_free(first);
+        return NULL;
+    }
+
+    return first ? first : cache_header_create();
+}
+
+struct pouch_buf *pouch_header_next_alloc(void)
+{
+    if (cache.len == 0)
+    {
+        return NULL;
+    }
+
+    return cache_header_alloc();
+}
+
+void pouch_header_next_write(struct pouch_buf *header)
+{
+    cache_header_write(header);
 }
@@ -9,6 +9,19 @@
 #include "buf.h"
 
 /**
- * Allocate and encode a pouch header.
+ * Allocate and encode the header for the first pouch of a session.
  */
 struct pouch_buf *pouch_header_create(void);
+
+/**
+ * Allocate a header for a later pouch in the same session. The header is written by
+ * pouch_header_next_write() once the pouch has started, so that an allocation failure doesn't leave
+ * the encryption state ahead of the pouches that were sent.
+ */
+struct pouch_buf *pouch_header_next_alloc(void);
+
+/**
+ * Write the header allocated by pouch_header_next_alloc(). Reuses the header encoded by
+ * pouch_header_create(), with the current pouch ID.
+ */
+void pouch_header_next_write(struct pouch_buf *header);
@@ -5,6 +5,7 @@
  */
 
 #include "downlink.h"
+#include "downlink_router.h"
 #include "uplink.h"
 #include "crypto.h"
 
@@ -53,6 +54,8 @@ static int pouch_module_init(void)
 
     k_work_init(&event_work, dispatch_events);
 
+    downlink_router_init();
+
     return 0;
 }
 SYS_INIT(pouch_module_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -62,5 +65,5 @@ int pouch_init(const struct pouch_config *config)
     downlink_init(&pouch_work_q);
     uplink_init();
 
-    return crypto_init(config);
+    return crypto_init(config, &pouch_work_q);
 }
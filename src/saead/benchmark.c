@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "benchmark.h"
+#include "session.h"
+#include "../block.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(saead_benchmark, CONFIG_POUCH_LOG_LEVEL);
+
+/** Number of full size blocks to encrypt with each algorithm */
+#define BENCHMARK_BLOCKS 8
+
+#define BENCHMARK_NONCE_LEN 12
+
+static const psa_algorithm_t algorithms[] = {
+    PSA_ALG_CHACHA20_POLY1305,
+    PSA_ALG_GCM,
+};
+
+static uint32_t throughput[ARRAY_SIZE(algorithms)];
+
+static int measure(psa_algorithm_t algorithm, uint8_t *buf, uint32_t *bytes_per_sec)
+{
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_key_id_t key;
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_ENCRYPT);
+    psa_set_key_lifetime(&key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_algorithm(&key_attributes, algorithm);
+    psa_set_key_type(&key_attributes, SESSION_KEY_TYPE(algorithm));
+    psa_set_key_bits(&key_attributes, SAEAD_KEY_SIZE(algorithm) * 8);
+
+    psa_status_t status = psa_generate_key(&key_attributes, &key);
+    if (status != PSA_SUCCESS)
+    {
+        return -ENOTSUP;
+    }
+
+    // Encrypt in place with chained associated data, like session_encrypt_block() does. The
+    // previous tag is copied out, as the associated data must not overlap the output:
+    uint8_t nonce[BENCHMARK_NONCE_LEN] = {0};
+    uint8_t ad[AUTH_TAG_LEN];
+    uint32_t start = k_cycle_get_32();
+
+    for (int i = 0; i < BENCHMARK_BLOCKS && status == PSA_SUCCESS; i++)
+    {
+        size_t ciphertext_len;
+
+        nonce[0] = i;
+        memcpy(ad, &buf[MAX_PLAINTEXT_BLOCK_SIZE], sizeof(ad));
+        status = psa_aead_encrypt(key,
+                                  algorithm,
+                                  nonce,
+                                  sizeof(nonce),
+                                  ad,
+                                  i > 0 ? sizeof(ad) : 0,
+                                  buf,
+                                  MAX_PLAINTEXT_BLOCK_SIZE,
+                                  buf,
+                                  MAX_PLAINTEXT_BLOCK_SIZE + AUTH_TAG_LEN,
+                                  &ciphertext_len);
+    }
+
+    uint32_t cycles = k_cycle_get_32() - start;
+
+    (void) psa_destroy_key(key);
+
+    if (status != PSA_SUCCESS)
+    {
+        return -EIO;
+    }
+
+    uint64_t ns = k_cyc_to_ns_ceil64(cycles);
+    uint64_t bytes = (uint64_t) BENCHMARK_BLOCKS * MAX_PLAINTEXT_BLOCK_SIZE;
+
+    *bytes_per_sec = MIN(bytes * NSEC_PER_SEC / MAX(ns, 1), UINT32_MAX);
+
+    return 0;
+}
+
+psa_algorithm_t saead_benchmark_run(psa_algorithm_t fallback)
+{
+    psa_algorithm_t fastest = fallback;
+    uint32_t fastest_throughput = 0;
+
+    uint8_t *buf = calloc(1, MAX_PLAINTEXT_BLOCK_SIZE + AUTH_TAG_LEN);
+    if (buf == NULL)
+    {
+        LOG_WRN("No memory for benchmark, using default algorithm");
+        return fallback;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(algorithms); i++)
+    {
+        int err = measure(algorithms[i], buf, &throughput[i]);
+        if (err)
+        {
+            LOG_WRN("Couldn't measure algorithm 0x%08x: %d", algorithms[i], err);
+            throughput[i] = 0;
+            continue;
+        }
+
+        LOG_INF("Algorithm 0x%08x: %u bytes/s", algorithms[i], throughput[i]);
+
+        if (throughput[i] > fastest_throughput)
+        {
+            fastest = algorithms[i];
+            fastest_throughput = throughput[i];
+        }
+    }
+
+    free(buf);
+
+    return fastest;
+}
+
+uint32_t saead_benchmark_throughput_get(psa_algorithm_t algorithm)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(algorithms); i++)
+    {
+        if (algorithms[i] == algorithm)
+        {
+            return throughput[i];
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <psa/crypto.h>
+
+/**
+ * Measure the encryption throughput of each supported algorithm.
+ *
+ * @return The fastest algorithm, or @p fallback if none of them could be measured.
+ */
+psa_algorithm_t saead_benchmark_run(psa_algorithm_t fallback);
+
+/** Get the throughput measured for the given algorithm in bytes per second, or 0. */
+uint32_t saead_benchmark_throughput_get(psa_algorithm_t algorithm);
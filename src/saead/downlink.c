@@ -7,7 +7,9 @@
 #include "downlink.h"
 #include "uplink.h"
 #include "session.h"
+#include "seqnum.h"
 #include "../cert.h"
+#include "../block.h"
 #include <stdint.h>
 #include <psa/crypto.h>
 #include <zephyr/sys/byteorder.h>
@@ -19,16 +21,20 @@ LOG_MODULE_REGISTER(saead_downlink, CONFIG_POUCH_LOG_LEVEL);
 #define DOWNLINK_KEY_USAGE (PSA_KEY_USAGE_DECRYPT | PSA_KEY_USAGE_VERIFY_MESSAGE)
 
 static struct session downlink;
+/** Whether the downlink session key is owned by the key cache */
+static bool downlink_key_cached;
 static struct
 {
     /**
      * Highest sequence number we've seen the server create a session with.
-     * If replay protection isn't enabled, we can still use this to ensure that the server hasn't
-     * sent the same message since our last power cycle. This isn't proper replay protection, as
-     * it'll get wiped when this device power cycles, but it's a cheap guard against low effort
-     * replay attacks.
+     * Without CONFIG_POUCH_SESSION_RESUME, this is only kept in RAM. We can still use it to ensure
+     * that the server hasn't sent the same message since our last power cycle. This isn't proper
+     * replay protection, as it'll get wiped when this device power cycles, but it's a cheap guard
+     * against low effort replay attacks. With CONFIG_POUCH_SESSION_RESUME, the sequence number is
+     * persisted instead.
      */
     uint64_t seqnum;
+    bool has_seqnum;
     /**
      * Highest pouch ID we've seen the server send in the current session. Is only updated once
      * at least one block of the pouch is decrypted.
@@ -36,9 +42,167 @@ static struct
     uint16_t pouch_id;
 } server;
 
+static bool server_seqnum_get(uint64_t *seqnum)
+{
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+    return seqnum_server_get(seqnum);
+#else
+    *seqnum = server.seqnum;
+    return server.has_seqnum;
+#endif
+}
+
+static void server_seqnum_set(uint64_t seqnum)
+{
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+    uint64_t prev;
+
+    // Only store the sequence number once per session:
+    if (!seqnum_server_get(&prev) || prev != seqnum)
+    {
+        (void) seqnum_server_set(seqnum);
+    }
+#else
+    server.seqnum = seqnum;
+    server.has_seqnum = true;
+#endif
+}
+
+#if CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE > 0
+
+/** Keys derived for server initiated sessions, most recently used first */
+static struct cached_key
+{
+    struct session_id id;
+    psa_algorithm_t algorithm;
+    uint8_t max_block_size_log;
+    psa_key_id_t key;
+} key_cache[CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE];
+
+static psa_key_id_t key_cache_get(const struct session_id *id,
+                                  psa_algorithm_t algorithm,
+                                  uint8_t max_block_size_log)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(key_cache); i++)
+    {
+        if (key_cache[i].key != PSA_KEY_ID_NULL && session_id_is_equal(&key_cache[i].id, id)
+            && key_cache[i].algorithm == algorithm
+            && key_cache[i].max_block_size_log == max_block_size_log)
+        {
+            struct cached_key entry = key_cache[i];
+
+            // Move to the front:
+            memmove(&key_cache[1], &key_cache[0], i * sizeof(key_cache[0]));
+            key_cache[0] = entry;
+
+            return entry.key;
+        }
+    }
+
+    return PSA_KEY_ID_NULL;
+}
+
+static bool key_cache_put(const struct session_id *id,
+                          psa_algorithm_t algorithm,
+                          uint8_t max_block_size_log,
+                          psa_key_id_t key)
+{
+    // Evict the least recently used key:
+    (void) psa_destroy_key(key_cache[ARRAY_SIZE(key_cache) - 1].key);
+
+    memmove(&key_cache[1], &key_cache[0], (ARRAY_SIZE(key_cache) - 1) * sizeof(key_cache[0]));
+
+    key_cache[0] = (struct cached_key) {
+        .id = *id,
+        .algorithm = algorithm,
+        .max_block_size_log = max_block_size_log,
+        .key = key,
+    };
+
+    return true;
+}
+
+static bool key_cache_find(const uint8_t *ref,
+                           struct session_id *id,
+                           psa_algorithm_t *algorithm,
+                           uint8_t *max_block_size_log)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(key_cache); i++)
+    {
+        if (key_cache[i].key != PSA_KEY_ID_NULL
+            && memcmp(session_ref_get(&key_cache[i].id), ref, SESSION_REF_LEN) == 0)
+        {
+            *id = key_cache[i].id;
+            *algorithm = key_cache[i].algorithm;
+            *max_block_size_log = key_cache[i].max_block_size_log;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#else
+
+static psa_key_id_t key_cache_get(const struct session_id *id,
+                                  psa_algorithm_t algorithm,
+                                  uint8_t max_block_size_log)
+{
+    return PSA_KEY_ID_NULL;
+}
+
+static bool key_cache_put(const struct session_id *id,
+                          psa_algorithm_t algorithm,
+                          uint8_t max_block_size_log,
+                          psa_key_id_t key)
+{
+    return false;
+}
+
+static bool key_cache_find(const uint8_t *ref,
+                           struct session_id *id,
+                           psa_algorithm_t *algorithm,
+                           uint8_t *max_block_size_log)
+{
+    return false;
+}
+
+#endif /* CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE > 0 */
+
+/** Destroy the downlink session key, unless it's owned by the key cache */
+static void downlink_key_release(void)
+{
+    if (!downlink_key_cached)
+    {
+        (void) psa_destroy_key(downlink.key);
+    }
+
+    downlink.key = PSA_KEY_ID_NULL;
+    downlink_key_cached = false;
+}
+
 /** Check that this session is a valid follow up to the previous downlink session */
 static bool is_valid_downlink(const struct session_id *id, psa_algorithm_t algorithm)
 {
+    uint64_t seqnum;
+
+    if (id->initiator == POUCH_ROLE_SERVER && id->type == SESSION_ID_TYPE_SEQUENTIAL
+        && server_seqnum_get(&seqnum))
+    {
+        // This was initiated by the server, so we can validate the sequence number. The
+        // sequence number outlives the previous session. Further pouches in the current session
+        // are covered by the pouch ID replay protection instead.
+        bool is_current = atomic_test_bit(&downlink.flags, SESSION_HAS_POUCH)
+            && session_id_is_equal(&downlink.id, id);
+
+        if (id->value.sequential.seqnum < seqnum
+            || (id->value.sequential.seqnum == seqnum && !is_current))
+        {
+            LOG_ERR("Old seqnum: %llu (was %llu)", id->value.sequential.seqnum, seqnum);
+            return false;
+        }
+    }
+
     if (!atomic_test_bit(&downlink.flags, SESSION_VALID))
     {
         // No previous session to invalidate the incoming session
@@ -52,17 +216,6 @@ static bool is_valid_downlink(const struct session_id *id, psa_algorithm_t algor
         return false;
     }
 
-    if (id->initiator == POUCH_ROLE_SERVER)
-    {
-        // This was initiated by the server. If it's sequential, we can validate the sequence
-        // number.
-        if (id->type == SESSION_ID_TYPE_SEQUENTIAL && id->value.sequential.seqnum <= server.seqnum)
-        {
-            LOG_ERR("Old seqnum: %llu (was %llu)", id->value.sequential.seqnum, server.seqnum);
-            return false;
-        }
-    }
-
     return true;
 }
 
@@ -72,6 +225,7 @@ int saead_downlink_session_start(const struct session_id *id,
                                  psa_key_id_t private_key)
 {
     psa_key_id_t session_key;
+    bool cached = false;
 
     if (!is_valid_downlink(id, algorithm))
     {
@@ -100,16 +254,26 @@ int saead_downlink_session_start(const struct session_id *id,
     }
     else
     {
-        // This isn't the uplink session, so we need to generate a new key
-        struct pubkey pubkey;
-        cert_server_key_get(&pubkey);
+        // This isn't the uplink session, so we need the key of the server's session:
+        session_key = key_cache_get(id, algorithm, max_block_size_log);
+        cached = session_key != PSA_KEY_ID_NULL;
 
-        session_key = session_key_generate(id,
-                                           algorithm,
-                                           max_block_size_log,
-                                           private_key,
-                                           &pubkey,
-                                           DOWNLINK_KEY_USAGE);
+        if (!cached)
+        {
+            struct pubkey pubkey;
+            cert_server_key_get(&pubkey);
+
+            session_key = session_key_generate(id,
+                                               algorithm,
+                                               max_block_size_log,
+                                               private_key,
+                                               &pubkey,
+                                               DOWNLINK_KEY_USAGE);
+            if (session_key != PSA_KEY_ID_NULL)
+            {
+                cached = key_cache_put(id, algorithm, max_block_size_log, session_key);
+            }
+        }
     }
 
     if (session_key == PSA_KEY_ID_NULL)
@@ -118,10 +282,22 @@ int saead_downlink_session_start(const struct session_id *id,
         return -EIO;
     }
 
+    // Pouch IDs keep increasing in a resumed session, so keep the pouch replay protection:
+    bool resumed =
+        atomic_test_bit(&downlink.flags, SESSION_HAS_POUCH) && session_id_is_equal(&downlink.id, id);
+
+    downlink_key_release();
+
     downlink.flags = ATOMIC_INIT(0);
+    if (resumed)
+    {
+        atomic_set_bit(&downlink.flags, SESSION_HAS_POUCH);
+    }
+
     downlink.pouch.id = 0;
     downlink.algorithm = algorithm;
     downlink.key = session_key;
+    downlink_key_cached = cached;
     downlink.id = *id;
 
     atomic_set_bit(&downlink.flags, SESSION_ACTIVE);
@@ -129,8 +305,32 @@ int saead_downlink_session_start(const struct session_id *id,
     return 0;
 }
 
+int saead_downlink_session_ref_start(const uint8_t *ref, psa_key_id_t private_key)
+{
+    struct session_id id;
+    psa_algorithm_t algorithm;
+    uint8_t max_block_size_log = MAX_BLOCK_PAYLOAD_SIZE_LOG;
+
+    // Only sessions we still have a key for can be referenced:
+    if (!saead_uplink_session_find(ref, &id, &algorithm)
+        && !key_cache_find(ref, &id, &algorithm, &max_block_size_log))
+    {
+        LOG_ERR("Unknown session reference");
+        return -ENOENT;
+    }
+
+    return saead_downlink_session_start(&id, algorithm, max_block_size_log, private_key);
+}
+
 void saead_downlink_session_end(void)
 {
+    if (downlink_key_cached)
+    {
+        // Keep the key for later pouches in the same session:
+        downlink.key = PSA_KEY_ID_NULL;
+        downlink_key_cached = false;
+    }
+
     session_end(&downlink);
 }
 
@@ -147,10 +347,10 @@ int saead_downlink_pouch_start(pouch_id_t id)
 
 struct pouch_buf *saead_downlink_block_decrypt(struct pouch_buf *block)
 {
-    struct pouch_buf *decrypted = session_decrypt_block(&downlink, block);
-    buf_free(block);
-    if (decrypted == NULL)
+    int err = session_decrypt_block(&downlink, block);
+    if (err)
     {
+        buf_free(block);
         return NULL;
     }
 
@@ -162,8 +362,8 @@ struct pouch_buf *saead_downlink_block_decrypt(struct pouch_buf *block)
     if (downlink.id.initiator == POUCH_ROLE_SERVER
         && downlink.id.type == SESSION_ID_TYPE_SEQUENTIAL)
     {
-        server.seqnum = downlink.id.value.sequential.seqnum;
+        server_seqnum_set(downlink.id.value.sequential.seqnum);
     }
 
-    return decrypted;
+    return block;
 }
@@ -13,6 +13,8 @@ int saead_downlink_session_start(const struct session_id *id,
                                  psa_algorithm_t algorithm,
                                  uint8_t max_block_size_log,
                                  psa_key_id_t private_key);
+/** Start a downlink session referenced by a compact pouch header */
+int saead_downlink_session_ref_start(const uint8_t *ref, psa_key_id_t private_key);
 void saead_downlink_session_end(void);
 int saead_downlink_pouch_start(pouch_id_t id);
 struct pouch_buf *saead_downlink_block_decrypt(struct pouch_buf *block);
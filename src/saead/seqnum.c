@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "seqnum.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/util.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(saead_seqnum, CONFIG_POUCH_LOG_LEVEL);
+
+#define SEQNUM_SETTINGS_ROOT "pouch/seq"
+#define SEQNUM_DEVICE_KEY "dev"
+#define SEQNUM_SERVER_KEY "srv"
+
+static uint64_t device_seqnum;
+static uint64_t server_seqnum;
+static bool server_seqnum_valid;
+
+static int seqnum_save(const char *key, uint64_t seqnum)
+{
+    int err = settings_save_one(key, &seqnum, sizeof(seqnum));
+    if (err)
+    {
+        LOG_ERR("Failed to store %s: %d", key, err);
+    }
+
+    return err;
+}
+
+uint64_t seqnum_device_get(void)
+{
+    return device_seqnum;
+}
+
+int seqnum_device_set(uint64_t seqnum)
+{
+    int err = seqnum_save(SEQNUM_SETTINGS_ROOT "/" SEQNUM_DEVICE_KEY, seqnum);
+    if (err)
+    {
+        return err;
+    }
+
+    device_seqnum = seqnum;
+
+    return 0;
+}
+
+bool seqnum_server_get(uint64_t *seqnum)
+{
+    *seqnum = server_seqnum;
+
+    return server_seqnum_valid;
+}
+
+int seqnum_server_set(uint64_t seqnum)
+{
+    server_seqnum = seqnum;
+    server_seqnum_valid = true;
+
+    return seqnum_save(SEQNUM_SETTINGS_ROOT "/" SEQNUM_SERVER_KEY, seqnum);
+}
+
+static int seqnum_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    uint64_t seqnum;
+
+    if (len != sizeof(seqnum))
+    {
+        return -EINVAL;
+    }
+
+    ssize_t ret = read_cb(cb_arg, &seqnum, sizeof(seqnum));
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    if (strcmp(name, SEQNUM_DEVICE_KEY) == 0)
+    {
+        device_seqnum = MAX(device_seqnum, seqnum);
+    }
+    else if (strcmp(name, SEQNUM_SERVER_KEY) == 0)
+    {
+        server_seqnum = MAX(server_seqnum, seqnum);
+        server_seqnum_valid = true;
+    }
+    else
+    {
+        return -ENOENT;
+    }
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(pouch_seqnum,
+                               SEQNUM_SETTINGS_ROOT,
+                               NULL,
+                               seqnum_settings_set,
+                               NULL,
+                               NULL);
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Session sequence numbers, persisted for replay protection across reboots. */
+
+/** Get the sequence number of the last session the device initiated */
+uint64_t seqnum_device_get(void);
+
+/**
+ * Store the sequence number of a new session initiated by the device.
+ *
+ * Must succeed before the session is used, so the sequence number is never reused.
+ */
+int seqnum_device_set(uint64_t seqnum);
+
+/**
+ * Get the highest sequence number of a session the server initiated.
+ *
+ * @retval true @p seqnum is valid
+ * @retval false No sequential server session has been seen
+ */
+bool seqnum_server_get(uint64_t *seqnum);
+
+/** Store the sequence number of a validated server session */
+int seqnum_server_set(uint64_t seqnum);
@@ -25,10 +25,6 @@ LOG_MODULE_REGISTER(saead_session, CONFIG_POUCH_LOG_LEVEL);
 
 #define NONCE_LEN 12
 #define INFO_MAX_LEN (12 + BASE64_STRLEN(SESSION_ID_LEN) + 1)
-#define SAEAD_KEY_SIZE(alg) ((alg) == PSA_ALG_CHACHA20_POLY1305 ? 32 : 16)
-
-#define SESSION_KEY_TYPE(alg) \
-    ((alg) == PSA_ALG_CHACHA20_POLY1305 ? PSA_KEY_TYPE_CHACHA20 : PSA_KEY_TYPE_AES)
 
 void session_end(struct session *session)
 {
@@ -198,15 +194,8 @@ static void nonce_generate(const struct session *session,
     memset(&nonce[5], 0, NONCE_LEN - 5);
 }
 
-struct pouch_buf *session_encrypt_block(struct session *session, struct pouch_buf *block)
+int session_encrypt_block(struct session *session, struct pouch_buf *block)
 {
-    struct pouch_buf *encrypted = buf_alloc(MAX_CIPHERTEXT_BLOCK_SIZE);
-    if (encrypted == NULL)
-    {
-        LOG_ERR("Couldn't allocate encrypted block");
-        return NULL;
-    }
-
     uint8_t nonce[NONCE_LEN];
     nonce_generate(session, POUCH_ROLE_DEVICE, nonce);
 
@@ -219,13 +208,16 @@ struct pouch_buf *session_encrypt_block(struct session *session, struct pouch_bu
     if (plaintext_len != pouch_bufview_available(&plaintext))
     {
         LOG_ERR("Invalid plaintext length: %u", plaintext_len);
-        buf_free(encrypted);
-        return NULL;
+        return -EINVAL;
     }
 
+    /* The block is encrypted in place: the ciphertext overwrites the plaintext, and the auth tag
+     * is appended in the space reserved for it when the block was allocated.
+     */
     size_t encrypted_len = plaintext_len + AUTH_TAG_LEN;
-    block_size_write(encrypted, encrypted_len);
-    uint8_t *ciphertext = buf_claim(encrypted, encrypted_len);
+    buf_restore(block, POUCH_BUF_STATE_INITIAL);
+    block_size_write(block, encrypted_len);
+    uint8_t *payload = buf_claim(block, encrypted_len);
     size_t ciphertext_len;
 
     psa_status_t status =
@@ -235,40 +227,32 @@ struct pouch_buf *session_encrypt_block(struct session *session, struct pouch_bu
                          sizeof(nonce),
                          session->pouch.ad,
                          session->pouch.block_index > 0 ? sizeof(session->pouch.ad) : 0,
-                         pouch_bufview_read(&plaintext, plaintext_len),
+                         payload,
                          plaintext_len,
-                         ciphertext,
+                         payload,
                          encrypted_len,
                          &ciphertext_len);
     if (status != PSA_SUCCESS)
     {
         LOG_ERR("Couldn't encrypt: %d", status);
-        buf_free(encrypted);
-        return NULL;
+        return -EIO;
     }
 
     if (ciphertext_len != encrypted_len)
     {
         LOG_ERR("Unexpected length");
-        buf_free(encrypted);
-        return NULL;
+        return -EIO;
     }
 
     // prepare for the next block:
-    memcpy(&session->pouch.ad, &ciphertext[plaintext_len], AUTH_TAG_LEN);
+    memcpy(&session->pouch.ad, &payload[plaintext_len], AUTH_TAG_LEN);
     session->pouch.block_index++;
 
-    return encrypted;
+    return 0;
 }
 
-struct pouch_buf *session_decrypt_block(struct session *session, struct pouch_buf *block)
+int session_decrypt_block(struct session *session, struct pouch_buf *block)
 {
-    struct pouch_buf *decrypted = buf_alloc(MAX_PLAINTEXT_BLOCK_SIZE);
-    if (decrypted == NULL)
-    {
-        return NULL;
-    }
-
     uint8_t nonce[NONCE_LEN];
     nonce_generate(session, POUCH_ROLE_SERVER, nonce);
 
@@ -279,13 +263,20 @@ struct pouch_buf *session_decrypt_block(struct session *session, struct pouch_bu
     if (ciphertext_len <= AUTH_TAG_LEN || ciphertext_len != pouch_bufview_available(&ciphertext))
     {
         LOG_ERR("Invalid ciphertext length: %u", ciphertext_len);
-        buf_free(decrypted);
-        return NULL;
+        return -EINVAL;
     }
 
     size_t payload_len = ciphertext_len - AUTH_TAG_LEN;
 
-    block_size_write(decrypted, payload_len);
+    /* The block is decrypted in place: the plaintext overwrites the ciphertext, and the auth tag
+     * is trimmed off. The tag is the associated data of the next block, so keep it around until
+     * the block has been authenticated.
+     */
+    uint8_t tag[AUTH_TAG_LEN];
+    buf_restore(block, POUCH_BUF_STATE_INITIAL);
+    block_size_write(block, payload_len);
+    uint8_t *payload = buf_claim(block, payload_len);
+    memcpy(tag, &payload[payload_len], AUTH_TAG_LEN);
 
     size_t plaintext_len;
 
@@ -296,30 +287,28 @@ struct pouch_buf *session_decrypt_block(struct session *session, struct pouch_bu
                          sizeof(nonce),
                          session->pouch.ad,
                          session->pouch.block_index > 0 ? sizeof(session->pouch.ad) : 0,
-                         pouch_bufview_read(&ciphertext, payload_len),
+                         payload,
                          ciphertext_len,
-                         buf_claim(decrypted, payload_len),
+                         payload,
                          payload_len,
                          &plaintext_len);
     if (status != PSA_SUCCESS)
     {
         LOG_ERR("Failed decryption: %d", status);
-        buf_free(decrypted);
-        return NULL;
+        return -EBADMSG;
     }
 
     if (plaintext_len != payload_len)
     {
         LOG_ERR("Unexpected length");
-        buf_free(decrypted);
-        return NULL;
+        return -EBADMSG;
     }
 
     // prepare for the next block:
-    pouch_bufview_memcpy(&ciphertext, &session->pouch.ad, AUTH_TAG_LEN);
+    memcpy(&session->pouch.ad, tag, AUTH_TAG_LEN);
     session->pouch.block_index++;
 
     atomic_set_bit(&session->flags, SESSION_VALID);
 
-    return decrypted;
+    return 0;
 }
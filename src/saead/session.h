@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "../buf.h"
 #include "../pouch.h"
 #include <zephyr/kernel.h>
 #include <zephyr/sys/atomic.h>
@@ -14,8 +15,13 @@
 
 #define SESSION_ID_LEN 16
 #define SESSION_ID_TAG_LEN (SESSION_ID_LEN - sizeof(uint64_t))
+#define SESSION_REF_LEN 4
 #define AUTH_TAG_LEN 16
 #define AD_LEN AUTH_TAG_LEN
+#define SAEAD_KEY_SIZE(alg) ((alg) == PSA_ALG_CHACHA20_POLY1305 ? 32 : 16)
+
+#define SESSION_KEY_TYPE(alg) \
+    ((alg) == PSA_ALG_CHACHA20_POLY1305 ? PSA_KEY_TYPE_CHACHA20 : PSA_KEY_TYPE_AES)
 
 /** The format of the session ID */
 enum session_id_type
@@ -73,6 +79,15 @@ static inline bool session_id_is_equal(const struct session_id *a, const struct
         && memcmp(&a->value, &b->value, sizeof(a->value)) == 0;
 }
 
+/**
+ * Get the short reference to the given session that's used in compact pouch headers. This is the
+ * start of the random part of the session ID.
+ */
+static inline const uint8_t *session_ref_get(const struct session_id *id)
+{
+    return (const uint8_t *) &id->value;
+}
+
 /** Generate a new session ID for the given session. */
 int session_id_generate(struct session_id *id);
 
@@ -89,8 +104,17 @@ void session_end(struct session *session);
 
 int session_pouch_start(struct session *session, pouch_id_t pouch_id);
 
-/** Encrypt the next block in the given session */
-struct pouch_buf *session_encrypt_block(struct session *session, struct pouch_buf *block);
+/**
+ * Encrypt the next block in the given session.
+ *
+ * The block is encrypted in place, and must have room for the authentication tag after the
+ * plaintext. The block contents are undefined on failure.
+ */
+int session_encrypt_block(struct session *session, struct pouch_buf *block);
 
-/** Decrypt the next block in the given session */
-struct pouch_buf *session_decrypt_block(struct session *session, struct pouch_buf *block);
+/**
+ * Decrypt the next block in the given session
+ *
+ * The block is decrypted in place, and its size field is updated to the plaintext length.
+ */
+int session_decrypt_block(struct session *session, struct pouch_buf *block);
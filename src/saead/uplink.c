@@ -6,6 +6,7 @@
 
 #include "uplink.h"
 #include "session.h"
+#include "seqnum.h"
 #include "../cert.h"
 #include "../block.h"
 #include <stdint.h>
@@ -18,46 +19,296 @@ LOG_MODULE_REGISTER(saead_uplink, CONFIG_POUCH_LOG_LEVEL);
 
 static struct session uplink;
 
-int saead_uplink_session_start(psa_algorithm_t algorithm, psa_key_id_t private_key)
+/* Reusing a pouch ID would reuse the nonces of its blocks, so a session ends before its pouch IDs
+ * wrap around.
+ */
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+#define MAX_POUCH_ID CONFIG_POUCH_SESSION_RESUME_MAX_POUCHES
+#else
+#define MAX_POUCH_ID UINT16_MAX
+#endif
+
+static bool pubkey_is_equal(const struct pubkey *a, const struct pubkey *b)
 {
+    return a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
+
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+
+static struct
+{
+    /** Server key the session key was derived from */
     struct pubkey pubkey;
+    /** Uptime when the session started */
+    int64_t started;
+} resume;
 
-    uplink.flags = ATOMIC_INIT(0);
+static bool session_is_resumable(psa_algorithm_t algorithm, const struct pubkey *pubkey)
+{
+    if (!atomic_test_bit(&uplink.flags, SESSION_ACTIVE)
+        || uplink.id.type != SESSION_ID_TYPE_SEQUENTIAL || uplink.algorithm != algorithm)
+    {
+        return false;
+    }
+
+    if (uplink.pouch.id >= MAX_POUCH_ID)
+    {
+        LOG_DBG("Session pouch limit reached");
+        return false;
+    }
+
+    if (CONFIG_POUCH_SESSION_RESUME_LIFETIME_S > 0
+        && k_uptime_get() - resume.started
+            >= (int64_t) CONFIG_POUCH_SESSION_RESUME_LIFETIME_S * MSEC_PER_SEC)
+    {
+        LOG_DBG("Session expired");
+        return false;
+    }
+
+    return pubkey_is_equal(pubkey, &resume.pubkey);
+}
+
+#endif /* CONFIG_POUCH_SESSION_RESUME */
 
-    // Sequential IDs require replay protection, which isn't supported yet:
-    uplink.id.type = SESSION_ID_TYPE_RANDOM;
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+/* Held from reading the last sequence number until the next one is stored, as sessions are derived
+ * both on the Pouch work queue and in the transport's context.
+ */
+static K_MUTEX_DEFINE(seqnum_lock);
+#endif
+
+static int session_id_create(struct session_id *id)
+{
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+    k_mutex_lock(&seqnum_lock, K_FOREVER);
 
-    int err = session_id_generate(&uplink.id);
+    id->type = SESSION_ID_TYPE_SEQUENTIAL;
+    id->value.sequential.seqnum = seqnum_device_get();
+
+    int err = session_id_generate(id);
     if (err)
     {
-        LOG_ERR("Session ID generation failed (err: %d)", err);
+        k_mutex_unlock(&seqnum_lock);
         return err;
     }
 
-    cert_server_key_get(&pubkey);
+    // The sequence number must be stored before it's used, so it's never reused after a reboot:
+    err = seqnum_device_set(id->value.sequential.seqnum);
+
+    k_mutex_unlock(&seqnum_lock);
 
-    uplink.key = session_key_generate(&uplink.id,
-                                      algorithm,
-                                      MAX_BLOCK_PAYLOAD_SIZE_LOG,
-                                      private_key,
-                                      &pubkey,
-                                      PSA_KEY_USAGE_ENCRYPT);
-    if (PSA_KEY_ID_NULL == uplink.key)
+    if (!err)
+    {
+        return 0;
+    }
+
+    LOG_WRN("Falling back to random session ID");
+#endif
+
+    // Sequential IDs require persisted replay protection state:
+    id->type = SESSION_ID_TYPE_RANDOM;
+
+    return session_id_generate(id);
+}
+
+static int session_derive(struct session_id *id,
+                          psa_key_id_t *key,
+                          psa_algorithm_t algorithm,
+                          psa_key_id_t private_key,
+                          const struct pubkey *pubkey)
+{
+    int err = session_id_create(id);
+    if (err)
+    {
+        LOG_ERR("Session ID generation failed (err: %d)", err);
+        return err;
+    }
+
+    *key = session_key_generate(id,
+                                algorithm,
+                                MAX_BLOCK_PAYLOAD_SIZE_LOG,
+                                private_key,
+                                pubkey,
+                                PSA_KEY_USAGE_ENCRYPT);
+    if (PSA_KEY_ID_NULL == *key)
     {
         LOG_ERR("Session key generation failed");
         return -ENOENT;
     }
 
+    return 0;
+}
+
+#if defined(CONFIG_POUCH_SESSION_PRECOMPUTE)
+
+/* The next session is derived ahead of time on the Pouch work queue, so starting a session is
+ * a handoff instead of an ECDH key agreement in the transport's context.
+ */
+static struct
+{
+    struct k_work work;
+    struct k_work_q *work_q;
+    /** Held while the next session is derived */
+    struct k_mutex lock;
+    psa_algorithm_t algorithm;
+    psa_key_id_t private_key;
+    struct session_id id;
+    /** Precomputed session key, or PSA_KEY_ID_NULL */
+    psa_key_id_t key;
+    /** Server key the session key was derived from */
+    struct pubkey pubkey;
+} next;
+
+static void precompute_discard(void)
+{
+    if (next.key != PSA_KEY_ID_NULL)
+    {
+        (void) psa_destroy_key(next.key);
+        next.key = PSA_KEY_ID_NULL;
+    }
+}
+
+static void precompute_work(struct k_work *work)
+{
+    struct pubkey pubkey;
+
+    cert_server_key_get(&pubkey);
+    if (pubkey.len == 0)
+    {
+        return;
+    }
+
+    k_mutex_lock(&next.lock, K_FOREVER);
+
+    if (next.key == PSA_KEY_ID_NULL || !pubkey_is_equal(&pubkey, &next.pubkey))
+    {
+        precompute_discard();
+
+        int err = session_derive(&next.id, &next.key, next.algorithm, next.private_key, &pubkey);
+        if (err)
+        {
+            next.key = PSA_KEY_ID_NULL;
+        }
+        else
+        {
+            next.pubkey = pubkey;
+            LOG_DBG("Next session ready");
+        }
+    }
+
+    k_mutex_unlock(&next.lock);
+}
+
+/**
+ * Take the precomputed session, if it was derived from the current server key. Waits for a
+ * precomputation that's already running.
+ */
+static bool precompute_take(struct session_id *id,
+                            psa_key_id_t *key,
+                            psa_algorithm_t algorithm,
+                            const struct pubkey *pubkey)
+{
+    bool taken = false;
+
+    k_mutex_lock(&next.lock, K_FOREVER);
+
+    if (next.key != PSA_KEY_ID_NULL && next.algorithm == algorithm
+        && pubkey_is_equal(pubkey, &next.pubkey))
+    {
+        *id = next.id;
+        *key = next.key;
+        next.key = PSA_KEY_ID_NULL;
+        taken = true;
+    }
+    else
+    {
+        // A session derived now gets a newer sequence number, which outdates this one:
+        precompute_discard();
+    }
+
+    k_mutex_unlock(&next.lock);
+
+    return taken;
+}
+
+#endif /* CONFIG_POUCH_SESSION_PRECOMPUTE */
+
+void saead_uplink_init(struct k_work_q *work_q, psa_algorithm_t algorithm, psa_key_id_t private_key)
+{
+#if defined(CONFIG_POUCH_SESSION_PRECOMPUTE)
+    k_work_init(&next.work, precompute_work);
+    k_mutex_init(&next.lock);
+    next.work_q = work_q;
+    next.algorithm = algorithm;
+    next.private_key = private_key;
+
+    saead_uplink_session_precompute();
+#endif
+}
+
+void saead_uplink_session_precompute(void)
+{
+#if defined(CONFIG_POUCH_SESSION_PRECOMPUTE)
+    if (next.work_q != NULL)
+    {
+        k_work_submit_to_queue(next.work_q, &next.work);
+    }
+#endif
+}
+
+int saead_uplink_session_start(psa_algorithm_t algorithm, psa_key_id_t private_key)
+{
+    struct pubkey pubkey;
+
+    cert_server_key_get(&pubkey);
+
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+    if (session_is_resumable(algorithm, &pubkey))
+    {
+        LOG_DBG("Resuming session %llu", uplink.id.value.sequential.seqnum);
+        return 0;
+    }
+
+    session_end(&uplink);
+#endif
+
+    uplink.flags = ATOMIC_INIT(0);
+
+    bool precomputed = false;
+#if defined(CONFIG_POUCH_SESSION_PRECOMPUTE)
+    precomputed = precompute_take(&uplink.id, &uplink.key, algorithm, &pubkey);
+#endif
+
+    if (!precomputed)
+    {
+        int err = session_derive(&uplink.id, &uplink.key, algorithm, private_key, &pubkey);
+        if (err)
+        {
+            return err;
+        }
+    }
+
     uplink.algorithm = algorithm;
     uplink.pouch.id = 0;
     atomic_set_bit(&uplink.flags, SESSION_VALID);
     atomic_set_bit(&uplink.flags, SESSION_ACTIVE);
 
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+    resume.pubkey = pubkey;
+    resume.started = k_uptime_get();
+#endif
+
     return 0;
 }
 
 int saead_uplink_pouch_start(void)
 {
+    if (uplink.pouch.id >= MAX_POUCH_ID)
+    {
+        LOG_DBG("Session pouch limit reached");
+        return -ENOSPC;
+    }
+
     return session_pouch_start(&uplink, uplink.pouch.id + 1);
 }
 
@@ -103,25 +354,62 @@ int saead_uplink_header_get(struct saead_info *info)
     return 0;
 }
 
-struct pouch_buf *saead_uplink_encrypt_block(struct pouch_buf *block)
+int saead_uplink_header_ref_get(struct saead_ref_info *info)
 {
     if (!atomic_test_bit(&uplink.flags, SESSION_ACTIVE))
+    {
+        LOG_ERR("Not in a session");
+        return -ENOTCONN;
+    }
+
+    info->session_ref.value = session_ref_get(&uplink.id);
+    info->session_ref.len = SESSION_REF_LEN;
+    info->pouch_id = uplink.pouch.id;
+
+    return 0;
+}
+
+pouch_id_t saead_uplink_pouch_id_get(void)
+{
+    return uplink.pouch.id;
+}
+
+void saead_uplink_encrypt_blocks(pouch_buf_queue_t *blocks)
+{
+    pouch_buf_queue_t encrypted;
+    struct pouch_buf *block;
+
+    buf_queue_init(&encrypted);
+
+    bool active = atomic_test_bit(&uplink.flags, SESSION_ACTIVE);
+    if (!active)
     {
         LOG_WRN("Not in a session");
-        buf_free(block);
-        return NULL;
     }
 
-    struct pouch_buf *encrypted = session_encrypt_block(&uplink, block);
+    while ((block = buf_queue_get(blocks)) != NULL)
+    {
+        if (!active || session_encrypt_block(&uplink, block) != 0)
+        {
+            buf_free(block);
+            continue;
+        }
 
-    buf_free(block);
+        buf_queue_submit(&encrypted, block);
+    }
 
-    return encrypted;
+    buf_queue_submit_all(blocks, &encrypted);
 }
 
 void saead_uplink_session_end(void)
 {
-    session_end(&uplink);
+    // Sequential sessions are kept for the next connection, and ended once they're replaced:
+    if (!IS_ENABLED(CONFIG_POUCH_SESSION_RESUME) || uplink.id.type != SESSION_ID_TYPE_SEQUENTIAL)
+    {
+        session_end(&uplink);
+    }
+
+    saead_uplink_session_precompute();
 }
 
 bool saead_uplink_session_matches(const struct session_id *id,
@@ -132,6 +420,22 @@ bool saead_uplink_session_matches(const struct session_id *id,
         && max_block_size_log == MAX_BLOCK_PAYLOAD_SIZE_LOG && uplink.algorithm == algorithm;
 }
 
+bool saead_uplink_session_find(const uint8_t *ref,
+                               struct session_id *id,
+                               psa_algorithm_t *algorithm)
+{
+    if (!atomic_test_bit(&uplink.flags, SESSION_VALID)
+        || memcmp(session_ref_get(&uplink.id), ref, SESSION_REF_LEN) != 0)
+    {
+        return false;
+    }
+
+    *id = uplink.id;
+    *algorithm = uplink.algorithm;
+
+    return true;
+}
+
 psa_key_id_t saead_uplink_session_key_copy(psa_key_usage_t usage)
 {
     psa_key_id_t copy = PSA_KEY_ID_NULL;
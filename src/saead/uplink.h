@@ -9,20 +9,53 @@
 #include "../buf.h"
 #include "cddl/header_types.h"
 
-/** Start an uplink session */
+/** Initialize the uplink, with the work queue to precompute sessions on */
+void saead_uplink_init(struct k_work_q *work_q, psa_algorithm_t algorithm, psa_key_id_t private_key);
+
+/**
+ * Derive the next uplink session in the background.
+ *
+ * Should be called when the server key changes. Does nothing without
+ * CONFIG_POUCH_SESSION_PRECOMPUTE.
+ */
+void saead_uplink_session_precompute(void);
+
+/**
+ * Start an uplink session
+ *
+ * With CONFIG_POUCH_SESSION_RESUME, the previous session is resumed if it's still valid. With
+ * CONFIG_POUCH_SESSION_PRECOMPUTE, a session derived in the background is used if available.
+ */
 int saead_uplink_session_start(psa_algorithm_t algorithm, psa_key_id_t private_key);
 
-/** End the ongoing uplink session */
+/**
+ * End the ongoing uplink session
+ *
+ * With CONFIG_POUCH_SESSION_RESUME, the session key is kept, so the session can be resumed.
+ */
 void saead_uplink_session_end(void);
 
 /** Get the session info associated with the ongoing uplink session */
 int saead_uplink_header_get(struct saead_info *info);
 
-/** Start a new pouch in the ongoing uplink session, and allocate a unique pouch ID for it. */
+/**
+ * Start a new pouch in the ongoing uplink session, and allocate a unique pouch ID for it.
+ *
+ * Returns -ENOSPC if the session has run out of pouch IDs, and must be replaced by a new session.
+ */
 int saead_uplink_pouch_start(void);
 
-/** Encrypt a block in the current uplink pouch */
-struct pouch_buf *saead_uplink_encrypt_block(struct pouch_buf *block);
+/** Get the compact session info for later pouches in the ongoing uplink session */
+int saead_uplink_header_ref_get(struct saead_ref_info *info);
+
+/** Get the ID of the current uplink pouch */
+pouch_id_t saead_uplink_pouch_id_get(void);
+
+/**
+ * Encrypt a batch of blocks in the current uplink pouch. Blocks that fail to encrypt are removed
+ * from the queue and freed.
+ */
+void saead_uplink_encrypt_blocks(pouch_buf_queue_t *blocks);
 
 /**
  * Get whether the given session ID, block size and algorithm matches the uplink's ongoing session
@@ -32,5 +65,13 @@ bool saead_uplink_session_matches(const struct session_id *id,
                                   uint8_t max_block_size_log,
                                   psa_algorithm_t algorithm);
 
+/**
+ * Get the ID and algorithm of the uplink session if it matches the session reference from a
+ * compact pouch header.
+ */
+bool saead_uplink_session_find(const uint8_t *ref,
+                               struct session_id *id,
+                               psa_algorithm_t *algorithm);
+
 /** Make a copy of the uplink session's session key. */
 psa_key_id_t saead_uplink_session_key_copy(psa_key_usage_t usage);
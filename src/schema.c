@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include <pouch/schema.h>
+#include <pouch/types.h>
+#include <pouch/uplink.h>
+
+#include <zephyr/init.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/iterable_sections.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(schema, CONFIG_POUCH_LOG_LEVEL);
+
+#if defined(CONFIG_BIG_ENDIAN)
+#define SCHEMA_ENDIAN "big"
+#else
+#define SCHEMA_ENDIAN "little"
+#endif
+
+static const char *const field_type_names[] = {
+    [POUCH_SCHEMA_U8] = "u8",
+    [POUCH_SCHEMA_I8] = "i8",
+    [POUCH_SCHEMA_U16] = "u16",
+    [POUCH_SCHEMA_I16] = "i16",
+    [POUCH_SCHEMA_U32] = "u32",
+    [POUCH_SCHEMA_I32] = "i32",
+    [POUCH_SCHEMA_U64] = "u64",
+    [POUCH_SCHEMA_I64] = "i64",
+    [POUCH_SCHEMA_F32] = "f32",
+    [POUCH_SCHEMA_F64] = "f64",
+    [POUCH_SCHEMA_BYTES] = "bytes",
+};
+
+/** Check that no two registered schemas share an ID, as the ID is all the cloud gets to decode */
+static bool schema_ids_are_unique(void)
+{
+    bool unique = true;
+
+    STRUCT_SECTION_FOREACH(pouch_schema, a)
+    {
+        STRUCT_SECTION_FOREACH(pouch_schema, b)
+        {
+            if (a < b && a->id == b->id)
+            {
+                LOG_ERR("Schemas %s and %s have the same ID %u", a->name, b->name, a->id);
+                unique = false;
+            }
+        }
+    }
+
+    return unique;
+}
+
+static int schema_init(void)
+{
+    __ASSERT(schema_ids_are_unique(), "Duplicate schema IDs");
+
+    return 0;
+}
+
+SYS_INIT(schema_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+int pouch_uplink_schema_write(const char *path,
+                              const struct pouch_schema *schema,
+                              const void *data,
+                              k_timeout_t timeout)
+{
+    if (schema == NULL || data == NULL)
+    {
+        return -EINVAL;
+    }
+
+    uint8_t id[sizeof(uint16_t)];
+    sys_put_be16(schema->id, id);
+
+    const struct pouch_iovec iov[] = {
+        {id, sizeof(id)},
+        {data, schema->size},
+    };
+
+    return pouch_uplink_entry_writev(path,
+                                     POUCH_CONTENT_TYPE_SCHEMA,
+                                     iov,
+                                     ARRAY_SIZE(iov),
+                                     timeout);
+}
+
+struct descriptor_writer
+{
+    char *buf;
+    size_t len;
+    size_t offset;
+};
+
+static void append(struct descriptor_writer *writer, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+
+    size_t space = (writer->offset < writer->len) ? writer->len - writer->offset : 0;
+    int ret = vsnprintf(&writer->buf[MIN(writer->offset, writer->len)], space, fmt, args);
+    if (ret > 0)
+    {
+        // Keep counting on overflow, so the caller can detect it:
+        writer->offset += ret;
+    }
+
+    va_end(args);
+}
+
+int pouch_schema_descriptor_get(char *buf, size_t len)
+{
+    if (buf == NULL || len == 0)
+    {
+        return -EINVAL;
+    }
+
+    if (!schema_ids_are_unique())
+    {
+        return -EEXIST;
+    }
+
+    struct descriptor_writer writer = {
+        .buf = buf,
+        .len = len,
+    };
+
+    // The struct bytes are written as they are in memory, so the byte order is the device's:
+    append(&writer, "{\"endian\":\"%s\",\"schemas\":[", SCHEMA_ENDIAN);
+
+    bool first_schema = true;
+    STRUCT_SECTION_FOREACH(pouch_schema, schema)
+    {
+        append(&writer,
+               "%s{\"id\":%u,\"name\":\"%s\",\"size\":%u,\"fields\":[",
+               first_schema ? "" : ",",
+               schema->id,
+               schema->name,
+               (unsigned int) schema->size);
+
+        for (size_t i = 0; i < schema->field_count; i++)
+        {
+            const struct pouch_schema_field *field = &schema->fields[i];
+            append(&writer,
+                   "%s{\"name\":\"%s\",\"type\":\"%s\",\"offset\":%u,\"size\":%u}",
+                   i == 0 ? "" : ",",
+                   field->name,
+                   field_type_names[field->type],
+                   field->offset,
+                   field->size);
+        }
+
+        append(&writer, "]}");
+        first_schema = false;
+    }
+
+    append(&writer, "]}");
+
+    if (writer.offset >= len)
+    {
+        return -ENOMEM;
+    }
+
+    return writer.offset;
+}
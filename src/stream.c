@@ -17,17 +17,34 @@
 struct pouch_stream
 {
     /** Stream ID */
-    uint8_t id;
+    uint16_t id;
     /** Buffer for stream data */
     struct pouch_buf *buf;
     /** Number of bytes written to the stream */
     size_t bytes;
     /** Session ID this stream was created for */
     uint32_t session_id;
+    /** Uplink flow for the stream's blocks */
+    struct uplink_flow *flow;
 };
 
+/** Number of IDs that fit in the regular block header */
+#define STREAM_ID_SHORT_COUNT (BLOCK_ID_MASK + 1)
+
+#if CONFIG_POUCH_STREAM_EXTENDED_ID
+/** Stream IDs are allocated from the first 256 IDs, to keep the ID bitmap small */
+#define STREAM_ID_COUNT 256
+#else
+#define STREAM_ID_COUNT STREAM_ID_SHORT_COUNT
+#endif
+
+BUILD_ASSERT(POUCH_STREAMS_MAX < STREAM_ID_COUNT, "Not enough stream IDs for all streams");
+BUILD_ASSERT(STREAM_ID_COUNT - 1 <= BLOCK_ID_EXT_MAX, "Stream IDs don't fit in the block header");
+
 /** Next stream ID */
 static atomic_t stream_id = ATOMIC_INIT(1);
+/** Stream IDs that belong to streams with blocks that haven't been processed yet */
+static ATOMIC_DEFINE(stream_ids_in_use, STREAM_ID_COUNT);
 /** Number of open streams */
 static atomic_t open_streams;
 
@@ -40,16 +57,41 @@ static void write_stream_header(struct pouch_buf *block, uint16_t content_type,
     buf_write(block, path, path_len);
 }
 
-static uint8_t new_stream_id(void)
+/**
+ * Allocate an ID that isn't used by any other open stream.
+ *
+ * IDs that fit in the regular block header are handed out round robin, and the extended IDs are
+ * only used when all of those are taken.
+ *
+ * @return A free stream ID, or 0 if all IDs are in use.
+ */
+static uint16_t new_stream_id(void)
 {
-    uint8_t id;
-    // ID 0 is reserved:
-    do
+    for (int i = 0; i < STREAM_ID_SHORT_COUNT; i++)
     {
-        id = atomic_inc(&stream_id) & BLOCK_ID_MASK;
-    } while (id == 0);
+        uint16_t id = atomic_inc(&stream_id) & BLOCK_ID_MASK;
+        // ID 0 is reserved:
+        if (id != 0 && !atomic_test_and_set_bit(stream_ids_in_use, id))
+        {
+            return id;
+        }
+    }
 
-    return id;
+    for (uint16_t id = STREAM_ID_SHORT_COUNT; id < STREAM_ID_COUNT; id++)
+    {
+        if (!atomic_test_and_set_bit(stream_ids_in_use, id))
+        {
+            return id;
+        }
+    }
+
+    return 0;
+}
+
+/** Return the stream ID to the pool once all the stream's blocks have been processed */
+static void release_stream_id(void *arg)
+{
+    atomic_clear_bit(stream_ids_in_use, POINTER_TO_UINT(arg));
 }
 
 struct pouch_stream *pouch_uplink_stream_open(const char *path, uint16_t content_type)
@@ -68,12 +110,29 @@ struct pouch_stream *pouch_uplink_stream_open(const char *path, uint16_t content
     }
 
     stream->id = new_stream_id();
+    if (stream->id == 0)
+    {
+        free(stream);
+        atomic_dec(&open_streams);
+        return NULL;
+    }
+
     stream->bytes = 0;
     stream->session_id = uplink_session_id();
 
+    stream->flow = uplink_flow_open();
+    if (stream->flow == NULL)
+    {
+        release_stream_id(UINT_TO_POINTER(stream->id));
+        free(stream);
+        atomic_dec(&open_streams);
+        return NULL;
+    }
+
     stream->buf = block_alloc_stream(stream->id, true);
     if (stream->buf == NULL)
     {
+        uplink_flow_close(stream->flow, release_stream_id, UINT_TO_POINTER(stream->id));
         free(stream);
         atomic_dec(&open_streams);
         return NULL;
@@ -114,8 +173,8 @@ size_t pouch_stream_write(struct pouch_stream *stream,
                 break;
             }
 
-            block_finish_stream(stream->buf, stream->id, false);
-            uplink_enqueue(stream->buf);
+            block_finish_stream(stream->buf, false);
+            uplink_flow_enqueue(stream->flow, stream->buf);
 
             stream->buf = buf;
             space = block_space_get(stream->buf);
@@ -128,6 +187,31 @@ size_t pouch_stream_write(struct pouch_stream *stream,
 
     stream->bytes += written;
 
+    if (written > 0)
+    {
+        uplink_data_written();
+    }
+
+    return written;
+}
+
+size_t pouch_stream_writev(struct pouch_stream *stream,
+                           const struct pouch_iovec *iov,
+                           size_t iovcnt,
+                           k_timeout_t timeout)
+{
+    size_t written = 0;
+
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        size_t segment_written = pouch_stream_write(stream, iov[i].data, iov[i].len, timeout);
+        written += segment_written;
+        if (segment_written < iov[i].len)
+        {
+            break;
+        }
+    }
+
     return written;
 }
 
@@ -140,14 +224,19 @@ int pouch_stream_close(struct pouch_stream *stream, k_timeout_t timeout)
 
     if (pouch_stream_is_valid(stream) && stream->bytes > 0)
     {
-        block_finish_stream(stream->buf, stream->id, true);
-        uplink_enqueue(stream->buf);
+        block_finish_stream(stream->buf, true);
+        uplink_flow_enqueue(stream->flow, stream->buf);
     }
     else
     {
         block_free(stream->buf);
     }
 
+    /* Keep the stream ID reserved until all the stream's blocks have been processed, so a new
+     * stream can't reuse it while the receiver is still reassembling this one:
+     */
+    uplink_flow_close(stream->flow, release_stream_id, UINT_TO_POINTER(stream->id));
+
     atomic_dec(&open_streams);
     free(stream);
 
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "pouch.h"
+#include "sync_policy.h"
+
+#include <pouch/uplink.h>
+#include <pouch/events.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sync_policy, CONFIG_POUCH_LOG_LEVEL);
+
+#define AGE_THRESHOLD_MS ((int64_t) CONFIG_POUCH_SYNC_POLICY_AGE_S * MSEC_PER_SEC)
+
+enum flags
+{
+    /** The sync request is currently raised */
+    SYNC_REQUESTED,
+    /** The application requested a sync */
+    SYNC_FORCED,
+
+    FLAG_COUNT,
+};
+
+static ATOMIC_DEFINE(flags, FLAG_COUNT);
+
+static void evaluate(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(policy_work, evaluate);
+
+static bool threshold_reached(const struct pouch_uplink_pending *pending)
+{
+    if (CONFIG_POUCH_SYNC_POLICY_BYTES > 0 && pending->bytes >= CONFIG_POUCH_SYNC_POLICY_BYTES)
+    {
+        return true;
+    }
+
+    if (CONFIG_POUCH_SYNC_POLICY_AGE_S > 0 && pending->age_ms >= AGE_THRESHOLD_MS)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+static void evaluate(struct k_work *work)
+{
+    struct pouch_uplink_pending pending;
+    pouch_uplink_pending_get(&pending);
+
+    bool request = atomic_test_bit(flags, SYNC_FORCED) || threshold_reached(&pending);
+
+    if (!request && CONFIG_POUCH_SYNC_POLICY_AGE_S > 0 && pending.age_ms > 0)
+    {
+        // Check again once the pending data reaches the age threshold:
+        k_work_schedule(&policy_work, K_MSEC(AGE_THRESHOLD_MS - pending.age_ms));
+    }
+
+    if (request == atomic_test_bit(flags, SYNC_REQUESTED))
+    {
+        return;
+    }
+
+    LOG_DBG("Sync request %s (%u bytes, %u blocks, age %u ms)",
+            request ? "raised" : "cleared",
+            (unsigned int) pending.bytes,
+            (unsigned int) pending.blocks,
+            (unsigned int) pending.age_ms);
+
+    atomic_set_bit_to(flags, SYNC_REQUESTED, request);
+    pouch_event_emit(request ? POUCH_EVENT_SYNC_REQUEST : POUCH_EVENT_SYNC_REQUEST_CLEARED);
+}
+
+void sync_policy_update(void)
+{
+    k_work_reschedule(&policy_work, K_NO_WAIT);
+}
+
+void pouch_sync_request(void)
+{
+    atomic_set_bit(flags, SYNC_FORCED);
+    sync_policy_update();
+}
+
+bool pouch_sync_is_requested(void)
+{
+    return atomic_test_bit(flags, SYNC_REQUESTED);
+}
+
+static void session_event_handler(enum pouch_event event, void *ctx)
+{
+    if (event == POUCH_EVENT_SESSION_END)
+    {
+        atomic_clear_bit(flags, SYNC_FORCED);
+        sync_policy_update();
+    }
+}
+
+POUCH_EVENT_HANDLER(session_event_handler, NULL);
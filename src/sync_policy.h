@@ -0,0 +1,10 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+/** Re-evaluate the sync policy after the pending uplink data changed */
+void sync_policy_update(void);
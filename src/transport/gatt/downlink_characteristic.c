@@ -8,12 +8,25 @@
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/uuid.h>
 
+#include <zephyr/sys/byteorder.h>
+
+#include <pouch/events.h>
 #include <pouch/transport/downlink.h>
 #include <pouch/transport/gatt/common/packetizer.h>
 #include <pouch/transport/gatt/common/uuids.h>
 
 #include "pouch_gatt_declarations.h"
 
+/*
+ * Flow control contract for gateways:
+ *
+ * A write that doesn't fit in the downlink window is rejected with
+ * BT_ATT_ERR_INSUFFICIENT_RESOURCES, without changing any state. Gateways that enable
+ * notifications on this characteristic get a notification with the new window size (32 bit little
+ * endian) once the window opens up again, and should retry the rejected packet then. Gateways that
+ * don't enable notifications have to read the info characteristic to learn the window size.
+ */
+
 static const struct bt_uuid_128 pouch_gatt_downlink_chrc_uuid =
     BT_UUID_INIT_128(POUCH_GATT_UUID_DOWNLINK_CHRC_VAL);
 
@@ -34,12 +47,25 @@ ssize_t downlink_write(struct bt_conn *conn,
         return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
     }
 
+    /* Reject the write before touching any state, so the gateway can retry the same packet once
+     * the window opens up again.
+     */
+    if (!pouch_downlink_window_check(payload_len))
+    {
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    }
+
     if (is_first)
     {
         pouch_downlink_start();
     }
 
-    pouch_downlink_push(payload, payload_len);
+    int err = pouch_downlink_push(payload, payload_len);
+    if (err)
+    {
+        pouch_downlink_finish();
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
 
     if (is_last)
     {
@@ -51,8 +77,26 @@ ssize_t downlink_write(struct bt_conn *conn,
 
 POUCH_GATT_CHARACTERISTIC(downlink,
                           (const struct bt_uuid *) &pouch_gatt_downlink_chrc_uuid,
-                          BT_GATT_CHRC_WRITE,
+                          BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
                           POUCH_GATT_PERM_WRITE,
                           NULL,
                           downlink_write,
                           NULL);
+
+POUCH_GATT_CCC(downlink, NULL, NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE);
+
+static void downlink_event_handler(enum pouch_event event, void *ctx)
+{
+    if (POUCH_EVENT_DOWNLINK_WINDOW_OPEN != event)
+    {
+        return;
+    }
+
+    uint8_t window[sizeof(uint32_t)];
+    sys_put_le32(pouch_downlink_window_get(), window);
+
+    /* Fails with -ENOTCONN if no gateway has enabled notifications, which is fine */
+    (void) bt_gatt_notify(NULL, &downlink_chrc, window, sizeof(window));
+}
+
+POUCH_EVENT_HANDLER(downlink_event_handler, NULL);
@@ -14,13 +14,14 @@ LOG_MODULE_REGISTER(info_chrc, CONFIG_POUCH_LOG_LEVEL);
 #include <pouch/transport/gatt/common/packetizer.h>
 #include <pouch/transport/gatt/common/uuids.h>
 #include <pouch/transport/certificate.h>
+#include <pouch/transport/downlink.h>
 #include <pouch/certificate.h>
 
 #include "pouch_gatt_declarations.h"
 
 #include <cddl/info_encode.h>
 
-#define INFO_CHRC_MAX_SIZE 64
+#define INFO_CHRC_MAX_SIZE 96
 
 enum info_flags
 {
@@ -62,6 +63,7 @@ static int build_info_data(void)
                 .value = snr,
                 .len = snr_len,
             },
+        .pouch_gatt_info_downlink_window = pouch_downlink_window_get(),
     };
 
     info_chrc_ctx.buf_len = INFO_CHRC_MAX_SIZE;
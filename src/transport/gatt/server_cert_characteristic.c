@@ -4,9 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <stdlib.h>
-
 #include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/uuid.h>
 
@@ -24,10 +23,11 @@ static const struct bt_uuid_128 pouch_gatt_server_cert_chrc_uuid =
 static struct pouch_gatt_server_cert_ctx
 {
     struct pouch_gatt_packetizer *packetizer;
-    struct pouch_cert cert;
     uint8_t serial[CERT_SERIAL_MAXLEN];
     uint8_t serial_len;
     uint8_t serial_offset;
+    /** Connection that's sending a server certificate, if any */
+    struct bt_conn *ingest_conn;
 } server_cert_chrc_ctx;
 
 static enum pouch_gatt_packetizer_result server_cert_serial_fill_cb(void *dst,
@@ -108,7 +108,6 @@ static ssize_t server_cert_write(struct bt_conn *conn,
                                  uint16_t offset,
                                  uint8_t flags)
 {
-    struct pouch_gatt_server_cert_ctx *ctx = attr->user_data;
     bool is_first = false;
     bool is_last = false;
     const void *payload = NULL;
@@ -119,37 +118,49 @@ static ssize_t server_cert_write(struct bt_conn *conn,
         return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
     }
 
+    struct pouch_gatt_server_cert_ctx *ctx = attr->user_data;
+
     if (is_first)
     {
-        free((void *) ctx->cert.buffer);
-        ctx->cert.buffer = malloc(CONFIG_POUCH_SERVER_CERT_MAX_LEN);
-
-        ctx->cert.size = 0;
+        pouch_server_certificate_start();
+        ctx->ingest_conn = conn;
     }
 
-    if (!ctx->cert.buffer)
+    int err = pouch_server_certificate_push(payload, payload_len);
+    if (!err && is_last)
     {
-        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+        err = pouch_server_certificate_finish();
     }
 
-    memcpy((void *) &ctx->cert.buffer[ctx->cert.size], payload, payload_len);
-    ctx->cert.size += payload_len;
-
-    if (is_last)
+    if (err || is_last)
     {
-        int err = pouch_server_certificate_set(&ctx->cert);
-        if (err)
-        {
-            bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
-        }
+        ctx->ingest_conn = NULL;
+    }
 
-        free((void *) ctx->cert.buffer);
-        ctx->cert.buffer = NULL;
+    if (err)
+    {
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
     }
 
     return len;
 }
 
+static void server_cert_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct pouch_gatt_server_cert_ctx *ctx = &server_cert_chrc_ctx;
+
+    /* Free the partially received certificate instead of holding on to it until the next one */
+    if (conn == ctx->ingest_conn)
+    {
+        pouch_server_certificate_abort();
+        ctx->ingest_conn = NULL;
+    }
+}
+
+BT_CONN_CB_DEFINE(server_cert_conn_cb) = {
+    .disconnected = server_cert_disconnected,
+};
+
 POUCH_GATT_CHARACTERISTIC(server_cert,
                           (const struct bt_uuid *) &pouch_gatt_server_cert_chrc_uuid,
                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 
 #include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/uuid.h>
 
@@ -34,6 +35,8 @@ enum uplink_indicate_state
 
 static struct pouch_gatt_uplink_ctx
 {
+    /** Uplink session, kept across packetizers while the session has more pouches to send */
+    struct pouch_uplink *pouch;
     struct pouch_gatt_packetizer *packetizer;
     struct bt_conn *conn;
     enum uplink_indicate_state state;
@@ -43,39 +46,52 @@ static struct pouch_gatt_uplink_ctx
 
 static enum pouch_gatt_packetizer_result uplink_fill_cb(void *dst, size_t *dst_len, void *user_arg)
 {
-    struct pouch_uplink *pouch = user_arg;
+    struct pouch_gatt_uplink_ctx *ctx = user_arg;
     enum pouch_gatt_packetizer_result ret = POUCH_GATT_PACKETIZER_MORE_DATA;
 
-    enum pouch_result pouch_ret = pouch_uplink_fill(pouch, dst, dst_len);
+    enum pouch_result pouch_ret = pouch_uplink_fill(ctx->pouch, dst, dst_len);
 
     if (POUCH_ERROR == pouch_ret)
     {
-        pouch_uplink_finish(pouch);
+        pouch_uplink_finish(ctx->pouch);
+        ctx->pouch = NULL;
         ret = POUCH_GATT_PACKETIZER_ERROR;
     }
     if (POUCH_NO_MORE_DATA == pouch_ret)
     {
-        pouch_uplink_finish(pouch);
+        pouch_uplink_finish(ctx->pouch);
+        ctx->pouch = NULL;
+        ret = POUCH_GATT_PACKETIZER_NO_MORE_DATA;
+    }
+    if (POUCH_END_OF_POUCH == pouch_ret)
+    {
+        /* End this transfer so the gateway can forward the pouch. The session stays open, and
+         * the next transfer picks up the next pouch.
+         */
         ret = POUCH_GATT_PACKETIZER_NO_MORE_DATA;
     }
 
     return ret;
 }
 
-static struct pouch_gatt_packetizer *packetizer_init(void)
+static struct pouch_gatt_packetizer *packetizer_init(struct pouch_gatt_uplink_ctx *ctx)
 {
-    struct pouch_uplink *pouch = pouch_uplink_start();
-    if (NULL == pouch)
+    if (NULL == ctx->pouch)
     {
-        return NULL;
+        ctx->pouch = pouch_uplink_start();
+        if (NULL == ctx->pouch)
+        {
+            return NULL;
+        }
     }
 
     struct pouch_gatt_packetizer *packetizer;
-    packetizer = pouch_gatt_packetizer_start_callback(uplink_fill_cb, pouch);
+    packetizer = pouch_gatt_packetizer_start_callback(uplink_fill_cb, ctx);
 
     if (NULL == packetizer)
     {
-        pouch_uplink_finish(pouch);
+        pouch_uplink_finish(ctx->pouch);
+        ctx->pouch = NULL;
     }
 
     return packetizer;
@@ -98,7 +114,7 @@ static ssize_t uplink_read(struct bt_conn *conn,
 
     if (NULL == ctx->packetizer)
     {
-        ctx->packetizer = packetizer_init();
+        ctx->packetizer = packetizer_init(ctx);
         if (NULL == ctx->packetizer)
         {
             return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
@@ -124,7 +140,7 @@ static ssize_t uplink_read(struct bt_conn *conn,
     return buf_len;
 }
 
-static void cleanup_context(struct pouch_gatt_uplink_ctx *ctx)
+static void transfer_end(struct pouch_gatt_uplink_ctx *ctx)
 {
     if (NULL != ctx->packetizer)
     {
@@ -141,6 +157,20 @@ static void cleanup_context(struct pouch_gatt_uplink_ctx *ctx)
     ctx->state = UPLINK_INDICATE_IDLE;
 }
 
+static void cleanup_context(struct pouch_gatt_uplink_ctx *ctx)
+{
+    transfer_end(ctx);
+
+    /* The session is kept open between pouches, so it has to be closed if the gateway stops
+     * fetching them.
+     */
+    if (NULL != ctx->pouch)
+    {
+        pouch_uplink_finish(ctx->pouch);
+        ctx->pouch = NULL;
+    }
+}
+
 static void send_indication(struct pouch_gatt_uplink_ctx *ctx)
 {
     if (NULL == ctx->packetizer)
@@ -191,10 +221,19 @@ static void uplink_indicate_destroy(struct bt_gatt_indicate_params *params)
     }
     else if (UPLINK_INDICATE_FINISHED == ctx->state)
     {
-        cleanup_context(ctx);
+        transfer_end(ctx);
     }
 }
 
+static void uplink_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    cleanup_context(&uplink_chrc_ctx);
+}
+
+BT_CONN_CB_DEFINE(uplink_conn_cb) = {
+    .disconnected = uplink_disconnected,
+};
+
 POUCH_GATT_CHARACTERISTIC(uplink,
                           (const struct bt_uuid *) &pouch_gatt_uplink_chrc_uuid,
                           BT_GATT_CHRC_READ | BT_GATT_CHRC_INDICATE,
@@ -236,7 +275,7 @@ static ssize_t uplink_ccc_write(struct bt_conn *conn,
 
         ctx->conn = conn;
 
-        ctx->packetizer = packetizer_init();
+        ctx->packetizer = packetizer_init(ctx);
         if (NULL == ctx->packetizer)
         {
             cleanup_context(ctx);
@@ -5,9 +5,12 @@
  */
 
 #include "pouch.h"
+#include "block.h"
 #include "header.h"
+#include "uplink.h"
 #include "entry.h"
 #include "crypto.h"
+#include "sync_policy.h"
 
 #include <pouch/uplink.h>
 #include <pouch/events.h>
@@ -18,11 +21,37 @@
 #include <zephyr/sys/iterable_sections.h>
 #include <zephyr/sys/ring_buffer.h>
 
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(uplink, CONFIG_POUCH_LOG_LEVEL);
+
+/**
+ * Scheduling quantum for each flow, in bytes. Covers at least one full block, so every flow gets to
+ * send something each round.
+ */
+#define FLOW_QUANTUM MAX_PLAINTEXT_BLOCK_SIZE
+
 enum flags
 {
     SESSION_ACTIVE,
     POUCH_CLOSING,
     POUCH_CLOSED,
+    PROCESSING_STALLED,
+};
+
+/** Sequence of blocks that must be processed in order, such as the blocks of a single stream */
+struct uplink_flow
+{
+    sys_snode_t node;
+    /** Blocks that are ready for processing */
+    pouch_buf_queue_t queue;
+    /** Number of bytes the flow may still process in its current turn */
+    size_t deficit;
+    /** Whether the flow is currently at the head of the active flows and has received its quantum */
+    bool in_turn;
+    /** Whether the owner has released the flow. It's freed once its queue is drained. */
+    bool closed;
+    uplink_flow_release_cb_t release_cb;
+    void *release_arg;
 };
 
 struct pouch_uplink
@@ -34,16 +63,35 @@ struct pouch_uplink
 
     struct
     {
-        /** Blocks that are ready for processing */
-        pouch_buf_queue_t queue;
+        /** Flows with blocks that are ready for processing, in round robin order */
+        sys_slist_t active;
+        /** Flow for entry blocks */
+        struct uplink_flow entries;
+        /** Blocks that couldn't be processed, to be processed before any other blocks */
+        pouch_buf_queue_t retry;
+        struct k_mutex lock;
         struct k_work work;
     } processing;
+
+    /** Pending data accounting, protected by the processing lock */
+    struct
+    {
+        /** Number of bytes in blocks waiting for processing */
+        size_t bytes;
+        /** Number of blocks waiting for processing */
+        size_t blocks;
+        /** Uptime when data was first written after the last session, or 0 */
+        int64_t since;
+    } pending;
+
     struct
     {
         /** Blocks that are ready for transport */
         pouch_buf_queue_t queue;
         /** Buffer reader for the buffer currently being processed. */
         struct pouch_bufview reader;
+        /** Number of bytes submitted to the queue for the current pouch */
+        size_t pouch_bytes;
     } transport;
 };
 
@@ -65,23 +113,291 @@ static bool pouch_is_closing(void)
     return atomic_test_bit(uplink.flags, POUCH_CLOSING);
 }
 
-static void process_blocks(struct k_work *work)
+static bool has_pending_blocks(void)
 {
-    while (session_is_active() && pouch_is_open() && !buf_queue_is_empty(&uplink.processing.queue))
+    return !sys_slist_is_empty(&uplink.processing.active)
+        || !buf_queue_is_empty(&uplink.processing.retry);
+}
+
+static void flow_release(struct uplink_flow *flow)
+{
+    if (flow->release_cb)
+    {
+        flow->release_cb(flow->release_arg);
+    }
+
+    free(flow);
+}
+
+static void flow_deactivate(struct uplink_flow *flow)
+{
+    sys_slist_find_and_remove(&uplink.processing.active, &flow->node);
+    flow->deficit = 0;
+    flow->in_turn = false;
+
+    if (flow->closed)
     {
-        struct pouch_buf *encrypted = crypto_encrypt_block(buf_queue_get(&uplink.processing.queue));
-        if (!encrypted)
+        flow_release(flow);
+    }
+}
+
+/**
+ * Get the next block to process. Must be called with the processing lock held.
+ *
+ * Blocks are picked from the active flows in deficit round robin order, so a flow with a lot of
+ * queued data can't starve the others.
+ */
+static struct pouch_buf *next_block(void)
+{
+    struct pouch_buf *block = NULL;
+    sys_snode_t *node;
+
+    while (block == NULL && (node = sys_slist_peek_head(&uplink.processing.active)) != NULL)
+    {
+        struct uplink_flow *flow = CONTAINER_OF(node, struct uplink_flow, node);
+        if (!flow->in_turn)
+        {
+            flow->deficit += FLOW_QUANTUM;
+            flow->in_turn = true;
+        }
+
+        size_t size = block_size_get(buf_queue_peek(&flow->queue));
+        if (flow->deficit < size)
         {
+            // End of this flow's turn, move it to the back of the line:
+            flow->in_turn = false;
+            sys_slist_get(&uplink.processing.active);
+            sys_slist_append(&uplink.processing.active, node);
             continue;
         }
 
-        if (uplink.header)
+        flow->deficit -= size;
+        block = buf_queue_get(&flow->queue);
+
+        uplink.pending.bytes -= size;
+        uplink.pending.blocks--;
+
+        if (buf_queue_is_empty(&flow->queue))
+        {
+            flow_deactivate(flow);
+        }
+    }
+
+    return block;
+}
+
+/** Move up to @a max blocks to @a batch, in processing order. Returns the number of blocks. */
+static size_t next_blocks(pouch_buf_queue_t *batch, size_t max)
+{
+    struct pouch_buf *block;
+    size_t count = 0;
+
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    while (count < max && (block = buf_queue_get(&uplink.processing.retry)) != NULL)
+    {
+        uplink.pending.bytes -= block_size_get(block);
+        uplink.pending.blocks--;
+        buf_queue_submit(batch, block);
+        count++;
+    }
+
+    while (count < max && (block = next_block()) != NULL)
+    {
+        buf_queue_submit(batch, block);
+        count++;
+    }
+
+    k_mutex_unlock(&uplink.processing.lock);
+
+    return count;
+}
+
+/**
+ * Put @a block and the rest of its batch back in front of the blocks that are waiting for
+ * processing, so they're processed again in the same order.
+ */
+static void blocks_requeue(struct pouch_buf *block, pouch_buf_queue_t *batch)
+{
+    pouch_buf_queue_t blocks;
+    size_t bytes = 0;
+    size_t count = 0;
+
+    buf_queue_init(&blocks);
+
+    for (; block != NULL; block = buf_queue_get(batch))
+    {
+        bytes += block_size_get(block);
+        count++;
+        buf_queue_submit(&blocks, block);
+    }
+
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    uplink.pending.bytes += bytes;
+    uplink.pending.blocks += count;
+    buf_queue_submit_all(&blocks, &uplink.processing.retry);
+    buf_queue_submit_all(&uplink.processing.retry, &blocks);
+
+    k_mutex_unlock(&uplink.processing.lock);
+}
+
+/** Empty buffers mark the end of a pouch in the transport queue */
+static bool is_pouch_end_marker(const struct pouch_buf *buf)
+{
+    return buf_size_get(buf) == 0;
+}
+
+/**
+ * Check whether adding the block to a pouch of @a pouch_bytes would make it exceed the max pouch
+ * size.
+ */
+static bool pouch_is_full(size_t pouch_bytes, const struct pouch_buf *block)
+{
+    if (CONFIG_POUCH_MAX_POUCH_SIZE == 0 || pouch_bytes == 0)
+    {
+        return false;
+    }
+
+    size_t encrypted_size = block_size_get(block) + CONFIG_POUCH_AUTH_TAG_LEN;
+
+    return pouch_bytes + encrypted_size > CONFIG_POUCH_MAX_POUCH_SIZE;
+}
+
+/** Close the current pouch and start a new one in the same session */
+static int pouch_restart(void)
+{
+    // Allocate everything before starting the pouch, so a failure leaves the current pouch intact:
+    struct pouch_buf *marker = buf_alloc(0);
+    if (!marker)
+    {
+        return -ENOMEM;
+    }
+
+    struct pouch_buf *header = pouch_header_next_alloc();
+    if (!header)
+    {
+        buf_free(marker);
+        return -ENOMEM;
+    }
+
+    int err = crypto_pouch_start();
+    if (err)
+    {
+        buf_free(header);
+        buf_free(marker);
+        return err;
+    }
+
+    pouch_header_next_write(header);
+    uplink.header = header;
+
+    buf_queue_submit(&uplink.transport.queue, marker);
+    uplink.transport.pouch_bytes = 0;
+
+    LOG_DBG("Started new pouch");
+
+    return 0;
+}
+
+/** Encrypt a run of blocks for the current pouch, and pass them to the transport together */
+static void submit_blocks(pouch_buf_queue_t *blocks)
+{
+    crypto_encrypt_blocks(blocks);
+    if (buf_queue_is_empty(blocks))
+    {
+        return;
+    }
+
+    if (uplink.header)
+    {
+        uplink.transport.pouch_bytes += buf_size_get(uplink.header);
+        buf_queue_submit(&uplink.transport.queue, uplink.header);
+        uplink.header = NULL;
+    }
+
+    uplink.transport.pouch_bytes += buf_queue_size_get(blocks);
+    buf_queue_submit_all(&uplink.transport.queue, blocks);
+}
+
+/**
+ * Process a batch of blocks. The batch is split into runs at pouch boundaries, as each pouch gets
+ * its own header.
+ *
+ * If a new pouch can't be started, the rest of the batch is put back for processing later, and an
+ * error is returned.
+ */
+static int process_batch(pouch_buf_queue_t *batch)
+{
+    pouch_buf_queue_t run;
+    struct pouch_buf *block;
+    size_t pouch_bytes = uplink.transport.pouch_bytes;
+
+    buf_queue_init(&run);
+
+    while ((block = buf_queue_get(batch)) != NULL)
+    {
+        if (pouch_is_full(pouch_bytes, block))
+        {
+            submit_blocks(&run);
+
+            int err = pouch_restart();
+            if (err)
+            {
+                blocks_requeue(block, batch);
+
+                if (err == -ENOSPC)
+                {
+                    // End the session after this pouch, the rest goes in a new session:
+                    LOG_INF("Session is out of pouch IDs");
+                    atomic_set_bit(uplink.flags, POUCH_CLOSED);
+                }
+                else
+                {
+                    LOG_WRN("Failed to start new pouch: %d", err);
+                    atomic_set_bit(uplink.flags, PROCESSING_STALLED);
+                }
+
+                return err;
+            }
+
+            pouch_bytes = 0;
+        }
+
+        if (pouch_bytes == 0 && uplink.header)
         {
-            buf_queue_submit(&uplink.transport.queue, uplink.header);
-            uplink.header = NULL;
+            pouch_bytes += buf_size_get(uplink.header);
         }
 
-        buf_queue_submit(&uplink.transport.queue, encrypted);
+        pouch_bytes += block_size_get(block) + CONFIG_POUCH_AUTH_TAG_LEN;
+        buf_queue_submit(&run, block);
+    }
+
+    submit_blocks(&run);
+
+    return 0;
+}
+
+static void process_blocks(struct k_work *work)
+{
+    if (session_is_active() && pouch_is_open())
+    {
+        pouch_buf_queue_t batch;
+
+        buf_queue_init(&batch);
+
+        if (next_blocks(&batch, CONFIG_POUCH_UPLINK_BATCH_SIZE) > 0)
+        {
+            // On failure, the transport resumes processing once it has freed some buffers:
+            if (process_batch(&batch) == 0)
+            {
+                // Process a bounded batch at a time, so a backlog doesn't hold up the rest of the
+                // work queue:
+                k_work_submit(&uplink.processing.work);
+            }
+
+            return;
+        }
     }
 
     if (pouch_is_closing())
@@ -94,15 +410,128 @@ static void end_session(void)
 {
     crypto_session_end();
     atomic_clear_bit(uplink.flags, SESSION_ACTIVE);
+
+    size_t entry_bytes = entry_block_pending_bytes();
+
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    /* Anything that's left was written during the session, so restart the age from here. This
+     * only overestimates the age by the duration of the session.
+     */
+    if (uplink.pending.blocks == 0 && entry_bytes == 0)
+    {
+        uplink.pending.since = 0;
+    }
+    else
+    {
+        uplink.pending.since = MAX(k_uptime_get(), 1);
+    }
+
+    k_mutex_unlock(&uplink.processing.lock);
+
     pouch_event_emit(POUCH_EVENT_SESSION_END);
 }
 
-void uplink_enqueue(struct pouch_buf *block)
+struct uplink_flow *uplink_flow_open(void)
+{
+    struct uplink_flow *flow = malloc(sizeof(struct uplink_flow));
+    if (flow == NULL)
+    {
+        return NULL;
+    }
+
+    buf_queue_init(&flow->queue);
+    flow->deficit = 0;
+    flow->in_turn = false;
+    flow->closed = false;
+
+    return flow;
+}
+
+void uplink_flow_enqueue(struct uplink_flow *flow, struct pouch_buf *block)
 {
-    buf_queue_submit(&uplink.processing.queue, block);
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    bool was_idle = buf_queue_is_empty(&flow->queue);
+
+    buf_queue_submit(&flow->queue, block);
+
+    uplink.pending.bytes += block_size_get(block);
+    uplink.pending.blocks++;
+
+    if (was_idle)
+    {
+        sys_slist_append(&uplink.processing.active, &flow->node);
+    }
+
+    k_mutex_unlock(&uplink.processing.lock);
+
     k_work_submit(&uplink.processing.work);
 }
 
+void uplink_flow_close(struct uplink_flow *flow, uplink_flow_release_cb_t release_cb, void *arg)
+{
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    flow->release_cb = release_cb;
+    flow->release_arg = arg;
+
+    if (buf_queue_is_empty(&flow->queue))
+    {
+        flow_release(flow);
+    }
+    else
+    {
+        flow->closed = true;
+    }
+
+    k_mutex_unlock(&uplink.processing.lock);
+}
+
+void uplink_data_written(void)
+{
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    if (uplink.pending.since == 0)
+    {
+        // Uptime is 0 at boot, but 0 means "no pending data":
+        uplink.pending.since = MAX(k_uptime_get(), 1);
+    }
+
+    k_mutex_unlock(&uplink.processing.lock);
+
+    if (IS_ENABLED(CONFIG_POUCH_SYNC_POLICY))
+    {
+        sync_policy_update();
+    }
+}
+
+int pouch_uplink_pending_get(struct pouch_uplink_pending *pending)
+{
+    if (pending == NULL)
+    {
+        return -EINVAL;
+    }
+
+    // The entry lock is taken before the processing lock when enqueueing, so keep the same order:
+    size_t entry_bytes = entry_block_pending_bytes();
+
+    k_mutex_lock(&uplink.processing.lock, K_FOREVER);
+
+    pending->bytes = uplink.pending.bytes + entry_bytes;
+    pending->blocks = uplink.pending.blocks;
+    pending->age_ms = uplink.pending.since ? k_uptime_get() - uplink.pending.since : 0;
+
+    k_mutex_unlock(&uplink.processing.lock);
+
+    return 0;
+}
+
+void uplink_enqueue(struct pouch_buf *block)
+{
+    uplink_flow_enqueue(&uplink.processing.entries, block);
+}
+
 int pouch_uplink_close(k_timeout_t timeout)
 {
     if (atomic_test_and_set_bit(uplink.flags, POUCH_CLOSING))
@@ -119,7 +548,10 @@ int pouch_uplink_close(k_timeout_t timeout)
 
 void uplink_init(void)
 {
-    buf_queue_init(&uplink.processing.queue);
+    sys_slist_init(&uplink.processing.active);
+    buf_queue_init(&uplink.processing.entries.queue);
+    buf_queue_init(&uplink.processing.retry);
+    k_mutex_init(&uplink.processing.lock);
     buf_queue_init(&uplink.transport.queue);
     k_work_init(&uplink.processing.work, process_blocks);
 }
@@ -165,7 +597,7 @@ struct pouch_uplink *pouch_uplink_start(void)
     pouch_event_emit(POUCH_EVENT_SESSION_START);
 
     // Process any pending blocks:
-    if (!buf_queue_is_empty(&uplink.processing.queue))
+    if (has_pending_blocks())
     {
         k_work_submit(&uplink.processing.work);
     }
@@ -180,6 +612,12 @@ enum pouch_result pouch_uplink_fill(struct pouch_uplink *uplink, uint8_t *dst, s
         return POUCH_ERROR;
     }
 
+    // The buffers freed since the last call may have made room for a new pouch:
+    if (atomic_test_and_clear_bit(uplink->flags, PROCESSING_STALLED))
+    {
+        k_work_submit(&uplink->processing.work);
+    }
+
     size_t maxlen = *len;
     *len = 0;
 
@@ -193,6 +631,13 @@ enum pouch_result pouch_uplink_fill(struct pouch_uplink *uplink, uint8_t *dst, s
                 break;
             }
 
+            if (is_pouch_end_marker(buf))
+            {
+                // Let the transport deliver the current pouch before starting the next one:
+                buf_free(buf);
+                return POUCH_END_OF_POUCH;
+            }
+
             pouch_bufview_init(&uplink->transport.reader, buf);
         }
 
@@ -230,6 +675,7 @@ void pouch_uplink_finish(struct pouch_uplink *uplink)
     }
 
     pouch_bufview_free(&uplink->transport.reader);
+    uplink->transport.pouch_bytes = 0;
 
     if (uplink->header)
     {
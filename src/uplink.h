@@ -12,7 +12,31 @@
 /** Initialize the pouch uplink handler */
 void uplink_init(void);
 
+/** Uplink flow: a sequence of blocks that is scheduled as a unit, such as a single stream */
+struct uplink_flow;
+
+/** Enqueue a finished entry block for processing */
 void uplink_enqueue(struct pouch_buf *block);
 
+/** Allocate a new flow for scheduling blocks */
+struct uplink_flow *uplink_flow_open(void);
+
+/** Enqueue a finished block on the given flow */
+void uplink_flow_enqueue(struct uplink_flow *flow, struct pouch_buf *block);
+
+/** Callback for when a closed flow has processed all its blocks */
+typedef void (*uplink_flow_release_cb_t)(void *arg);
+
+/**
+ * Release the flow.
+ *
+ * Its pending blocks are still processed, after which the flow is freed and @p release_cb is
+ * called.
+ */
+void uplink_flow_close(struct uplink_flow *flow, uplink_flow_release_cb_t release_cb, void *arg);
+
+/** Signal that new data has been written to the uplink */
+void uplink_data_written(void);
+
 /** Get the current uplink session ID */
 uint32_t uplink_session_id(void);
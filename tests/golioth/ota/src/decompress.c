@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#include "ota_decompress.h"
+
+/* "Golioth OTA " repeated 8 times, followed by the bytes 0 to 15, compressed with a 256 byte
+ * window and 16 byte lookahead.
+ */
+static const uint8_t compressed[] = {
+    0x84, 0xa3, 0xdb, 0xed, 0x96, 0x9b, 0x7d, 0xd2, 0xd1, 0x20, 0xa7, 0xd5, 0x28, 0x32, 0x00,
+    0x5f, 0x82, 0xfc, 0x17, 0xe0, 0xbf, 0x05, 0xf8, 0x2c, 0xe0, 0x10, 0x18, 0x14, 0x0e, 0x09,
+    0x05, 0x83, 0x41, 0xe1, 0x10, 0x98, 0x54, 0x2e, 0x19, 0x0d, 0x87, 0x43, 0xc0,
+};
+
+static uint8_t expected[112];
+
+static struct
+{
+    uint8_t buf[sizeof(expected)];
+    size_t len;
+    int last_count;
+} output;
+
+static void *decompress_setup(void)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        memcpy(&expected[12 * i], "Golioth OTA ", 12);
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        expected[96 + i] = i;
+    }
+
+    return NULL;
+}
+
+ZTEST_SUITE(ota_decompress, NULL, decompress_setup, NULL, NULL, NULL);
+
+static int output_write(const void *data, size_t len, bool is_last, void *user_data)
+{
+    zassert_true(output.len + len <= sizeof(output.buf));
+    zassert_equal(output.last_count, 0, "Data after the last chunk");
+
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.last_count += is_last;
+
+    return 0;
+}
+
+static int decompress_chunked(const uint8_t *data, size_t len, size_t chunk_len)
+{
+    struct ota_decompress decompress;
+
+    memset(&output, 0, sizeof(output));
+    ota_decompress_init(&decompress, output_write, NULL);
+
+    for (size_t offset = 0; offset < len; offset += chunk_len)
+    {
+        int err = ota_decompress_feed(&decompress, &data[offset], MIN(chunk_len, len - offset));
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    return ota_decompress_finish(&decompress);
+}
+
+ZTEST(ota_decompress, test_chunked)
+{
+    for (size_t chunk_len = 1; chunk_len <= sizeof(compressed); chunk_len++)
+    {
+        zassert_ok(decompress_chunked(compressed, sizeof(compressed), chunk_len));
+        zassert_equal(output.len, sizeof(expected), "chunk_len %zu", chunk_len);
+        zassert_mem_equal(output.buf, expected, sizeof(expected), "chunk_len %zu", chunk_len);
+        zassert_equal(output.last_count, 1);
+    }
+}
+
+ZTEST(ota_decompress, test_invalid)
+{
+    /* Window larger than CONFIG_GOLIOTH_OTA_DECOMPRESS_WINDOW_BITS */
+    zassert_equal(decompress_chunked((uint8_t[]) {0xf4, 0x00}, 2, 2), -ENOTSUP);
+
+    /* Lookahead not smaller than the window */
+    zassert_equal(decompress_chunked((uint8_t[]) {0x88, 0x00}, 2, 2), -EBADMSG);
+
+    /* Missing header */
+    zassert_equal(decompress_chunked(NULL, 0, 1), -EBADMSG);
+
+    /* Truncated in the middle of a back reference */
+    zassert_equal(decompress_chunked((uint8_t[]) {0x84, 0x7f}, 2, 1), -EBADMSG);
+}
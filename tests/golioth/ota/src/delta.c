@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <string.h>
+
+#include <golioth/ota.h>
+#include <golioth/ota_delta.h>
+#include <golioth/ota_flash_img.h>
+#include <psa/crypto.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/ztest.h>
+
+#define OLD_SIZE 4096
+#define TARGET_SIZE 3120
+
+static uint8_t old_image[OLD_SIZE];
+static uint8_t target_image[TARGET_SIZE];
+static uint8_t output[TARGET_SIZE];
+static size_t output_len;
+
+static uint8_t patch[TARGET_SIZE + 64];
+static size_t patch_len;
+
+static void put_varint(uint64_t value)
+{
+    do
+    {
+        uint8_t byte = value & 0x7f;
+
+        value >>= 7;
+        patch[patch_len++] = byte | (value ? 0x80 : 0);
+    } while (value);
+}
+
+/*
+ * The target image is built from the old image:
+ *
+ * - old[0..1000) with a few bytes changed
+ * - 20 new bytes
+ * - old[1500..3500)
+ * - old[500..600), with every byte incremented
+ */
+static void *delta_setup(void)
+{
+    static const struct
+    {
+        size_t diff_len;
+        size_t extra_len;
+        int64_t seek;
+    } records[] = {
+        {1000, 20, 500},
+        {2000, 0, -3000},
+        {100, 0, 0},
+    };
+    size_t old_pos = 0;
+    size_t target_pos = 0;
+
+    for (size_t i = 0; i < sizeof(old_image); i++)
+    {
+        old_image[i] = (uint8_t) ((i * 7) ^ (i >> 5));
+    }
+
+    memcpy(&target_image[0], &old_image[0], 1000);
+    for (size_t i = 100; i < 110; i++)
+    {
+        target_image[i] ^= 0x5a;
+    }
+    memcpy(&target_image[1000], "0123456789abcdefghij", 20);
+    memcpy(&target_image[1020], &old_image[1500], 2000);
+    for (size_t i = 0; i < 100; i++)
+    {
+        target_image[3020 + i] = old_image[500 + i] + 1;
+    }
+
+    memcpy(patch, GOLIOTH_OTA_DELTA_MAGIC, sizeof(GOLIOTH_OTA_DELTA_MAGIC) - 1);
+    patch_len = sizeof(GOLIOTH_OTA_DELTA_MAGIC) - 1;
+    put_varint(TARGET_SIZE);
+
+    for (size_t i = 0; i < ARRAY_SIZE(records); i++)
+    {
+        put_varint(records[i].diff_len);
+        put_varint(records[i].extra_len);
+        put_varint((uint64_t) ((records[i].seek << 1) ^ (records[i].seek >> 63)));
+
+        for (size_t j = 0; j < records[i].diff_len; j++)
+        {
+            patch[patch_len++] = target_image[target_pos + j] - old_image[old_pos + j];
+        }
+
+        old_pos += records[i].diff_len;
+        target_pos += records[i].diff_len;
+
+        memcpy(&patch[patch_len], &target_image[target_pos], records[i].extra_len);
+        patch_len += records[i].extra_len;
+        target_pos += records[i].extra_len;
+
+        old_pos += records[i].seek;
+    }
+
+    return NULL;
+}
+
+static int old_image_read(size_t offset, void *buf, size_t len, void *user_data)
+{
+    if (offset + len > sizeof(old_image))
+    {
+        return -EINVAL;
+    }
+
+    memcpy(buf, &old_image[offset], len);
+
+    return 0;
+}
+
+static int output_write(const void *data, size_t len, void *user_data)
+{
+    zassert_true(output_len + len <= sizeof(output));
+
+    memcpy(&output[output_len], data, len);
+    output_len += len;
+
+    return 0;
+}
+
+static int apply_patch(const uint8_t *data, size_t len, size_t chunk_len)
+{
+    struct golioth_ota_delta delta;
+
+    output_len = 0;
+    golioth_ota_delta_init(&delta, old_image_read, output_write, NULL);
+
+    for (size_t offset = 0; offset < len; offset += chunk_len)
+    {
+        int err = golioth_ota_delta_feed(&delta, &data[offset], MIN(chunk_len, len - offset));
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    return golioth_ota_delta_finish(&delta);
+}
+
+ZTEST_SUITE(ota_delta, NULL, delta_setup, NULL, NULL, NULL);
+
+ZTEST(ota_delta, test_chunked)
+{
+    static const size_t chunk_lens[] = {1, 2, 3, 7, 64, 65, 1000};
+
+    for (size_t i = 0; i < ARRAY_SIZE(chunk_lens); i++)
+    {
+        zassert_ok(apply_patch(patch, patch_len, chunk_lens[i]), "chunk_len %zu", chunk_lens[i]);
+        zassert_equal(output_len, TARGET_SIZE);
+        zassert_mem_equal(output, target_image, TARGET_SIZE, "chunk_len %zu", chunk_lens[i]);
+    }
+}
+
+ZTEST(ota_delta, test_invalid)
+{
+    static uint8_t buf[sizeof(patch) + 1];
+
+    /* Bad magic */
+    memcpy(buf, patch, patch_len);
+    buf[0] ^= 0xff;
+    zassert_equal(apply_patch(buf, patch_len, patch_len), -EBADMSG);
+
+    /* Truncated */
+    zassert_equal(apply_patch(patch, patch_len - 1, patch_len), -EBADMSG);
+
+    /* Trailing data */
+    memcpy(buf, patch, patch_len);
+    zassert_equal(apply_patch(buf, patch_len + 1, patch_len + 1), -EBADMSG);
+
+    /* Record longer than the target image */
+    static const uint8_t overrun[] = {'G', 'D', 'P', '1', 0x02, 0x03, 0x00, 0x00};
+    zassert_equal(apply_patch(overrun, sizeof(overrun), 1), -EBADMSG);
+
+    /* Seek before the start of the old image */
+    static const uint8_t seek[] = {'G', 'D', 'P', '1', 0x01, 0x00, 0x01, 0x01, 'x'};
+    zassert_equal(apply_patch(seek, sizeof(seek), 1), -EBADMSG);
+}
+
+static void ota_delta_receive(const void *data, size_t offset, size_t len, bool is_last) {}
+
+GOLIOTH_OTA_COMPONENT(delta, "delta", "1.0.0", ota_delta_receive);
+
+static struct golioth_ota_flash_img img;
+
+static void delta_flash_before(void *fixture)
+{
+    const struct flash_area *fa;
+    size_t hash_len;
+
+    /* The patch applies to the image in the primary slot */
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot0_partition), &fa));
+    zassert_ok(flash_area_erase(fa, 0, OLD_SIZE));
+    zassert_ok(flash_area_write(fa, 0, old_image, OLD_SIZE));
+    flash_area_close(fa);
+
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+    zassert_equal(psa_hash_compute(PSA_ALG_SHA_256,
+                                   target_image,
+                                   sizeof(target_image),
+                                   ota_component_data_delta.target_hash,
+                                   sizeof(ota_component_data_delta.target_hash),
+                                   &hash_len),
+                  PSA_SUCCESS);
+    /* The size of the reconstructed image, not the patch */
+    ota_component_data_delta.size = TARGET_SIZE;
+    ota_component_data_delta.delta = true;
+    memset(&img, 0, sizeof(img));
+
+    zassert_ok(golioth_ota_mark_for_download("delta"));
+}
+
+static void delta_flash_after(void *fixture)
+{
+    golioth_ota_mark_idle("delta");
+}
+
+static int write_patch(size_t chunk_len)
+{
+    for (size_t offset = 0; offset < patch_len; offset += chunk_len)
+    {
+        size_t len = MIN(chunk_len, patch_len - offset);
+
+        int err = golioth_ota_flash_img_write(&img,
+                                              &ota_component_delta,
+                                              &patch[offset],
+                                              offset,
+                                              len,
+                                              offset + len == patch_len);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+ZTEST_SUITE(ota_delta_flash, NULL, delta_setup, delta_flash_before, delta_flash_after, NULL);
+
+ZTEST(ota_delta_flash, test_flash_patch)
+{
+    const struct flash_area *fa;
+    uint8_t buf[100];
+
+    zassert_ok(write_patch(100));
+
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa));
+
+    for (size_t offset = 0; offset < TARGET_SIZE; offset += sizeof(buf))
+    {
+        size_t len = MIN(sizeof(buf), TARGET_SIZE - offset);
+
+        zassert_ok(flash_area_read(fa, offset, buf, len));
+        zassert_mem_equal(buf, &target_image[offset], len, "Mismatch at offset %zu", offset);
+    }
+
+    flash_area_close(fa);
+}
+
+ZTEST(ota_delta_flash, test_flash_patch_hash_mismatch)
+{
+    ota_component_data_delta.target_hash[0] ^= 0x01;
+
+    zassert_equal(write_patch(100), -EBADMSG);
+}
+
+/* The manifest size is checked against the reconstructed image, not the patch */
+ZTEST(ota_delta_flash, test_flash_patch_size_mismatch)
+{
+    ota_component_data_delta.size = patch_len;
+
+    zassert_equal(write_patch(100), -EBADMSG);
+}
+
+ZTEST(ota_delta_flash, test_flash_patch_no_resume)
+{
+    zassert_equal(golioth_ota_flash_img_write(&img,
+                                              &ota_component_delta,
+                                              &patch[100],
+                                              100,
+                                              100,
+                                              false),
+                  -ESPIPE);
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <string.h>
+
+#include <golioth/ota.h>
+#include <golioth/ota_flash_img.h>
+#include <psa/crypto.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/ztest.h>
+
+#define IMAGE_SIZE 5000
+
+/* The write position can only be restored from the stored stream_flash progress */
+#define CAN_RESUME \
+    (IS_ENABLED(CONFIG_GOLIOTH_OTA_RESUME) && IS_ENABLED(CONFIG_STREAM_FLASH_PROGRESS))
+
+static uint8_t image[IMAGE_SIZE];
+static uint8_t image_hash[GOLIOTH_OTA_COMPONENT_HASH_BIN_LEN];
+static struct golioth_ota_flash_img img;
+
+static void ota_test_receive(const void *data, size_t offset, size_t len, bool is_last) {}
+
+GOLIOTH_OTA_COMPONENT(test, "test", "1.0.0", ota_test_receive);
+
+static void *flash_img_setup(void)
+{
+    size_t hash_len;
+
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+
+#if defined(CONFIG_SETTINGS)
+    zassert_ok(settings_subsys_init());
+#endif
+
+    for (size_t i = 0; i < sizeof(image); i++)
+    {
+        image[i] = (uint8_t) ((i * 31) ^ (i >> 8));
+    }
+
+    zassert_equal(psa_hash_compute(PSA_ALG_SHA_256,
+                                   image,
+                                   sizeof(image),
+                                   image_hash,
+                                   sizeof(image_hash),
+                                   &hash_len),
+                  PSA_SUCCESS);
+
+    return NULL;
+}
+
+static void flash_img_before(void *fixture)
+{
+    memcpy(ota_component_data_test.target_hash, image_hash, sizeof(image_hash));
+    ota_component_data_test.size = IMAGE_SIZE;
+    ota_component_data_test.compressed = false;
+    memset(&img, 0, sizeof(img));
+
+    zassert_ok(golioth_ota_mark_for_download("test"));
+}
+
+static void flash_img_after(void *fixture)
+{
+    golioth_ota_mark_idle("test");
+}
+
+ZTEST_SUITE(ota_flash_img, NULL, flash_img_setup, flash_img_before, flash_img_after, NULL);
+
+/** Write the image from @p start to @p end in chunks, returning the first error */
+static int write_image(size_t start, size_t end, size_t chunk_len)
+{
+    for (size_t offset = start; offset < end; offset += chunk_len)
+    {
+        size_t len = MIN(chunk_len, end - offset);
+        bool is_last = (offset + len == IMAGE_SIZE);
+
+        int err = golioth_ota_flash_img_write(&img,
+                                              &ota_component_test,
+                                              &image[offset],
+                                              offset,
+                                              len,
+                                              is_last);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+static void assert_flash_matches_image(void)
+{
+    const struct flash_area *fa;
+    uint8_t buf[100];
+
+    zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa));
+
+    for (size_t offset = 0; offset < IMAGE_SIZE; offset += sizeof(buf))
+    {
+        size_t len = MIN(sizeof(buf), IMAGE_SIZE - offset);
+
+        zassert_ok(flash_area_read(fa, offset, buf, len));
+        zassert_mem_equal(buf, &image[offset], len, "Mismatch at offset %zu", offset);
+    }
+
+    flash_area_close(fa);
+}
+
+ZTEST(ota_flash_img, test_write)
+{
+    static const size_t chunk_lens[] = {7, 100, 512, 1300, IMAGE_SIZE};
+
+    for (size_t i = 0; i < ARRAY_SIZE(chunk_lens); i++)
+    {
+        zassert_ok(write_image(0, IMAGE_SIZE, chunk_lens[i]), "chunk_len %zu", chunk_lens[i]);
+        assert_flash_matches_image();
+    }
+}
+
+ZTEST(ota_flash_img, test_hash_mismatch)
+{
+    ota_component_data_test.target_hash[0] ^= 0x01;
+
+    zassert_equal(write_image(0, IMAGE_SIZE, 100), -EBADMSG);
+}
+
+ZTEST(ota_flash_img, test_size_mismatch)
+{
+    ota_component_data_test.size = IMAGE_SIZE + 1;
+
+    zassert_equal(write_image(0, IMAGE_SIZE, 100), -EBADMSG);
+}
+
+/* The size in the manifest is the size of the decompressed image */
+ZTEST(ota_flash_img, test_size_mismatch_compressed)
+{
+    ota_component_data_test.compressed = true;
+    ota_component_data_test.size = IMAGE_SIZE + 1;
+
+    zassert_equal(write_image(0, IMAGE_SIZE, 100), -EBADMSG);
+}
+
+ZTEST(ota_flash_img, test_restart_at_committed_offset)
+{
+    zassert_ok(write_image(0, 3000, 100));
+
+    size_t committed = ota_component_data_test.offset;
+
+    if (!CAN_RESUME)
+    {
+        /* No progress is reported, so the download starts over */
+        zassert_equal(committed, 0);
+        zassert_equal(write_image(1024, IMAGE_SIZE, 100), -ESPIPE);
+        zassert_ok(write_image(0, IMAGE_SIZE, 100));
+        assert_flash_matches_image();
+        return;
+    }
+
+    /* Only data that has been written to flash is reported */
+    zassert_true(committed > 0 && committed < 3000, "committed %zu", committed);
+
+    zassert_ok(write_image(committed, IMAGE_SIZE, 100));
+    assert_flash_matches_image();
+}
+
+ZTEST(ota_flash_img, test_discontinuity)
+{
+    zassert_ok(write_image(0, 1000, 100));
+    zassert_equal(write_image(2000, IMAGE_SIZE, 100), -ESPIPE);
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+
+import json
+from pathlib import Path
+
+import typer
+from typing_extensions import Annotated
+
+
+PREFIX = "BENCH "
+
+
+app = typer.Typer()
+
+
+def key(result):
+    return f"{result['name']}/{result['variant']}/{result['size']}"
+
+
+def parse_log(log: Path):
+    results = {}
+    for line in log.read_text().splitlines():
+        # Log lines may have a timestamp or other prefix before the marker:
+        start = line.find(PREFIX)
+        if start < 0:
+            continue
+
+        result = json.loads(line[start + len(PREFIX) :])
+        results[key(result)] = result
+
+    return results
+
+
+@app.command()
+def main(
+    log: Annotated[Path, typer.Argument(help="Console output of the benchmark, e.g. handler.log")],
+    output: Annotated[Path, typer.Argument(help="JSON file to write the results to")],
+    version: Annotated[str, typer.Option(help="Pouch version the results were measured on")] = "",
+    baseline: Annotated[Path, typer.Option(help="Earlier results to compare against")] = None,
+    threshold: Annotated[
+        float, typer.Option(help="Slowdown relative to the baseline that counts as a regression")
+    ] = 0.2,
+):
+    results = parse_log(log)
+    if not results:
+        raise typer.BadParameter(f"No benchmark results in {log}")
+
+    output.write_text(json.dumps({"version": version, "results": list(results.values())}, indent=2))
+
+    if baseline is None:
+        return
+
+    regressions = 0
+    for result in json.loads(baseline.read_text())["results"]:
+        current = results.get(key(result))
+        if current is None or result["ns"] == 0:
+            continue
+
+        slowdown = current["ns"] / result["ns"] - 1
+        if slowdown > threshold:
+            print(f"{key(result)}: {result['ns']} ns -> {current['ns']} ns (+{slowdown:.0%})")
+            regressions += 1
+
+    if regressions:
+        raise typer.Exit(code=1)
+
+
+if __name__ == "__main__":
+    app()
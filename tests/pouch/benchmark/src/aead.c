@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <string.h>
+
+#include <psa/crypto.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+#include "bench.h"
+#include "block.h"
+#include "cert.h"
+#include "saead/session.h"
+#include "saead/uplink.h"
+
+#define NONCE_LEN 12
+#define MIN_BLOCK_SIZE 64
+#define MAX_BLOCK_SIZE 4096
+/** Number of bytes to process for each algorithm and block size */
+#define BYTES_PER_RUN (64 * 1024)
+#define BATCH_SIZE CONFIG_POUCH_UPLINK_BATCH_SIZE
+
+static const struct
+{
+    psa_algorithm_t algorithm;
+    const char *name;
+} algorithms[] = {
+    {PSA_ALG_CHACHA20_POLY1305, "chacha20-poly1305"},
+    {PSA_ALG_GCM, "aes-gcm"},
+};
+
+/* The uplink session is derived from the Golioth root certificate's P-384 key */
+static const uint8_t root_cert[] = {
+#include "root_cert.inc"
+};
+
+static struct session session;
+static struct pouch_buf *block;
+static uint8_t plaintext[MAX_BLOCK_SIZE];
+static uint8_t ciphertext[MAX_BLOCK_SIZE + AUTH_TAG_LEN];
+
+static struct pouch_buf *batch[BATCH_SIZE];
+static psa_key_id_t private_key;
+
+static void *aead_setup(void)
+{
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+
+    block = buf_alloc(sizeof(uint16_t) + MAX_BLOCK_SIZE + AUTH_TAG_LEN);
+    zassert_not_null(block);
+
+    for (size_t i = 0; i < ARRAY_SIZE(batch); i++)
+    {
+        batch[i] = buf_alloc(sizeof(uint16_t) + MAX_BLOCK_SIZE + AUTH_TAG_LEN);
+        zassert_not_null(batch[i]);
+    }
+
+    memset(plaintext, 0xa5, sizeof(plaintext));
+
+    return NULL;
+}
+
+static void aead_teardown(void *fixture)
+{
+    buf_free(block);
+
+    for (size_t i = 0; i < ARRAY_SIZE(batch); i++)
+    {
+        buf_free(batch[i]);
+    }
+}
+
+static void session_init(psa_algorithm_t algorithm)
+{
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_ENCRYPT | PSA_KEY_USAGE_DECRYPT);
+    psa_set_key_lifetime(&key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_algorithm(&key_attributes, algorithm);
+    psa_set_key_type(&key_attributes, SESSION_KEY_TYPE(algorithm));
+    psa_set_key_bits(&key_attributes, SAEAD_KEY_SIZE(algorithm) * 8);
+
+    memset(&session, 0, sizeof(session));
+    session.algorithm = algorithm;
+    atomic_set_bit(&session.flags, SESSION_ACTIVE);
+
+    zassert_equal(psa_generate_key(&key_attributes, &session.key), PSA_SUCCESS);
+    zassert_ok(session_pouch_start(&session, 1));
+}
+
+static void session_deinit(void)
+{
+    session_end(&session);
+}
+
+static void block_fill(size_t size)
+{
+    buf_restore(block, POUCH_BUF_STATE_INITIAL);
+    block_size_write(block, size);
+    buf_write(block, plaintext, size);
+}
+
+static void uplink_session_init(void)
+{
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    struct pouch_cert cert = {
+        .buffer = root_cert,
+        .size = sizeof(root_cert),
+    };
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_lifetime(&key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&key_attributes, 384);
+
+    zassert_equal(psa_generate_key(&key_attributes, &private_key), PSA_SUCCESS);
+    zassert_ok(cert_server_set(&cert));
+
+    saead_uplink_init(NULL, PSA_ALG_CHACHA20_POLY1305, private_key);
+    zassert_ok(saead_uplink_session_start(PSA_ALG_CHACHA20_POLY1305, private_key));
+    zassert_ok(saead_uplink_pouch_start());
+}
+
+static void uplink_session_deinit(void)
+{
+    saead_uplink_session_end();
+    (void) psa_destroy_key(private_key);
+}
+
+static void bench_encrypt(const char *name, size_t size)
+{
+    unsigned int iterations = BYTES_PER_RUN / size;
+    struct bench_timer timer;
+
+    bench_start(&timer);
+
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        block_fill(size);
+        zassert_ok(session_encrypt_block(&session, block));
+    }
+
+    bench_report(&timer, "session_encrypt_block", name, size, iterations);
+}
+
+static void bench_decrypt(const char *name, size_t size)
+{
+    unsigned int iterations = BYTES_PER_RUN / size;
+    struct bench_timer timer;
+    uint8_t nonce[NONCE_LEN] = {0};
+    size_t ciphertext_len;
+
+    // Encrypt the first block of the pouch as the server would, so it can be authenticated:
+    sys_put_be16(session.pouch.id, &nonce[0]);
+    nonce[4] = POUCH_ROLE_SERVER;
+
+    zassert_equal(psa_aead_encrypt(session.key,
+                                   session.algorithm,
+                                   nonce,
+                                   sizeof(nonce),
+                                   NULL,
+                                   0,
+                                   plaintext,
+                                   size,
+                                   ciphertext,
+                                   size + AUTH_TAG_LEN,
+                                   &ciphertext_len),
+                  PSA_SUCCESS);
+
+    bench_start(&timer);
+
+    // Includes copying the ciphertext, which is small compared to the decryption:
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        buf_restore(block, POUCH_BUF_STATE_INITIAL);
+        block_size_write(block, ciphertext_len);
+        buf_write(block, ciphertext, ciphertext_len);
+
+        session.pouch.block_index = 0;
+        zassert_ok(session_decrypt_block(&session, block));
+    }
+
+    bench_report(&timer, "session_decrypt_block", name, size, iterations);
+}
+
+static void bench_encrypt_batch(const char *name, size_t size)
+{
+    unsigned int runs = DIV_ROUND_UP(BYTES_PER_RUN / size, BATCH_SIZE);
+    struct bench_timer timer;
+    pouch_buf_queue_t blocks;
+
+    buf_queue_init(&blocks);
+
+    bench_start(&timer);
+
+    for (unsigned int i = 0; i < runs; i++)
+    {
+        for (size_t j = 0; j < ARRAY_SIZE(batch); j++)
+        {
+            buf_restore(batch[j], POUCH_BUF_STATE_INITIAL);
+            block_size_write(batch[j], size);
+            buf_write(batch[j], plaintext, size);
+            buf_queue_submit(&blocks, batch[j]);
+        }
+
+        saead_uplink_encrypt_blocks(&blocks);
+
+        // Failed blocks are freed, so all of them must come back:
+        for (size_t j = 0; j < ARRAY_SIZE(batch); j++)
+        {
+            zassert_equal_ptr(buf_queue_get(&blocks), batch[j], "Encryption failed");
+        }
+    }
+
+    bench_report(&timer, "saead_uplink_encrypt_blocks", name, size, runs * BATCH_SIZE);
+}
+
+ZTEST_SUITE(bench_aead, NULL, aead_setup, NULL, NULL, aead_teardown);
+
+ZTEST(bench_aead, test_encrypt)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(algorithms); i++)
+    {
+        session_init(algorithms[i].algorithm);
+
+        for (size_t size = MIN_BLOCK_SIZE; size <= MAX_BLOCK_SIZE; size *= 2)
+        {
+            bench_encrypt(algorithms[i].name, size);
+        }
+
+        session_deinit();
+    }
+}
+
+/* Per block cost of the batched uplink encryption, on the same block sizes as test_encrypt */
+ZTEST(bench_aead, test_encrypt_batch)
+{
+    uplink_session_init();
+
+    for (size_t size = MIN_BLOCK_SIZE; size <= MAX_BLOCK_SIZE; size *= 2)
+    {
+        bench_encrypt_batch("chacha20-poly1305", size);
+    }
+
+    uplink_session_deinit();
+}
+
+ZTEST(bench_aead, test_decrypt)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(algorithms); i++)
+    {
+        session_init(algorithms[i].algorithm);
+
+        for (size_t size = MIN_BLOCK_SIZE; size <= MAX_BLOCK_SIZE; size *= 2)
+        {
+            bench_decrypt(algorithms[i].name, size);
+        }
+
+        session_deinit();
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include "bench.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#if defined(CONFIG_ARCH_POSIX)
+/* Implemented on the host side, in host_time.c */
+uint64_t bench_host_time_ns(void);
+#endif
+
+void bench_start(struct bench_timer *timer)
+{
+#if defined(CONFIG_ARCH_POSIX)
+    timer->start_ns = bench_host_time_ns();
+#endif
+    timer->start_cycles = k_cycle_get_32();
+}
+
+void bench_pause(struct bench_timer *timer)
+{
+#if defined(CONFIG_ARCH_POSIX)
+    timer->pause_ns = bench_host_time_ns();
+#endif
+    timer->pause_cycles = k_cycle_get_32();
+}
+
+void bench_resume(struct bench_timer *timer)
+{
+    // Move the start forward by the time spent paused:
+    timer->start_cycles += k_cycle_get_32() - timer->pause_cycles;
+#if defined(CONFIG_ARCH_POSIX)
+    timer->start_ns += bench_host_time_ns() - timer->pause_ns;
+#endif
+}
+
+void bench_report(const struct bench_timer *timer,
+                  const char *name,
+                  const char *variant,
+                  size_t size,
+                  unsigned int iterations)
+{
+    uint32_t cycles = k_cycle_get_32() - timer->start_cycles;
+
+#if defined(CONFIG_ARCH_POSIX)
+    uint64_t ns = bench_host_time_ns() - timer->start_ns;
+#else
+    uint64_t ns = k_cyc_to_ns_floor64(cycles);
+#endif
+
+    uint64_t bytes_per_sec = ns ? (uint64_t) size * iterations * NSEC_PER_SEC / ns : 0;
+
+    printk("BENCH {\"name\":\"%s\",\"variant\":\"%s\",\"size\":%zu,\"iterations\":%u,"
+           "\"ns\":%llu,",
+           name,
+           variant,
+           size,
+           iterations,
+           (unsigned long long) (ns / iterations));
+
+    if (IS_ENABLED(CONFIG_ARCH_POSIX))
+    {
+        printk("\"cycles\":null,");
+    }
+    else
+    {
+        printk("\"cycles\":%u,", cycles / iterations);
+    }
+
+    printk("\"bytes_per_sec\":%llu}\n", (unsigned long long) bytes_per_sec);
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Each measurement is reported as a single JSON line on the console, prefixed with "BENCH ":
+ *
+ * BENCH {"name":"encrypt","variant":"chacha20-poly1305","size":512,"iterations":64,
+ *        "ns":1234,"cycles":5678,"bytes_per_sec":414910}
+ *
+ * ns and cycles are per iteration. cycles is null on native_sim, where the cycle counter follows
+ * the simulated clock instead of the host CPU. size and bytes_per_sec are 0 for operations that
+ * don't process a payload.
+ */
+
+struct bench_timer
+{
+    uint64_t start_ns;
+    uint32_t start_cycles;
+    uint64_t pause_ns;
+    uint32_t pause_cycles;
+};
+
+void bench_start(struct bench_timer *timer);
+
+/** Stop counting time, such as while preparing the next iteration */
+void bench_pause(struct bench_timer *timer);
+
+/** Continue counting time after bench_pause() */
+void bench_resume(struct bench_timer *timer);
+
+/** Stop the timer, and report the time per iteration */
+void bench_report(const struct bench_timer *timer,
+                  const char *name,
+                  const char *variant,
+                  size_t size,
+                  unsigned int iterations);
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <mbedtls/pk.h>
+#include <mbedtls/x509_crt.h>
+#include <psa/crypto.h>
+#include <zephyr/ztest.h>
+
+#include "bench.h"
+#include "cert.h"
+
+#define CERT_ITERATIONS 8
+
+/* The Golioth root certificate is a self-signed P-384 certificate, so it can be used to measure
+ * both parsing and signature verification without any other credentials.
+ */
+static const uint8_t root_cert[] = {
+#include "root_cert.inc"
+};
+
+static void *cert_setup(void)
+{
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+
+    return NULL;
+}
+
+ZTEST_SUITE(bench_cert, NULL, cert_setup, NULL, NULL, NULL);
+
+ZTEST(bench_cert, test_parse)
+{
+    struct bench_timer timer;
+
+    bench_start(&timer);
+
+    for (int i = 0; i < CERT_ITERATIONS; i++)
+    {
+        mbedtls_x509_crt crt;
+
+        mbedtls_x509_crt_init(&crt);
+        zassert_ok(mbedtls_x509_crt_parse_der_nocopy(&crt, root_cert, sizeof(root_cert)));
+        mbedtls_x509_crt_free(&crt);
+    }
+
+    bench_report(&timer, "cert_parse", "p384", sizeof(root_cert), CERT_ITERATIONS);
+}
+
+ZTEST(bench_cert, test_verify)
+{
+    struct bench_timer timer;
+    mbedtls_x509_crt crt;
+    uint8_t hash[PSA_HASH_MAX_SIZE];
+    size_t hash_len;
+
+    mbedtls_x509_crt_init(&crt);
+    zassert_ok(mbedtls_x509_crt_parse_der_nocopy(&crt, root_cert, sizeof(root_cert)));
+    zassert_equal(crt.sig_md, MBEDTLS_MD_SHA384);
+
+    bench_start(&timer);
+
+    // Hash the signed part of the certificate, and check the signature, like chain verification:
+    for (int i = 0; i < CERT_ITERATIONS; i++)
+    {
+        zassert_equal(psa_hash_compute(PSA_ALG_SHA_384,
+                                       crt.tbs.p,
+                                       crt.tbs.len,
+                                       hash,
+                                       sizeof(hash),
+                                       &hash_len),
+                      PSA_SUCCESS);
+        zassert_ok(mbedtls_pk_verify(&crt.pk, crt.sig_md, hash, hash_len, crt.sig.p, crt.sig.len));
+    }
+
+    bench_report(&timer, "cert_verify", "p384", sizeof(root_cert), CERT_ITERATIONS);
+
+    mbedtls_x509_crt_free(&crt);
+}
+
+/* Parses the certificate and extracts the public key the first time, and only hashes the
+ * certificate when it's set again.
+ */
+ZTEST(bench_cert, test_cert_server_set)
+{
+    const struct pouch_cert cert = {
+        .buffer = root_cert,
+        .size = sizeof(root_cert),
+    };
+    struct bench_timer timer;
+
+    bench_start(&timer);
+    zassert_ok(cert_server_set(&cert));
+    bench_report(&timer, "cert_server_set", "new", sizeof(root_cert), 1);
+
+    bench_start(&timer);
+
+    for (int i = 0; i < CERT_ITERATIONS; i++)
+    {
+        zassert_ok(cert_server_set(&cert));
+    }
+
+    bench_report(&timer, "cert_server_set", "unchanged", sizeof(root_cert), CERT_ITERATIONS);
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+/*
+ * Host side of native_sim, built against the host libc. Simulated time doesn't advance while the
+ * CPU is busy, so the host clock is used to time the benchmarks.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
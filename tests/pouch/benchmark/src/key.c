@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <psa/crypto.h>
+#include <zephyr/ztest.h>
+
+#include "bench.h"
+#include "block.h"
+#include "saead/session.h"
+
+#define KEY_ITERATIONS 8
+
+static const struct
+{
+    size_t bits;
+    const char *name;
+} curves[] = {
+    {256, "p256"},
+    {384, "p384"},
+};
+
+static psa_key_id_t ecdh_key_generate(size_t bits)
+{
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_key_id_t key;
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_lifetime(&key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&key_attributes, bits);
+
+    zassert_equal(psa_generate_key(&key_attributes, &key), PSA_SUCCESS);
+
+    return key;
+}
+
+static void *key_setup(void)
+{
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+
+    return NULL;
+}
+
+ZTEST_SUITE(bench_key, NULL, key_setup, NULL, NULL, NULL);
+
+ZTEST(bench_key, test_ecdh)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(curves); i++)
+    {
+        psa_key_id_t private_key = ecdh_key_generate(curves[i].bits);
+        psa_key_id_t peer_key = ecdh_key_generate(curves[i].bits);
+        struct pubkey pubkey;
+        uint8_t secret[PSA_RAW_KEY_AGREEMENT_OUTPUT_MAX_SIZE];
+        size_t secret_len;
+        struct bench_timer timer;
+
+        zassert_equal(
+            psa_export_public_key(peer_key, pubkey.data, sizeof(pubkey.data), &pubkey.len),
+            PSA_SUCCESS);
+
+        bench_start(&timer);
+
+        for (int j = 0; j < KEY_ITERATIONS; j++)
+        {
+            zassert_equal(psa_raw_key_agreement(PSA_ALG_ECDH,
+                                                private_key,
+                                                pubkey.data,
+                                                pubkey.len,
+                                                secret,
+                                                sizeof(secret),
+                                                &secret_len),
+                          PSA_SUCCESS);
+        }
+
+        bench_report(&timer, "ecdh", curves[i].name, 0, KEY_ITERATIONS);
+
+        (void) psa_destroy_key(private_key);
+        (void) psa_destroy_key(peer_key);
+    }
+}
+
+/* ECDH followed by HKDF, as done for every new session */
+ZTEST(bench_key, test_session_key_generate)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(curves); i++)
+    {
+        psa_key_id_t private_key = ecdh_key_generate(curves[i].bits);
+        psa_key_id_t peer_key = ecdh_key_generate(curves[i].bits);
+        struct session_id id = {.type = SESSION_ID_TYPE_RANDOM};
+        struct pubkey pubkey;
+        struct bench_timer timer;
+
+        zassert_equal(
+            psa_export_public_key(peer_key, pubkey.data, sizeof(pubkey.data), &pubkey.len),
+            PSA_SUCCESS);
+        zassert_ok(session_id_generate(&id));
+
+        bench_start(&timer);
+
+        for (int j = 0; j < KEY_ITERATIONS; j++)
+        {
+            psa_key_id_t key = session_key_generate(&id,
+                                                    PSA_ALG_CHACHA20_POLY1305,
+                                                    MAX_BLOCK_PAYLOAD_SIZE_LOG,
+                                                    private_key,
+                                                    &pubkey,
+                                                    PSA_KEY_USAGE_ENCRYPT);
+            zassert_not_equal(key, PSA_KEY_ID_NULL);
+            (void) psa_destroy_key(key);
+        }
+
+        bench_report(&timer, "session_key_generate", curves[i].name, 0, KEY_ITERATIONS);
+
+        (void) psa_destroy_key(private_key);
+        (void) psa_destroy_key(peer_key);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <psa/crypto.h>
+#include <zephyr/ztest.h>
+
+#include "bench.h"
+#include "cert.h"
+#include "saead/uplink.h"
+
+#define SESSION_ITERATIONS 8
+#define SESSION_STACK_SIZE 4096
+
+/* The Golioth root certificate has a P-384 key, so the device key must be on the same curve for the
+ * ECDH key agreement.
+ */
+static const uint8_t root_cert[] = {
+#include "root_cert.inc"
+};
+
+static psa_key_id_t private_key;
+static struct k_work_q precompute_q;
+
+K_THREAD_STACK_DEFINE(precompute_stack, SESSION_STACK_SIZE);
+
+static void *session_setup(void)
+{
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    struct pouch_cert cert = {
+        .buffer = root_cert,
+        .size = sizeof(root_cert),
+    };
+
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_lifetime(&key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&key_attributes, 384);
+
+    zassert_equal(psa_generate_key(&key_attributes, &private_key), PSA_SUCCESS);
+    zassert_ok(cert_server_set(&cert));
+
+    k_work_queue_init(&precompute_q);
+    k_work_queue_start(&precompute_q,
+                       precompute_stack,
+                       K_THREAD_STACK_SIZEOF(precompute_stack),
+                       K_PRIO_PREEMPT(1),
+                       NULL);
+
+    return NULL;
+}
+
+static void session_teardown(void *fixture)
+{
+    (void) psa_destroy_key(private_key);
+}
+
+static void session_after(void *fixture)
+{
+    saead_uplink_session_end();
+    k_work_queue_drain(&precompute_q, false);
+}
+
+ZTEST_SUITE(bench_session, NULL, session_setup, NULL, session_after, session_teardown);
+
+/* Starting a session when the device connects, with the ECDH key agreement in the connection path */
+ZTEST(bench_session, test_start_cold)
+{
+    struct bench_timer timer;
+
+    saead_uplink_init(NULL, PSA_ALG_CHACHA20_POLY1305, private_key);
+
+    // Use up any session that was precomputed earlier:
+    zassert_ok(saead_uplink_session_start(PSA_ALG_CHACHA20_POLY1305, private_key));
+    saead_uplink_session_end();
+
+    bench_start(&timer);
+
+    for (int i = 0; i < SESSION_ITERATIONS; i++)
+    {
+        zassert_ok(saead_uplink_session_start(PSA_ALG_CHACHA20_POLY1305, private_key));
+        saead_uplink_session_end();
+    }
+
+    bench_report(&timer, "session_start", "cold", 0, SESSION_ITERATIONS);
+}
+
+/* Starting a session when the device connects, with the session derived ahead of time */
+ZTEST(bench_session, test_start_precomputed)
+{
+    struct bench_timer timer;
+
+    if (!IS_ENABLED(CONFIG_POUCH_SESSION_PRECOMPUTE))
+    {
+        ztest_test_skip();
+    }
+
+    saead_uplink_init(&precompute_q, PSA_ALG_CHACHA20_POLY1305, private_key);
+
+    bench_start(&timer);
+
+    for (int i = 0; i < SESSION_ITERATIONS; i++)
+    {
+        // The next session is derived in the background between connections:
+        bench_pause(&timer);
+        k_work_queue_drain(&precompute_q, false);
+        bench_resume(&timer);
+
+        zassert_ok(saead_uplink_session_start(PSA_ALG_CHACHA20_POLY1305, private_key));
+        saead_uplink_session_end();
+    }
+
+    bench_report(&timer, "session_start", "precomputed", 0, SESSION_ITERATIONS);
+}
@@ -11,7 +11,7 @@
 
 struct block
 {
-    uint8_t id;
+    uint16_t id;
     bool first;
     bool last;
     size_t data_len;
@@ -22,12 +22,20 @@ struct block
 static inline void pull_block(uint8_t **buf, struct block *block)
 {
     uint8_t *data = *buf;
+    size_t header_len = 3;
     block->data_len = sys_get_be16(&data[0]) - 1;
     block->id = data[2] & 0x1f;
     block->first = !!(data[2] & 0x40);
     block->last = !!(data[2] & 0x80);
-    block->data = &data[3];
-    *buf = &data[3 + block->data_len];
+    if (data[2] & 0x20)
+    {
+        // extended stream ID:
+        block->id |= data[3] << 5;
+        block->data_len--;
+        header_len++;
+    }
+    block->data = &data[header_len];
+    *buf = &data[header_len + block->data_len];
 }
 
 struct stream_block
@@ -139,6 +139,8 @@ def main(
         device_name: Annotated[str, typer.Option()] = "id123",
         length: Annotated[int, typer.Option(min=0)] = len(LOREM_IPSUM),
         count: Annotated[int, typer.Option()] = 1,
+        interleave: Annotated[bool, typer.Option(help="Send all entries as streams, "
+                                                 "interleaving their blocks")] = False,
 ):
     obj = {
         "device_id": device_name,
@@ -160,7 +162,20 @@ def main(
 
     block_buf = bytearray()
 
-    for entry in obj["entries"]:
+    if interleave:
+        streams = []
+        for entry in obj["entries"]:
+            streams.append((stream_id, list(entry_stream_chunks(entry_pack(entry, True)))))
+            stream_id += 1
+
+        # Round robin between the streams, one block at a time:
+        while any(chunks for _, chunks in streams):
+            for sid, chunks in streams:
+                if chunks:
+                    chunk, flags = chunks.pop(0)
+                    payload_append(payload, chunk, sid, flags)
+
+    for entry in ([] if interleave else obj["entries"]):
         if len(entry["data"]) > BLOCK_CAPACITY:
             if block_buf:
                 payload_append(payload, block_buf, 0, BLOCK_FIRST | BLOCK_LAST)
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zcbor_stream.h>
+#include <zephyr/ztest.h>
+
+ZTEST_SUITE(cbor_stream, NULL, NULL, NULL, NULL, NULL);
+
+/* {"settings": {"a": 1, "bb": "xyz", "c": true, "d": 1.5}, "version": 1000} */
+static const uint8_t settings_doc[] = {
+    0xa2, 0x68, 's',  'e',  't', 't', 'i',  'n', 'g',  's',  0xa4, 0x61, 'a', 0x01,
+    0x62, 'b',  'b',  0x63, 'x', 'y', 'z',  0x61, 'c', 0xf5, 0x61, 'd',  0xfb, 0x3f,
+    0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x67, 'v', 'e',  'r',  's',  'i',  'o',
+    'n',  0x19, 0x03, 0xe8,
+};
+
+static const char settings_doc_items[] =
+    "map(2)@0 \"settings\"@1 map(4)@1 \"a\"@2 1@2 \"bb\"@2 \"xyz\"@2 \"c\"@2 true@2 \"d\"@2 1.5@2 "
+    "end@1 \"version\"@1 1000@1 end@0 ";
+
+struct item_log
+{
+    char buf[512];
+    size_t len;
+};
+
+/* Log items as text, joining string fragments, so differently chunked input compares equal */
+static int log_item(const struct zcbor_stream_item *item, void *user_data)
+{
+    struct item_log *log = user_data;
+    char *out = &log->buf[log->len];
+    size_t space = sizeof(log->buf) - log->len;
+    int len = 0;
+
+    switch (item->type)
+    {
+        case ZCBOR_STREAM_INT:
+            len = snprintf(out, space, "%lld", (long long) item->i64);
+            break;
+        case ZCBOR_STREAM_TSTR:
+            len = snprintf(out,
+                           space,
+                           "%s%.*s%s",
+                           item->str.offset == 0 ? "\"" : "",
+                           (int) item->str.value.len,
+                           (const char *) item->str.value.value,
+                           zcbor_stream_str_is_complete(item) ? "\"" : "");
+            break;
+        case ZCBOR_STREAM_MAP_START:
+        case ZCBOR_STREAM_LIST_START:
+            len = snprintf(out,
+                           space,
+                           item->count == SIZE_MAX ? "%s(_)" : "%s(%zu)",
+                           item->type == ZCBOR_STREAM_MAP_START ? "map" : "list",
+                           item->count);
+            break;
+        case ZCBOR_STREAM_CONTAINER_END:
+            len = snprintf(out, space, "end");
+            break;
+        case ZCBOR_STREAM_BOOL:
+            len = snprintf(out, space, "%s", item->boolean ? "true" : "false");
+            break;
+        case ZCBOR_STREAM_FLOAT:
+            len = snprintf(out, space, "%.1f", item->f64);
+            break;
+        case ZCBOR_STREAM_NIL:
+            len = snprintf(out, space, "nil");
+            break;
+        default:
+            len = snprintf(out, space, "?");
+            break;
+    }
+
+    if (item->type != ZCBOR_STREAM_TSTR || zcbor_stream_str_is_complete(item))
+    {
+        len += snprintf(out + len, space - len, "@%zu ", item->depth);
+    }
+
+    log->len += len;
+
+    return 0;
+}
+
+static void decode_chunked(const uint8_t *data,
+                           size_t len,
+                           size_t chunk_len,
+                           struct item_log *log)
+{
+    struct zcbor_stream stream;
+
+    memset(log, 0, sizeof(*log));
+    zcbor_stream_init(&stream, log_item, log);
+
+    while (len > 0)
+    {
+        size_t n = MIN(len, chunk_len);
+
+        zassert_ok(zcbor_stream_feed(&stream, data, n));
+
+        data += n;
+        len -= n;
+    }
+
+    zassert_ok(zcbor_stream_finish(&stream));
+}
+
+ZTEST(cbor_stream, test_chunked)
+{
+    struct item_log log;
+
+    for (size_t chunk_len = 1; chunk_len <= sizeof(settings_doc); chunk_len++)
+    {
+        decode_chunked(settings_doc, sizeof(settings_doc), chunk_len, &log);
+        zassert_str_equal(log.buf, settings_doc_items, "chunk_len %zu: %s", chunk_len, log.buf);
+    }
+}
+
+ZTEST(cbor_stream, test_indefinite)
+{
+    /* [_ 1, [], {}, -5, nil] */
+    static const uint8_t doc[] = {0x9f, 0x01, 0x80, 0xa0, 0x24, 0xf6, 0xff};
+    struct item_log log;
+
+    decode_chunked(doc, sizeof(doc), 1, &log);
+    zassert_str_equal(log.buf,
+                      "list(_)@0 1@1 list(0)@1 end@1 map(0)@1 end@1 -5@1 nil@1 end@0 ",
+                      "%s",
+                      log.buf);
+}
+
+ZTEST(cbor_stream, test_invalid)
+{
+    struct zcbor_stream stream;
+    struct item_log log = {};
+
+    /* Truncated list */
+    zcbor_stream_init(&stream, log_item, &log);
+    zassert_ok(zcbor_stream_feed(&stream, (uint8_t[]) {0x82, 0x01}, 2));
+    zassert_equal(zcbor_stream_finish(&stream), -EBADMSG);
+
+    /* Trailing data */
+    zcbor_stream_init(&stream, log_item, &log);
+    zassert_equal(zcbor_stream_feed(&stream, (uint8_t[]) {0x01, 0x02}, 2), -EBADMSG);
+
+    /* Break outside indefinite container */
+    zcbor_stream_init(&stream, log_item, &log);
+    zassert_equal(zcbor_stream_feed(&stream, (uint8_t[]) {0x81, 0xff}, 2), -EBADMSG);
+
+    /* Indefinite length string */
+    zcbor_stream_init(&stream, log_item, &log);
+    zassert_equal(zcbor_stream_feed(&stream, (uint8_t[]) {0x7f, 0x60, 0xff}, 3), -ENOTSUP);
+}
@@ -4,6 +4,7 @@
 
 #include <pouch/transport/downlink.h>
 #include <pouch/downlink.h>
+#include <pouch/events.h>
 #include <pouch/pouch.h>
 #include <zephyr/ztest.h>
 
@@ -26,18 +27,41 @@ struct pouch_test_item
     size_t num_entries;
 };
 
+#define TEST_STREAM_ID_MAX 31
+
 struct downlink_api_context
 {
-    const uint8_t *data;
-    size_t len;
-    size_t offset;
-    size_t payload_len;
+    const struct pouch_test_item *item;
+    /* Number of entries started and completed */
+    size_t started;
+    size_t completed;
 
-    const struct pouch_test_item_entry *entry;
+    /* Entries may be interleaved, so track each stream separately */
+    struct
+    {
+        const struct pouch_test_item_entry *entry;
+        size_t offset;
+    } streams[TEST_STREAM_ID_MAX + 1];
 };
 
 static struct downlink_api_context downlink_api;
 
+/** Blocks the consumer while set, to simulate a slow application */
+static bool consumer_hold;
+K_SEM_DEFINE(consumer_gate, 0, 1);
+
+K_SEM_DEFINE(window_open, 0, 1);
+
+static void window_event_handler(enum pouch_event event, void *ctx)
+{
+    if (event == POUCH_EVENT_DOWNLINK_WINDOW_OPEN)
+    {
+        k_sem_give(&window_open);
+    }
+}
+
+POUCH_EVENT_HANDLER(window_event_handler, NULL);
+
 static const struct pouch_config pouch_config = {
     .device_id = CONFIG_POUCH_DEVICE_NAME,
 };
@@ -58,9 +82,12 @@ static void downlink_start(unsigned int stream_id, const char *path, uint16_t co
 
     zassert_str_equal(path, "/.s/lorem", "invalid path");
     zassert_equal(content_type, POUCH_CONTENT_TYPE_JSON, "invalid content_type");
+    zassert_true(stream_id <= TEST_STREAM_ID_MAX, "invalid stream_id %u", stream_id);
+    zassert_true(downlink_api.started < downlink_api.item->num_entries, "too many entries");
 
     /* Initialize offset for received data */
-    downlink_api.offset = 0;
+    downlink_api.streams[stream_id].entry = &downlink_api.item->entries[downlink_api.started++];
+    downlink_api.streams[stream_id].offset = 0;
 }
 
 static void downlink_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
@@ -70,52 +97,143 @@ static void downlink_data(unsigned int stream_id, const void *data, size_t len,
     LOG_DBG("Entry is_last: %d", (int) is_last);
     LOG_HEXDUMP_DBG(data, len, "Entry data");
 
-    zassert_mem_equal(data,
-                      &downlink_api.entry->data[downlink_api.offset],
-                      len,
-                      "content is not as expected");
+    if (consumer_hold)
+    {
+        k_sem_take(&consumer_gate, K_FOREVER);
+    }
+
+    zassert_true(stream_id <= TEST_STREAM_ID_MAX, "invalid stream_id %u", stream_id);
 
-    downlink_api.offset += len;
+    const struct pouch_test_item_entry *entry = downlink_api.streams[stream_id].entry;
+    size_t *offset = &downlink_api.streams[stream_id].offset;
 
-    zassert_equal(is_last,
-                  (downlink_api.offset >= downlink_api.entry->data_len),
-                  "is_last is not as expected");
+    zassert_not_null(entry, "data without start on stream %u", stream_id);
+    zassert_mem_equal(data, &entry->data[*offset], len, "content is not as expected");
+
+    *offset += len;
+
+    zassert_equal(is_last, (*offset >= entry->data_len), "is_last is not as expected");
 
     if (is_last)
     {
-        downlink_api.entry++;
-
         /* Check if all data was received */
-        zassert_equal(downlink_api.offset,
-                      downlink_api.payload_len,
+        zassert_equal(*offset,
+                      entry->data_len,
                       "received offset does not match (%d %d)",
-                      downlink_api.offset,
-                      downlink_api.payload_len);
+                      *offset,
+                      entry->data_len);
+
+        downlink_api.streams[stream_id].entry = NULL;
+        downlink_api.completed++;
     }
 }
 
 POUCH_DOWNLINK_HANDLER(downlink_start, downlink_data);
 
+/** Number of completed entries per path handler */
+static int routed_lorem;
+static int routed_wildcard;
+static int routed_other;
+
+/** Makes the lorem handler hold on to its data until it's acknowledged */
+static bool lorem_async;
+static unsigned int lorem_pending_stream;
+K_SEM_DEFINE(lorem_pending, 0, 1);
+
+static void lorem_start(unsigned int stream_id, const char *path, uint16_t content_type)
+{
+    zassert_str_equal(path, "/.s/lorem", "invalid path");
+}
+
+static int lorem_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+{
+    if (is_last)
+    {
+        routed_lorem++;
+    }
+
+    if (lorem_async)
+    {
+        lorem_pending_stream = stream_id;
+        k_sem_give(&lorem_pending);
+        return -EINPROGRESS;
+    }
+
+    return 0;
+}
+
+static void wildcard_start(unsigned int stream_id, const char *path, uint16_t content_type) {}
+
+static void wildcard_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+{
+    if (is_last)
+    {
+        routed_wildcard++;
+    }
+}
+
+static void other_start(unsigned int stream_id, const char *path, uint16_t content_type) {}
+
+static void other_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+{
+    if (is_last)
+    {
+        routed_other++;
+    }
+}
+
+/* The exact path wins over the wildcard, and neither of the others see the lorem entries */
+POUCH_DOWNLINK_PATH_HANDLER(other_prefix, "/.s/lorem/*", other_start, other_data);
+POUCH_DOWNLINK_PATH_HANDLER_ASYNC(lorem, "/.s/lorem", lorem_start, lorem_data);
+POUCH_DOWNLINK_PATH_HANDLER(wildcard, "/.s/*", wildcard_start, wildcard_data);
+POUCH_DOWNLINK_PATH_HANDLER(other, "/.s/lorem2", other_start, other_data);
+
 static void pouch_downlink_push_all(const uint8_t *data, size_t len, size_t mtu)
 {
     while (len)
     {
         size_t fragment_len = MIN(len, mtu);
 
-        pouch_downlink_push(data, fragment_len);
+        int err = pouch_downlink_push(data, fragment_len);
+        if (err == -EAGAIN)
+        {
+            // let the consumer catch up:
+            k_sleep(K_MSEC(1));
+            continue;
+        }
+
+        zassert_ok(err, "push failed: %d", err);
 
         data += fragment_len;
         len -= fragment_len;
     }
 }
 
-static void test_lorem(const struct pouch_test_item *test_item)
+static void test_lorem_init(const struct pouch_test_item *test_item)
+{
+    memset(&downlink_api, 0, sizeof(downlink_api));
+    downlink_api.item = test_item;
+
+    routed_lorem = 0;
+    routed_wildcard = 0;
+    routed_other = 0;
+    lorem_async = false;
+}
+
+static void test_lorem_check(const struct pouch_test_item *test_item)
 {
-    downlink_api.entry = &test_item->entries[0];
+    zassert_equal(downlink_api.completed,
+                  test_item->num_entries,
+                  "Number of last_count does not match number of messages within pouch");
 
-    downlink_api.data = test_item->data;
-    downlink_api.len = test_item->data_len;
-    downlink_api.payload_len = test_item->entries[0].data_len;
+    zassert_equal(routed_lorem, test_item->num_entries);
+    zassert_equal(routed_wildcard, 0);
+    zassert_equal(routed_other, 0);
+}
+
+static void test_lorem(const struct pouch_test_item *test_item)
+{
+    test_lorem_init(test_item);
 
     pouch_downlink_start();
     pouch_downlink_push_all(test_item->data, test_item->data_len, CONFIG_POUCH_TRANSPORT_MTU);
@@ -124,9 +242,7 @@ static void test_lorem(const struct pouch_test_item *test_item)
     /* Let all downlink messages be processed */
     k_sleep(K_MSEC(100));
 
-    zassert_equal_ptr(downlink_api.entry,
-                      &test_item->entries[test_item->num_entries],
-                      "Number of last_count does not match number of messages within pouch");
+    test_lorem_check(test_item);
 }
 
 #include "lorem-10-x1.c"
@@ -191,3 +307,160 @@ ZTEST(downlink, test_lorem_09_1024_x5)
 {
     test_lorem(&lorem_1024_x5);
 }
+
+ZTEST(downlink, test_lorem_10_backpressure)
+{
+    const struct pouch_test_item *test_item = &lorem_102400_x1;
+    const uint8_t *data = test_item->data;
+    size_t len = test_item->data_len;
+
+    test_lorem_init(test_item);
+
+    consumer_hold = true;
+    k_sem_reset(&consumer_gate);
+    k_sem_reset(&window_open);
+
+    pouch_downlink_start();
+
+    // push until the window is full:
+    int err;
+    while (len)
+    {
+        size_t fragment_len = MIN(len, CONFIG_POUCH_TRANSPORT_MTU);
+
+        err = pouch_downlink_push(data, fragment_len);
+        if (err)
+        {
+            break;
+        }
+
+        data += fragment_len;
+        len -= fragment_len;
+
+        // let the decryption run, the consumer is held back:
+        k_sleep(K_MSEC(1));
+    }
+
+    zassert_equal(err, -EAGAIN, "Expected backpressure, got %d", err);
+    zassert_true(len > 0, "All data accepted");
+    zassert_true(pouch_downlink_window_get() < MIN(len, CONFIG_POUCH_TRANSPORT_MTU));
+    zassert_false(pouch_downlink_window_check(MIN(len, CONFIG_POUCH_TRANSPORT_MTU)));
+    zassert_equal(k_sem_take(&window_open, K_NO_WAIT), -EBUSY, "Window opened while held");
+
+    // release the consumer, and push the rest once the window opens up:
+    consumer_hold = false;
+    k_sem_give(&consumer_gate);
+
+    zassert_ok(k_sem_take(&window_open, K_MSEC(100)), "No window open event");
+    zassert_true(pouch_downlink_window_get() > 0);
+
+    pouch_downlink_push_all(data, len, CONFIG_POUCH_TRANSPORT_MTU);
+    pouch_downlink_finish();
+
+    /* Let all downlink messages be processed */
+    k_sleep(K_MSEC(100));
+
+    test_lorem_check(test_item);
+}
+
+#include "lorem-10-x3-interleaved.c"
+
+ZTEST(downlink, test_lorem_11_10_x3_interleaved)
+{
+    test_lorem(&lorem_10_x3_interleaved);
+}
+
+#include "lorem-2048-x3-interleaved.c"
+
+ZTEST(downlink, test_lorem_12_2048_x3_interleaved)
+{
+    test_lorem(&lorem_2048_x3_interleaved);
+}
+
+ZTEST(downlink, test_lorem_13_async)
+{
+    const struct pouch_test_item *test_item = &lorem_10_x5;
+
+    test_lorem_init(test_item);
+
+    lorem_async = true;
+    k_sem_reset(&lorem_pending);
+
+    zassert_equal(pouch_downlink_ack(0), -EINVAL, "Nothing to acknowledge");
+
+    pouch_downlink_start();
+    pouch_downlink_push_all(test_item->data, test_item->data_len, CONFIG_POUCH_TRANSPORT_MTU);
+    pouch_downlink_finish();
+
+    /* All entries are in the same block, and each one pauses the downlink */
+    for (size_t i = 0; i < test_item->num_entries; i++)
+    {
+        zassert_ok(k_sem_take(&lorem_pending, K_MSEC(100)), "Entry %zu not received", i);
+
+        k_sleep(K_MSEC(10));
+        zassert_equal(routed_lorem, i + 1, "Downlink not paused");
+        zassert_equal(downlink_api.completed, i + 1, "Downlink not paused");
+
+        zassert_equal(pouch_downlink_ack(lorem_pending_stream + 1), -EINVAL);
+        zassert_ok(pouch_downlink_ack(lorem_pending_stream));
+        zassert_equal(pouch_downlink_ack(lorem_pending_stream), -EINVAL, "Acknowledged twice");
+    }
+
+    lorem_async = false;
+
+    /* Let all downlink messages be processed */
+    k_sleep(K_MSEC(100));
+
+    test_lorem_check(test_item);
+}
+
+ZTEST(downlink, test_lorem_14_async_backpressure)
+{
+    const struct pouch_test_item *test_item = &lorem_102400_x1;
+    const uint8_t *data = test_item->data;
+    size_t len = test_item->data_len;
+
+    test_lorem_init(test_item);
+
+    lorem_async = true;
+    k_sem_reset(&lorem_pending);
+
+    pouch_downlink_start();
+
+    // push until the window is full:
+    int err;
+    while (len)
+    {
+        size_t fragment_len = MIN(len, CONFIG_POUCH_TRANSPORT_MTU);
+
+        err = pouch_downlink_push(data, fragment_len);
+        if (err)
+        {
+            break;
+        }
+
+        data += fragment_len;
+        len -= fragment_len;
+
+        k_sleep(K_MSEC(1));
+    }
+
+    zassert_equal(err, -EAGAIN, "Expected backpressure, got %d", err);
+    zassert_true(len > 0, "All data accepted");
+
+    /* The first block is held by the handler, which keeps the window closed */
+    zassert_ok(k_sem_take(&lorem_pending, K_NO_WAIT));
+    zassert_equal(routed_lorem, 0);
+
+    // acknowledge, and push the rest:
+    lorem_async = false;
+    zassert_ok(pouch_downlink_ack(lorem_pending_stream));
+
+    pouch_downlink_push_all(data, len, CONFIG_POUCH_TRANSPORT_MTU);
+    pouch_downlink_finish();
+
+    /* Let all downlink messages be processed */
+    k_sleep(K_MSEC(100));
+
+    test_lorem_check(test_item);
+}
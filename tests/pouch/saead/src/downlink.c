@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <psa/crypto.h>
+#include <zephyr/ztest.h>
+
+#include "buf.h"
+#include "crypto.h"
+#include "cddl/header_decode.h"
+#include "server.h"
+
+static void *downlink_setup(void)
+{
+    server_init();
+
+    return NULL;
+}
+
+ZTEST_SUITE(saead_downlink, NULL, downlink_setup, NULL, NULL, NULL);
+
+/* Later pouches in a server session have the same sequence number as the first, and refer to the
+ * session key in the key cache.
+ */
+ZTEST(saead_downlink, test_key_cache_hit)
+{
+    struct session_id id;
+
+    server_session_id_create(&id, SESSION_ID_TYPE_SEQUENTIAL);
+    psa_key_id_t key = server_session_key_get(&id);
+
+    zassert_ok(server_send(&id, key, 1, false));
+    zassert_ok(server_send(&id, key, 2, false), "Same sequence number rejected");
+
+    if (CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE > 0)
+    {
+        zassert_ok(server_send(&id, key, 3, true), "Session reference rejected");
+    }
+    else
+    {
+        zassert_equal(server_send(&id, key, 3, true), -ENOENT);
+    }
+
+    (void) psa_destroy_key(key);
+}
+
+/* The least recently used key is evicted, and destroyed, when a new server session starts */
+ZTEST(saead_downlink, test_key_cache_eviction)
+{
+    struct session_id ids[CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE + 1];
+    psa_key_id_t keys[ARRAY_SIZE(ids)];
+    size_t slots;
+
+    if (CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE < 2)
+    {
+        ztest_test_skip();
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(ids); i++)
+    {
+        server_session_id_create(&ids[i], SESSION_ID_TYPE_RANDOM);
+        keys[i] = server_session_key_get(&ids[i]);
+    }
+
+    // Fill the cache:
+    for (size_t i = 0; i < ARRAY_SIZE(ids) - 1; i++)
+    {
+        zassert_ok(server_send(&ids[i], keys[i], 1, false));
+    }
+
+    // Use the first session again, so the second session becomes the least recently used:
+    zassert_ok(server_send(&ids[0], keys[0], 2, true));
+
+    slots = server_key_slots_get();
+
+    // A new session evicts the second session:
+    zassert_ok(server_send(&ids[ARRAY_SIZE(ids) - 1], keys[ARRAY_SIZE(ids) - 1], 1, false));
+    zassert_equal(server_key_slots_get(), slots, "Evicted key wasn't destroyed");
+
+    zassert_ok(server_send(&ids[0], keys[0], 3, true));
+    zassert_equal(server_send(&ids[1], keys[1], 2, true), -ENOENT);
+
+    for (size_t i = 0; i < ARRAY_SIZE(ids); i++)
+    {
+        (void) psa_destroy_key(keys[i]);
+    }
+}
+
+ZTEST(saead_downlink, test_replay)
+{
+    struct session_id id;
+    struct session_id replay;
+    struct session_id old;
+
+    server_session_id_create(&old, SESSION_ID_TYPE_SEQUENTIAL);
+    server_session_id_create(&id, SESSION_ID_TYPE_SEQUENTIAL);
+
+    psa_key_id_t key = server_session_key_get(&id);
+    psa_key_id_t old_key = server_session_key_get(&old);
+
+    zassert_ok(server_send(&id, key, 5, false));
+
+    // Pouch IDs must increase within the session:
+    zassert_equal(server_send(&id, key, 5, false), -EBADMSG);
+    zassert_equal(server_send(&id, key, 4, false), -EBADMSG);
+    zassert_ok(server_send(&id, key, 6, false));
+
+    // A different session can't reuse the sequence number:
+    replay = id;
+    replay.value.sequential.tag[0] ^= 0xff;
+    psa_key_id_t replay_key = server_session_key_get(&replay);
+    zassert_equal(server_send(&replay, replay_key, 1, false), -EBADMSG);
+
+    // Nor go back to an older one:
+    zassert_equal(server_send(&old, old_key, 1, false), -EBADMSG);
+
+    (void) psa_destroy_key(key);
+    (void) psa_destroy_key(old_key);
+    (void) psa_destroy_key(replay_key);
+}
+
+/* Blocks that fail authentication are dropped */
+ZTEST(saead_downlink, test_tampered_block)
+{
+    struct server_pouch pouch;
+    struct session_id id;
+
+    server_session_id_create(&id, SESSION_ID_TYPE_RANDOM);
+    psa_key_id_t key = server_session_key_get(&id);
+
+    server_pouch_start(&pouch, &id, key, 1, 1, false);
+    server_pouch_entry_add(&pouch, "/test", "tampered", 8);
+    pouch.data[pouch.len - 1] ^= 0x01;
+
+    zassert_equal(server_pouch_send(&pouch), -ETIMEDOUT, "Tampered block delivered");
+
+    (void) psa_destroy_key(key);
+}
+
+/* Blocks are decrypted in the buffer they arrived in */
+ZTEST(saead_downlink, test_decrypt_in_place)
+{
+    static const uint8_t data[] = "decrypted in place";
+    struct server_pouch pouch;
+    struct pouch_header header;
+    struct session_id id;
+    size_t header_len;
+
+    server_session_id_create(&id, SESSION_ID_TYPE_RANDOM);
+    psa_key_id_t key = server_session_key_get(&id);
+
+    server_pouch_start(&pouch, &id, key, 1, 1, false);
+    header_len = pouch.len;
+    server_pouch_entry_add(&pouch, "/test", data, sizeof(data));
+
+    size_t decoded_len;
+    zassert_ok(cbor_decode_pouch_header(pouch.data, header_len, &header, &decoded_len));
+    zassert_equal(decoded_len, header_len);
+    zassert_ok(crypto_downlink_start(&header.encryption_info_m));
+
+    size_t ciphertext_len = pouch.len - header_len;
+    struct pouch_buf *block = buf_alloc(ciphertext_len);
+    zassert_not_null(block);
+    buf_write(block, &pouch.data[header_len], ciphertext_len);
+
+    struct pouch_buf *plaintext = crypto_decrypt_block(block);
+    zassert_equal_ptr(plaintext, block, "Block wasn't decrypted in place");
+
+    // The size field covers the plaintext, and the auth tag is trimmed off:
+    size_t plaintext_len = ciphertext_len - sizeof(uint16_t) - AUTH_TAG_LEN;
+    zassert_equal(buf_size_get(plaintext), sizeof(uint16_t) + plaintext_len);
+
+    struct pouch_bufview v;
+    pouch_bufview_init(&v, plaintext);
+    zassert_equal(pouch_bufview_read_be16(&v), plaintext_len);
+
+    const uint8_t *payload = pouch_bufview_read(&v, plaintext_len);
+    zassert_mem_equal(&payload[plaintext_len - sizeof(data)], data, sizeof(data));
+
+    buf_free(plaintext);
+    (void) psa_destroy_key(key);
+}
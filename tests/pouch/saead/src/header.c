@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <psa/crypto.h>
+#include <zephyr/ztest.h>
+
+#include "buf.h"
+#include "crypto.h"
+#include "header.h"
+#include "cddl/header_encode.h"
+#include "server.h"
+
+#define HEADER_VERSION (IS_ENABLED(CONFIG_POUCH_HEADER_COMPACT) ? 2 : 1)
+
+/* Pouch IDs around the boundaries of the CBOR integer encodings */
+static const pouch_id_t pouch_ids[] = {0, 23, 24, 255, 256, 65535};
+
+static void *header_setup(void)
+{
+    server_init();
+
+    return NULL;
+}
+
+static void header_after(void *fixture)
+{
+    crypto_session_end();
+}
+
+ZTEST_SUITE(saead_header, NULL, header_setup, NULL, header_after, NULL);
+
+/** Check the header against a header encoded from scratch for the current pouch */
+static void header_check(struct pouch_buf *header, bool ref)
+{
+    struct pouch_header expected = {
+        .version = HEADER_VERSION,
+    };
+    uint8_t encoded[64];
+    size_t encoded_len;
+
+    zassert_not_null(header);
+
+    if (ref)
+    {
+        zassert_ok(crypto_header_ref_get(&expected.encryption_info_m));
+    }
+    else
+    {
+        zassert_ok(crypto_header_get(&expected.encryption_info_m));
+    }
+
+    zassert_ok(cbor_encode_pouch_header(encoded, sizeof(encoded), &expected, &encoded_len));
+
+    struct pouch_bufview v;
+    pouch_bufview_init(&v, header);
+
+    zassert_equal(pouch_bufview_available(&v),
+                  encoded_len,
+                  "Pouch %u: wrong header length",
+                  crypto_pouch_id_get());
+    zassert_mem_equal(pouch_bufview_read(&v, encoded_len),
+                      encoded,
+                      encoded_len,
+                      "Pouch %u: wrong header",
+                      crypto_pouch_id_get());
+
+    buf_free(header);
+}
+
+/* Later pouches patch the pouch ID into the cached header of the first pouch */
+ZTEST(saead_header, test_cached_header)
+{
+    zassert_ok(crypto_session_start());
+
+    // The first pouch always carries the full session info:
+    header_check(pouch_header_create(), false);
+
+    for (size_t i = 0; i < ARRAY_SIZE(pouch_ids); i++)
+    {
+        while (crypto_pouch_id_get() < pouch_ids[i])
+        {
+            zassert_ok(crypto_pouch_start());
+        }
+
+        struct pouch_buf *header = pouch_header_next_alloc();
+        zassert_not_null(header);
+        pouch_header_next_write(header);
+
+        header_check(header, IS_ENABLED(CONFIG_POUCH_HEADER_COMPACT));
+    }
+}
+
+/* Session references are only valid in version 2 headers */
+ZTEST(saead_header, test_downlink_ref_header)
+{
+    struct server_pouch pouch;
+    struct session_id id;
+
+    if (CONFIG_POUCH_DOWNLINK_KEY_CACHE_SIZE == 0)
+    {
+        ztest_test_skip();
+    }
+
+    server_session_id_create(&id, SESSION_ID_TYPE_RANDOM);
+    psa_key_id_t key = server_session_key_get(&id);
+
+    // The first pouch introduces the session:
+    zassert_ok(server_send(&id, key, 1, false));
+
+    server_pouch_start(&pouch, &id, key, 2, 1, true);
+    server_pouch_entry_add(&pouch, "/test", "v1", 2);
+    zassert_equal(server_pouch_send(&pouch), -EINVAL);
+
+    server_pouch_start(&pouch, &id, key, 2, 2, true);
+    server_pouch_entry_add(&pouch, "/test", "v2", 2);
+    zassert_ok(server_pouch_send(&pouch));
+
+    (void) psa_destroy_key(key);
+}
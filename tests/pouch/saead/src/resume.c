@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <string.h>
+
+#include <psa/crypto.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/ztest.h>
+
+#include "crypto.h"
+#include "server.h"
+
+struct stored_seqnum
+{
+    const char *key;
+    uint64_t seqnum;
+    bool found;
+};
+
+static int stored_seqnum_load(const char *key,
+                              size_t len,
+                              settings_read_cb read_cb,
+                              void *cb_arg,
+                              void *param)
+{
+    struct stored_seqnum *stored = param;
+
+    if (strcmp(key, stored->key) != 0 || len != sizeof(stored->seqnum))
+    {
+        return 0;
+    }
+
+    if (read_cb(cb_arg, &stored->seqnum, sizeof(stored->seqnum)) == sizeof(stored->seqnum))
+    {
+        stored->found = true;
+    }
+
+    return 0;
+}
+
+/** Read a sequence number back from the settings storage, instead of the device's RAM copy */
+static uint64_t stored_seqnum_get(const char *key)
+{
+    struct stored_seqnum stored = {
+        .key = key,
+    };
+
+    zassert_ok(settings_load_subtree_direct("pouch/seq", stored_seqnum_load, &stored));
+    zassert_true(stored.found, "No stored %s sequence number", key);
+
+    return stored.seqnum;
+}
+
+static uint64_t uplink_session_start(void)
+{
+    struct encryption_info info;
+
+    zassert_ok(crypto_session_start());
+    zassert_ok(crypto_header_get(&info));
+    zassert_equal(info.saead_info_m.session.id_choice, session_info_id_session_id_sequential_m_c);
+
+    return info.saead_info_m.session.session_id_sequential_m.seq;
+}
+
+static void *resume_setup(void)
+{
+    server_init();
+
+    return NULL;
+}
+
+ZTEST_SUITE(saead_resume, NULL, resume_setup, NULL, NULL, NULL);
+
+ZTEST(saead_resume, test_uplink_resume)
+{
+    uint64_t seqnum = uplink_session_start();
+
+    // The sequence number is stored before the session is used:
+    zassert_equal(stored_seqnum_get("dev"), seqnum);
+
+    while (crypto_pouch_id_get() < CONFIG_POUCH_SESSION_RESUME_MAX_POUCHES - 1)
+    {
+        zassert_ok(crypto_pouch_start());
+    }
+
+    crypto_session_end();
+
+    // The next connection picks up where the session left off:
+    zassert_equal(uplink_session_start(), seqnum, "Session wasn't resumed");
+    zassert_equal(crypto_pouch_id_get(), CONFIG_POUCH_SESSION_RESUME_MAX_POUCHES - 1);
+    zassert_ok(crypto_pouch_start());
+
+    // The session has run out of pouches:
+    zassert_equal(crypto_pouch_start(), -ENOSPC);
+    crypto_session_end();
+
+    uint64_t next = uplink_session_start();
+    zassert_true(next > seqnum, "Sequence number reused");
+    zassert_equal(stored_seqnum_get("dev"), next);
+    zassert_equal(crypto_pouch_id_get(), 0);
+    crypto_session_end();
+}
+
+ZTEST(saead_resume, test_server_seqnum)
+{
+    struct session_id id;
+
+    server_session_id_create(&id, SESSION_ID_TYPE_SEQUENTIAL);
+    psa_key_id_t key = server_session_key_get(&id);
+
+    zassert_ok(server_send(&id, key, 1, false));
+    zassert_equal(stored_seqnum_get("srv"), id.value.sequential.seqnum);
+
+    (void) psa_destroy_key(key);
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <psa/crypto.h>
+#include <pouch/downlink.h>
+#include <pouch/pouch.h>
+#include <pouch/transport/certificate.h>
+#include <pouch/transport/downlink.h>
+#include <pouch/types.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+#include "block.h"
+#include "cert.h"
+#include "cddl/header_encode.h"
+#include "saead/seqnum.h"
+#include "server.h"
+
+#define NONCE_LEN 12
+#define ENTRY_TIMEOUT K_MSEC(500)
+
+/* Private key of credentials/server.der. The device doesn't validate the server certificate in
+ * these tests, so the server certificate also stands in for the device certificate, which is only
+ * hashed.
+ */
+static const uint8_t server_private_key[] = {
+    0xff, 0xe2, 0x05, 0x90, 0x27, 0xc8, 0x59, 0xc3, 0x97, 0x3c, 0x38, 0xf5, 0x3c, 0x6d, 0x90, 0xc9,
+    0x63, 0x62, 0x16, 0x02, 0x06, 0x4a, 0x48, 0xd8, 0x4a, 0x88, 0x93, 0x25, 0xe9, 0x99, 0xc5, 0x72,
+};
+
+static const uint8_t server_cert[] = {
+#include "server_cert.inc"
+};
+
+static struct
+{
+    psa_key_id_t private_key;
+    struct pubkey device_pubkey;
+    uint64_t seqnum;
+} server;
+
+static struct
+{
+    char path[32];
+    uint8_t data[64];
+    size_t len;
+} received;
+
+K_SEM_DEFINE(entry_received, 0, 1);
+
+static void entry_start(unsigned int stream_id, const char *path, uint16_t content_type)
+{
+    strncpy(received.path, path, sizeof(received.path) - 1);
+    received.len = 0;
+}
+
+static void entry_data(unsigned int stream_id, const void *data, size_t len, bool is_last)
+{
+    memcpy(&received.data[received.len], data, MIN(len, sizeof(received.data) - received.len));
+    received.len += len;
+
+    if (is_last)
+    {
+        k_sem_give(&entry_received);
+    }
+}
+
+POUCH_DOWNLINK_HANDLER(entry_start, entry_data);
+
+static psa_key_id_t ecdh_key_import(const uint8_t *data, size_t len)
+{
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_key_id_t key;
+
+    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_lifetime(&key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&key_attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&key_attributes, 256);
+
+    if (data)
+    {
+        zassert_equal(psa_import_key(&key_attributes, data, len, &key), PSA_SUCCESS);
+    }
+    else
+    {
+        zassert_equal(psa_generate_key(&key_attributes, &key), PSA_SUCCESS);
+    }
+
+    return key;
+}
+
+void server_init(void)
+{
+    static bool initialized;
+    struct pouch_cert cert = {
+        .buffer = server_cert,
+        .size = sizeof(server_cert),
+    };
+    struct pouch_config config = {
+        .certificate = cert,
+    };
+
+    if (initialized)
+    {
+        return;
+    }
+
+    zassert_equal(psa_crypto_init(), PSA_SUCCESS);
+
+#if defined(CONFIG_SETTINGS)
+    zassert_ok(settings_subsys_init());
+    zassert_ok(settings_load());
+#endif
+
+    server.private_key = ecdh_key_import(server_private_key, sizeof(server_private_key));
+
+    config.private_key = ecdh_key_import(NULL, 0);
+    zassert_equal(psa_export_public_key(config.private_key,
+                                        server.device_pubkey.data,
+                                        sizeof(server.device_pubkey.data),
+                                        &server.device_pubkey.len),
+                  PSA_SUCCESS);
+
+    zassert_ok(pouch_init(&config));
+    zassert_ok(pouch_server_certificate_set(&cert));
+
+#if defined(CONFIG_POUCH_SESSION_RESUME)
+    // The device remembers the server sequence number across test runs:
+    (void) seqnum_server_get(&server.seqnum);
+#endif
+
+    initialized = true;
+}
+
+void server_session_id_create(struct session_id *id, enum session_id_type type)
+{
+    id->type = type;
+    id->initiator = POUCH_ROLE_SERVER;
+
+    if (type == SESSION_ID_TYPE_RANDOM)
+    {
+        zassert_equal(psa_generate_random(id->value.random, sizeof(id->value.random)),
+                      PSA_SUCCESS);
+        return;
+    }
+
+    zassert_equal(psa_generate_random(id->value.sequential.tag,
+                                      sizeof(id->value.sequential.tag)),
+                  PSA_SUCCESS);
+    id->value.sequential.seqnum = ++server.seqnum;
+}
+
+psa_key_id_t server_session_key_get(const struct session_id *id)
+{
+    psa_key_id_t key = session_key_generate(id,
+                                            PSA_ALG_CHACHA20_POLY1305,
+                                            MAX_BLOCK_PAYLOAD_SIZE_LOG,
+                                            server.private_key,
+                                            &server.device_pubkey,
+                                            PSA_KEY_USAGE_ENCRYPT | PSA_KEY_USAGE_DECRYPT);
+    zassert_not_equal(key, PSA_KEY_ID_NULL);
+
+    return key;
+}
+
+static void session_info_fill(struct session_info *session, const struct session_id *id)
+{
+    if (id->type == SESSION_ID_TYPE_RANDOM)
+    {
+        session->id_choice = session_info_id_session_id_random_m_c;
+        session->session_id_random_m.value = id->value.random;
+        session->session_id_random_m.len = sizeof(id->value.random);
+    }
+    else
+    {
+        session->id_choice = session_info_id_session_id_sequential_m_c;
+        session->session_id_sequential_m.tag.value = id->value.sequential.tag;
+        session->session_id_sequential_m.tag.len = sizeof(id->value.sequential.tag);
+        session->session_id_sequential_m.seq = id->value.sequential.seqnum;
+    }
+
+    session->initiator_choice = id->initiator == POUCH_ROLE_DEVICE
+        ? session_info_initiator_device_m_c
+        : session_info_initiator_server_m_c;
+    session->algorithm_choice = session_info_algorithm_chacha20_poly1305_m_c;
+    session->max_block_size_log = MAX_BLOCK_PAYLOAD_SIZE_LOG;
+    session->cert_ref.value = cert_ref_get();
+    session->cert_ref.len = CERT_REF_SHORT_LEN;
+}
+
+void server_pouch_start(struct server_pouch *pouch,
+                        const struct session_id *id,
+                        psa_key_id_t key,
+                        pouch_id_t pouch_id,
+                        uint8_t version,
+                        bool ref)
+{
+    struct pouch_header header = {
+        .version = version,
+    };
+
+    if (ref)
+    {
+        header.encryption_info_m.Union_choice = encryption_info_union_saead_ref_info_m_c;
+        header.encryption_info_m.saead_ref_info_m.session_ref.value = session_ref_get(id);
+        header.encryption_info_m.saead_ref_info_m.session_ref.len = SESSION_REF_LEN;
+        header.encryption_info_m.saead_ref_info_m.pouch_id = pouch_id;
+    }
+    else
+    {
+        header.encryption_info_m.Union_choice = encryption_info_union_saead_info_m_c;
+        session_info_fill(&header.encryption_info_m.saead_info_m.session, id);
+        header.encryption_info_m.saead_info_m.pouch_id = pouch_id;
+    }
+
+    zassert_ok(cbor_encode_pouch_header(pouch->data, sizeof(pouch->data), &header, &pouch->len));
+
+    pouch->key = key;
+    pouch->pouch_id = pouch_id;
+    pouch->block_index = 0;
+}
+
+void server_pouch_entry_add(struct server_pouch *pouch,
+                            const char *path,
+                            const void *data,
+                            size_t len)
+{
+    size_t path_len = strlen(path);
+    // Block ID, data length, content type, path length, path and data:
+    size_t plaintext_len = 1 + 2 + 2 + 1 + path_len + len;
+    uint8_t *block = &pouch->data[pouch->len];
+    uint8_t *payload = &block[2];
+    uint8_t nonce[NONCE_LEN] = {0};
+    size_t ciphertext_len;
+
+    zassert_true(pouch->len + 2 + plaintext_len + AUTH_TAG_LEN <= sizeof(pouch->data));
+
+    // A complete entry in a single entry block:
+    payload[0] = 0x40 | 0x80;
+    sys_put_be16(len, &payload[1]);
+    sys_put_be16(POUCH_CONTENT_TYPE_OCTET_STREAM, &payload[3]);
+    payload[5] = path_len;
+    memcpy(&payload[6], path, path_len);
+    memcpy(&payload[6 + path_len], data, len);
+
+    sys_put_be16(pouch->pouch_id, &nonce[0]);
+    sys_put_be16(pouch->block_index, &nonce[2]);
+    nonce[4] = POUCH_ROLE_SERVER;
+
+    zassert_equal(psa_aead_encrypt(pouch->key,
+                                   PSA_ALG_CHACHA20_POLY1305,
+                                   nonce,
+                                   sizeof(nonce),
+                                   pouch->ad,
+                                   pouch->block_index > 0 ? sizeof(pouch->ad) : 0,
+                                   payload,
+                                   plaintext_len,
+                                   payload,
+                                   plaintext_len + AUTH_TAG_LEN,
+                                   &ciphertext_len),
+                  PSA_SUCCESS);
+
+    sys_put_be16(ciphertext_len, block);
+    memcpy(pouch->ad, &payload[plaintext_len], AUTH_TAG_LEN);
+    pouch->block_index++;
+    pouch->len += 2 + ciphertext_len;
+}
+
+int server_pouch_send(const struct server_pouch *pouch)
+{
+    k_sem_reset(&entry_received);
+
+    pouch_downlink_start();
+    int err = pouch_downlink_push(pouch->data, pouch->len);
+    pouch_downlink_finish();
+
+    if (err)
+    {
+        return err;
+    }
+
+    return k_sem_take(&entry_received, ENTRY_TIMEOUT) == 0 ? 0 : -ETIMEDOUT;
+}
+
+int server_send(const struct session_id *id, psa_key_id_t key, pouch_id_t pouch_id, bool ref)
+{
+    struct server_pouch pouch;
+    char data[32];
+    int len = snprintf(data, sizeof(data), "pouch %u", pouch_id);
+
+    // Session references were introduced in header version 2:
+    server_pouch_start(&pouch, id, key, pouch_id, ref ? 2 : 1, ref);
+    server_pouch_entry_add(&pouch, "/test", data, len);
+
+    int err = server_pouch_send(&pouch);
+    if (err)
+    {
+        return err;
+    }
+
+    zassert_str_equal(received.path, "/test");
+    zassert_equal(received.len, len);
+    zassert_mem_equal(received.data, data, len);
+
+    return 0;
+}
+
+size_t server_key_slots_get(void)
+{
+    mbedtls_psa_stats_t stats;
+
+    mbedtls_psa_get_stats(&stats);
+
+    return stats.MBEDTLS_PRIVATE(volatile_slots);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <psa/crypto.h>
+
+#include "saead/session.h"
+
+/* The tests play the part of the server: they derive the session keys from the server's private key
+ * and the device's public key, and send encrypted downlink pouches to the device.
+ */
+
+#define SERVER_POUCH_MAX_LEN 256
+
+/** Downlink pouch, as encrypted by the server */
+struct server_pouch
+{
+    uint8_t data[SERVER_POUCH_MAX_LEN];
+    size_t len;
+    psa_key_id_t key;
+    pouch_id_t pouch_id;
+    uint16_t block_index;
+    uint8_t ad[AD_LEN];
+};
+
+/** Set up the device with the test server certificate. Only runs once. */
+void server_init(void);
+
+/** Create a new server initiated session ID, with the next server sequence number */
+void server_session_id_create(struct session_id *id, enum session_id_type type);
+
+/** Derive the session key the server uses for the given session */
+psa_key_id_t server_session_key_get(const struct session_id *id);
+
+/**
+ * Start a downlink pouch in the given session.
+ *
+ * @param version Pouch header version
+ * @param ref Whether to refer to the session with a session reference instead of the full session
+ * info
+ */
+void server_pouch_start(struct server_pouch *pouch,
+                        const struct session_id *id,
+                        psa_key_id_t key,
+                        pouch_id_t pouch_id,
+                        uint8_t version,
+                        bool ref);
+
+/** Add an entry block to the pouch, encrypted with the session key */
+void server_pouch_entry_add(struct server_pouch *pouch,
+                            const char *path,
+                            const void *data,
+                            size_t len);
+
+/**
+ * Send the pouch to the device, and wait for the entry in it to arrive.
+ *
+ * @retval 0 The device received the entry
+ * @retval -ETIMEDOUT The device accepted the pouch, but didn't deliver the entry
+ * @retval <0 The device rejected the pouch
+ */
+int server_pouch_send(const struct server_pouch *pouch);
+
+/** Send a pouch with a single entry to the device in the given session */
+int server_send(const struct session_id *id, psa_key_id_t key, pouch_id_t pouch_id, bool ref);
+
+/** Number of keys in the PSA key store */
+size_t server_key_slots_get(void);
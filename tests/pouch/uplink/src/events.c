@@ -37,6 +37,10 @@ static void event_handler(enum pouch_event event, void *ctx)
         case POUCH_EVENT_SESSION_END:
             end_events++;
             break;
+        case POUCH_EVENT_SYNC_REQUEST:
+        case POUCH_EVENT_SYNC_REQUEST_CLEARED:
+            // covered by the sync policy tests
+            return;
         default:
             zassert_unreachable("Unexpected event %d", event);
             break;
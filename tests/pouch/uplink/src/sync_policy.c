@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2025 Golioth, Inc.
+ */
+#include <zephyr/ztest.h>
+#include <pouch/events.h>
+#include <pouch/uplink.h>
+#include <pouch/pouch.h>
+#include "mocks/transport.h"
+
+#define DEVICE_ID "test-device-id"
+
+static const struct pouch_config pouch_config = {
+    .device_id = DEVICE_ID,
+};
+
+static void *init_pouch(void)
+{
+    pouch_init(&pouch_config);
+    return NULL;
+}
+
+#define EVENT_TIMEOUT K_SECONDS(1)
+
+K_SEM_DEFINE(sync_requested, 0, 1);
+K_SEM_DEFINE(sync_cleared, 0, 1);
+
+static void sync_event_handler(enum pouch_event event, void *ctx)
+{
+    if (event == POUCH_EVENT_SYNC_REQUEST)
+    {
+        k_sem_give(&sync_requested);
+    }
+    else if (event == POUCH_EVENT_SYNC_REQUEST_CLEARED)
+    {
+        k_sem_give(&sync_cleared);
+    }
+}
+
+POUCH_EVENT_HANDLER(sync_event_handler, NULL);
+
+static void reset(void *unused)
+{
+    transport_reset(NULL);
+
+    // let the policy settle:
+    k_sleep(K_MSEC(10));
+    k_sem_reset(&sync_requested);
+    k_sem_reset(&sync_cleared);
+
+    zassert_false(pouch_sync_is_requested());
+}
+
+ZTEST_SUITE(sync_policy, NULL, init_pouch, reset, NULL, NULL);
+
+static void flush(void)
+{
+    transport_session_start();
+    pouch_uplink_close(K_FOREVER);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    static uint8_t buf[CONFIG_POUCH_BLOCK_SIZE * 2];
+    size_t len = sizeof(buf);
+    transport_pull_data(buf, &len);
+    transport_session_end();
+}
+
+ZTEST(sync_policy, test_bytes_threshold)
+{
+    static uint8_t data[CONFIG_POUCH_SYNC_POLICY_BYTES / 2];
+
+    zassert_ok(pouch_uplink_entry_write("test/path",
+                                        POUCH_CONTENT_TYPE_OCTET_STREAM,
+                                        data,
+                                        sizeof(data),
+                                        K_FOREVER));
+    zassert_not_equal(k_sem_take(&sync_requested, K_MSEC(100)), 0, "Unexpected sync request");
+
+    zassert_ok(pouch_uplink_entry_write("test/path",
+                                        POUCH_CONTENT_TYPE_OCTET_STREAM,
+                                        data,
+                                        sizeof(data),
+                                        K_FOREVER));
+    zassert_ok(k_sem_take(&sync_requested, EVENT_TIMEOUT), "Expected a sync request");
+    zassert_true(pouch_sync_is_requested());
+
+    flush();
+
+    zassert_ok(k_sem_take(&sync_cleared, EVENT_TIMEOUT), "Expected the sync request to clear");
+    zassert_false(pouch_sync_is_requested());
+}
+
+ZTEST(sync_policy, test_age_threshold)
+{
+    const uint8_t data[] = {0x01, 0x02, 0x03};
+
+    zassert_ok(pouch_uplink_entry_write("test/path",
+                                        POUCH_CONTENT_TYPE_OCTET_STREAM,
+                                        data,
+                                        sizeof(data),
+                                        K_FOREVER));
+    zassert_not_equal(k_sem_take(&sync_requested, K_MSEC(100)), 0, "Unexpected sync request");
+
+    zassert_ok(k_sem_take(&sync_requested, K_SECONDS(CONFIG_POUCH_SYNC_POLICY_AGE_S + 1)),
+               "Expected a sync request");
+
+    flush();
+
+    zassert_ok(k_sem_take(&sync_cleared, EVENT_TIMEOUT), "Expected the sync request to clear");
+}
+
+ZTEST(sync_policy, test_forced_request)
+{
+    pouch_sync_request();
+
+    zassert_ok(k_sem_take(&sync_requested, EVENT_TIMEOUT), "Expected a sync request");
+
+    transport_session_start();
+    transport_session_end();
+
+    zassert_ok(k_sem_take(&sync_cleared, EVENT_TIMEOUT), "Expected the sync request to clear");
+}
@@ -11,6 +11,7 @@
 
 #include <pouch/uplink.h>
 #include <pouch/pouch.h>
+#include <pouch/schema.h>
 
 #define DEVICE_ID "test-device-id"
 
@@ -194,6 +195,242 @@ ZTEST(uplink, test_pouch_entry)
     zassert_mem_equal(&block_data[5 + path_len], data, sizeof(data));
 }
 
+ZTEST(uplink, test_pouch_entry_vectored)
+{
+    const char *path = "test/path";
+    const uint8_t header[] = {0x01, 0x02};
+    const uint8_t samples[] = {0x03, 0x04, 0x05};
+    const uint8_t trailer[] = {0x06};
+    const uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+
+    const struct pouch_iovec iov[] = {
+        {header, sizeof(header)},
+        {NULL, 0},
+        {samples, sizeof(samples)},
+        {trailer, sizeof(trailer)},
+    };
+
+    transport_session_start();
+
+    zassert_ok(pouch_uplink_entry_writev(path,
+                                         POUCH_CONTENT_TYPE_OCTET_STREAM,
+                                         iov,
+                                         ARRAY_SIZE(iov),
+                                         K_FOREVER));
+    pouch_uplink_close(K_FOREVER);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    uint8_t *buf;
+    size_t len = read_data(&buf, CONFIG_POUCH_BLOCK_SIZE);
+
+    uint8_t *block = skip_pouch_header(buf, &len);
+    uint8_t *block_data = &block[3];
+    len -= 3;
+
+    zassert_equal(len, 5 + strlen(path) + sizeof(data), "Unexpected block length %d", len);
+
+    uint16_t data_len = sys_get_be16(&block_data[0]);
+    zassert_equal(data_len, sizeof(data), "Unexpected data length %d", data_len);
+
+    uint8_t path_len = block_data[4];
+    zassert_equal(path_len, strlen(path), "Unexpected path length %d", path_len);
+
+    zassert_mem_equal(&block_data[5 + path_len], data, sizeof(data));
+}
+
+ZTEST(uplink, test_pouch_entry_vectored_invalid)
+{
+    const struct pouch_iovec empty[] = {
+        {NULL, 0},
+    };
+    const struct pouch_iovec missing_data[] = {
+        {NULL, 4},
+    };
+
+    zassert_equal(pouch_uplink_entry_writev("test/path",
+                                            POUCH_CONTENT_TYPE_OCTET_STREAM,
+                                            empty,
+                                            ARRAY_SIZE(empty),
+                                            K_FOREVER),
+                  -EINVAL);
+    zassert_equal(pouch_uplink_entry_writev("test/path",
+                                            POUCH_CONTENT_TYPE_OCTET_STREAM,
+                                            missing_data,
+                                            ARRAY_SIZE(missing_data),
+                                            K_FOREVER),
+                  -EINVAL);
+}
+
+ZTEST(uplink, test_pending)
+{
+    struct pouch_uplink_pending pending;
+
+    zassert_ok(write_entry(6, K_FOREVER));
+
+    k_sleep(K_MSEC(10));
+
+    zassert_ok(pouch_uplink_pending_get(&pending));
+    zassert_equal(pending.bytes,
+                  3 + 5 + strlen("test/path") + 6,
+                  "Unexpected pending bytes %d",
+                  pending.bytes);
+    zassert_equal(pending.blocks, 0, "Entry block should still be open");
+    zassert_true(pending.age_ms >= 10, "Unexpected age %lld", pending.age_ms);
+
+    transport_session_start();
+    pouch_uplink_close(K_FOREVER);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    zassert_ok(pouch_uplink_pending_get(&pending));
+    zassert_equal(pending.bytes, 0, "Unexpected pending bytes %d", pending.bytes);
+    zassert_equal(pending.blocks, 0, "Unexpected pending blocks %d", pending.blocks);
+
+    uint8_t *buf;
+    read_data(&buf, CONFIG_POUCH_BLOCK_SIZE);
+
+    transport_session_end();
+
+    zassert_ok(pouch_uplink_pending_get(&pending));
+    zassert_equal(pending.age_ms, 0, "Unexpected age %lld", pending.age_ms);
+}
+
+ZTEST(uplink, test_max_pouch_size)
+{
+    if (CONFIG_POUCH_MAX_POUCH_SIZE == 0)
+    {
+        ztest_test_skip();
+    }
+
+    transport_session_start();
+
+    // Each entry fills most of a block, so the data needs more than one pouch:
+    size_t entry_len = CONFIG_POUCH_BLOCK_SIZE - 32;
+    int entries = 2 * CONFIG_POUCH_MAX_POUCH_SIZE / entry_len;
+    for (int i = 0; i < entries; i++)
+    {
+        zassert_ok(write_entry(entry_len, K_FOREVER));
+    }
+
+    pouch_uplink_close(K_FOREVER);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    static uint8_t buf[CONFIG_POUCH_MAX_POUCH_SIZE + CONFIG_POUCH_BLOCK_SIZE];
+    static uint8_t first_header[CONFIG_POUCH_BLOCK_SIZE];
+    size_t first_header_len = 0;
+    int pouches = 0;
+    int blocks = 0;
+    enum pouch_result result;
+    do
+    {
+        size_t len = sizeof(buf);
+        result = transport_pull_data(buf, &len);
+        zassert_true(result == POUCH_END_OF_POUCH || result == POUCH_NO_MORE_DATA,
+                     "Unexpected result %d",
+                     result);
+        zassert_true(len <= CONFIG_POUCH_MAX_POUCH_SIZE, "Pouch too large: %d", len);
+        pouches++;
+
+        // every pouch starts with its own header:
+        uint8_t *blockbuf = skip_pouch_header(buf, &len);
+        uint8_t *end = &blockbuf[len];
+
+        // without encryption, the header doesn't carry a pouch ID, so every pouch repeats the
+        // header of the first pouch:
+        size_t header_len = blockbuf - buf;
+        if (pouches == 1)
+        {
+            memcpy(first_header, buf, header_len);
+            first_header_len = header_len;
+        }
+        else
+        {
+            zassert_equal(header_len, first_header_len);
+            zassert_mem_equal(buf, first_header, header_len);
+        }
+
+        while (blockbuf < end)
+        {
+            struct block block;
+            pull_block(&blockbuf, &block);
+            zassert_equal(block.id, 0, "Expected entry block");
+            blocks++;
+        }
+    } while (result == POUCH_END_OF_POUCH);
+
+    zassert_true(pouches > 1, "Expected multiple pouches");
+    zassert_equal(blocks, entries, "Unexpected block count %d", blocks);
+}
+
+struct test_report
+{
+    int32_t temp;
+    uint8_t flags;
+} __packed;
+
+POUCH_SCHEMA_DEFINE(test_report_schema,
+                    0x1234,
+                    struct test_report,
+                    POUCH_SCHEMA_FIELD(struct test_report, temp, POUCH_SCHEMA_I32),
+                    POUCH_SCHEMA_FIELD(struct test_report, flags, POUCH_SCHEMA_U8));
+
+ZTEST(uplink, test_pouch_entry_schema)
+{
+    const char *path = "test/path";
+    const struct test_report report = {
+        .temp = 22500,
+        .flags = 0x5a,
+    };
+
+    transport_session_start();
+
+    zassert_ok(pouch_uplink_schema_write(path, &test_report_schema, &report, K_FOREVER));
+    pouch_uplink_close(K_FOREVER);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    uint8_t *buf;
+    size_t len = read_data(&buf, CONFIG_POUCH_BLOCK_SIZE);
+
+    uint8_t *block = skip_pouch_header(buf, &len);
+    uint8_t *block_data = &block[3];
+
+    uint16_t data_len = sys_get_be16(&block_data[0]);
+    zassert_equal(data_len, 2 + sizeof(report), "Unexpected data length %d", data_len);
+
+    uint16_t content_type = sys_get_be16(&block_data[2]);
+    zassert_equal(content_type,
+                  POUCH_CONTENT_TYPE_SCHEMA,
+                  "Unexpected content type %d",
+                  content_type);
+
+    uint8_t *data = &block_data[5 + strlen(path)];
+    zassert_equal(sys_get_be16(data), 0x1234, "Unexpected schema ID");
+    zassert_mem_equal(&data[2], &report, sizeof(report));
+}
+
+ZTEST(uplink, test_schema_descriptor)
+{
+    char buf[256];
+    int len = pouch_schema_descriptor_get(buf, sizeof(buf));
+    zassert_true(len > 0, "Failed to get descriptor: %d", len);
+    zassert_equal(len, strlen(buf));
+
+    const char *expected =
+        "{\"endian\":\"little\",\"schemas\":[{\"id\":4660,\"name\":\"test_report_schema\",\"size\":5,\"fields\":["
+        "{\"name\":\"temp\",\"type\":\"i32\",\"offset\":0,\"size\":4},"
+        "{\"name\":\"flags\",\"type\":\"u8\",\"offset\":4,\"size\":1}]}]}";
+    zassert_str_equal(buf, expected);
+
+    zassert_equal(pouch_schema_descriptor_get(buf, 16), -ENOMEM);
+}
+
 ZTEST(uplink, test_pull_no_data)
 {
     transport_session_start();
@@ -370,6 +607,43 @@ ZTEST(uplink, test_stream_basic)
     zassert_mem_equal(&block[6 + strlen("test/path")], data, sizeof(data), "Unexpected data");
 }
 
+ZTEST(uplink, test_stream_vectored)
+{
+    transport_session_start();
+
+    struct pouch_stream *stream =
+        pouch_uplink_stream_open("test/path", POUCH_CONTENT_TYPE_OCTET_STREAM);
+    zassert_not_null(stream, "Failed to open stream");
+
+    const uint8_t header[] = {0x01, 0x02, 0x03};
+    const uint8_t samples[] = {0x04, 0x05, 0x06};
+    const uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+
+    const struct pouch_iovec iov[] = {
+        {header, sizeof(header)},
+        {samples, sizeof(samples)},
+    };
+
+    size_t written = pouch_stream_writev(stream, iov, ARRAY_SIZE(iov), K_NO_WAIT);
+    zassert_equal(written, sizeof(data), "Unexpected write length %d", written);
+
+    zassert_ok(pouch_stream_close(stream, K_NO_WAIT));
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    uint8_t *buf;
+    size_t len = read_data(&buf, CONFIG_POUCH_BLOCK_SIZE);
+
+    uint8_t *blockbuf = skip_pouch_header(buf, &len);
+
+    struct stream_block block;
+    pull_stream_block(&blockbuf, &block);
+    zassert_true(block.block.first && block.block.last, "Expected a single block stream");
+    zassert_equal(block.data_len, sizeof(data), "Unexpected data length %d", block.data_len);
+    zassert_mem_equal(block.data, data, sizeof(data));
+}
+
 ZTEST(uplink, test_stream_multiblock)
 {
     transport_session_start();
@@ -628,6 +902,116 @@ ZTEST(uplink, test_stream_max_count)
     }
 }
 
+ZTEST(uplink, test_stream_unique_ids)
+{
+    transport_session_start();
+
+    struct pouch_stream *streams[POUCH_STREAMS_MAX];
+    for (int i = 0; i < POUCH_STREAMS_MAX; i++)
+    {
+        streams[i] = pouch_uplink_stream_open("test/path", POUCH_CONTENT_TYPE_OCTET_STREAM);
+        zassert_not_null(streams[i], "Failed to open stream");
+
+        uint8_t data = i;
+        size_t written = pouch_stream_write(streams[i], &data, sizeof(data), K_NO_WAIT);
+        zassert_equal(written, sizeof(data), "Unexpected write length %d", written);
+    }
+
+    for (int i = 0; i < POUCH_STREAMS_MAX; i++)
+    {
+        zassert_ok(pouch_stream_close(streams[i], K_NO_WAIT));
+    }
+
+    pouch_uplink_close(K_NO_WAIT);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    static uint8_t buf[POUCH_STREAMS_MAX * 32];
+    size_t len = sizeof(buf);
+    enum pouch_result result = transport_pull_data(buf, &len);
+    zassert_equal(result, POUCH_NO_MORE_DATA, "Unexpected result %d", result);
+
+    uint8_t *blockbuf = skip_pouch_header(buf, &len);
+
+    // Every open stream must have gotten its own ID:
+    static bool seen[0x2000];
+    memset(seen, 0, sizeof(seen));
+    for (int i = 0; i < POUCH_STREAMS_MAX; i++)
+    {
+        struct stream_block block;
+        pull_stream_block(&blockbuf, &block);
+
+        zassert_true(block.block.first && block.block.last, "Expected a single block stream");
+        zassert_not_equal(block.block.id, 0, "Stream %d has an entry ID", i);
+        zassert_false(seen[block.block.id], "Stream ID %d used twice", block.block.id);
+        seen[block.block.id] = true;
+
+        zassert_equal(block.data_len, 1, "Unexpected data length %d", block.data_len);
+        zassert_equal(block.data[0], i & 0xff, "Unexpected data");
+    }
+}
+
+ZTEST(uplink, test_stream_fair_scheduling)
+{
+    // Queue up a large stream before the session starts, then add a small one behind it:
+    struct pouch_stream *large =
+        pouch_uplink_stream_open("test/large", POUCH_CONTENT_TYPE_OCTET_STREAM);
+    zassert_not_null(large, "Failed to open stream");
+
+    uint8_t data[CONFIG_POUCH_BLOCK_SIZE * 2];
+    memset(data, 'a', sizeof(data));
+    size_t written = pouch_stream_write(large, data, sizeof(data), K_NO_WAIT);
+    zassert_equal(written, sizeof(data), "Unexpected write length %d", written);
+
+    struct pouch_stream *small =
+        pouch_uplink_stream_open("test/small", POUCH_CONTENT_TYPE_OCTET_STREAM);
+    zassert_not_null(small, "Failed to open stream");
+
+    written = pouch_stream_write(small, data, 8, K_NO_WAIT);
+    zassert_equal(written, 8, "Unexpected write length %d", written);
+
+    zassert_ok(pouch_stream_close(small, K_NO_WAIT));
+    zassert_ok(pouch_stream_close(large, K_NO_WAIT));
+
+    transport_session_start();
+
+    pouch_uplink_close(K_NO_WAIT);
+
+    // let processing run:
+    k_sleep(K_MSEC(1));
+
+    uint8_t buf[CONFIG_POUCH_BLOCK_SIZE * 5];
+    size_t len = sizeof(buf);
+    enum pouch_result result = transport_pull_data(buf, &len);
+    zassert_equal(result, POUCH_NO_MORE_DATA, "Unexpected result %d", result);
+
+    uint8_t *blockbuf = skip_pouch_header(buf, &len);
+
+    struct stream_block first;
+    pull_stream_block(&blockbuf, &first);
+    zassert_mem_equal(first.path, "test/large", strlen("test/large"));
+    zassert_false(first.block.last, "Expected more data");
+
+    // The small stream should get its turn before the large stream is drained:
+    struct stream_block second;
+    pull_stream_block(&blockbuf, &second);
+    zassert_mem_equal(second.path, "test/small", strlen("test/small"));
+    zassert_true(second.block.first && second.block.last, "Expected a single block stream");
+    zassert_not_equal(first.block.id, second.block.id, "Unexpected stream ID");
+
+    size_t large_len = first.data_len;
+    struct block block;
+    do
+    {
+        pull_block(&blockbuf, &block);
+        zassert_equal(block.id, first.block.id, "Unexpected stream ID");
+        large_len += block.data_len;
+    } while (!block.last);
+
+    zassert_equal(large_len, sizeof(data), "Unexpected data length %d", large_len);
+}
+
 ZTEST(uplink, test_stream_empty)
 {
     transport_session_start();